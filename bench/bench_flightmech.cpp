@@ -0,0 +1,660 @@
+// Microbenchmarks of the flight mechanics functions.
+//
+//   bench_flightmech [--filter TEXT] [--min-time-ms MS] [--repeat N]
+//                    [--json FILE] [--baseline FILE] [--threshold FRACTION]
+//                    [--noise-cap FRACTION]
+//
+// Every benchmark runs over a fixed set of randomized inputs (same seed on
+// every run) and reports the fastest of 15 samples in ns per call (the one
+// least disturbed by the rest of the machine), the noise (median absolute
+// deviation of the samples relative to their median) and the calls per
+// second; batch benchmarks count one call per element. With --repeat the
+// whole suite runs N times and the samples of all the runs are pooled, so
+// that slow phases of the machine lasting longer than one benchmark show up
+// in the noise. The results are written as JSON (to standard output, or
+// FILE with --json).
+//
+// With --baseline the results are compared against a JSON file written by
+// an earlier run: a benchmark regresses when it is slower than its baseline
+// by more than the threshold (default 0.10, i.e. 10%) plus three times the
+// larger noise of the two runs. The noise allowance is capped (default
+// 0.10), so a noisy benchmark is never allowed more than threshold plus cap
+// (20% by default) and realistic regressions are still caught. A benchmark
+// in the baseline may carry its own "threshold". Any regression makes the
+// run exit with status 1.
+// Baselines are machine specific; write one per rig with --json and keep it
+// next to the rig's configuration.
+
+#include "../include/aerodynamics.hpp"
+#include "../include/aircraftmotion.hpp"
+#include "../include/airdata.hpp"
+#include "../include/atmosphere.hpp"
+#include "../include/atmospheretable.hpp"
+#include "../include/ensemble.hpp"
+#include "../include/framesnrotations.hpp"
+#include "../include/integrators.hpp"
+#include "../include/massproperties.hpp"
+#include "../include/threadpool.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+const std::size_t INPUT_COUNT{4096};
+const int SAMPLE_COUNT{15};
+
+// keep a value alive without storing it
+template <typename T> inline void do_not_optimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct benchmark_result {
+  std::string name;
+  double ns_per_call;
+  double noise;
+  double calls_per_second;
+  std::vector<double> samples;
+};
+
+// fastest sample, noise and calls per second from the samples
+void summarize(benchmark_result &result) {
+  std::vector<double> &samples{result.samples};
+  std::sort(samples.begin(), samples.end());
+  double median{samples[samples.size() / 2]};
+  std::vector<double> deviations;
+  for (double sample : samples) {
+    deviations.push_back(std::fabs(sample - median));
+  }
+  std::sort(deviations.begin(), deviations.end());
+  result.ns_per_call = samples.front();
+  result.noise = deviations[deviations.size() / 2] / median;
+  result.calls_per_second = 1e9 / result.ns_per_call;
+}
+
+struct benchmark_options {
+  std::string filter;
+  double min_time_s{0.2};
+};
+
+// run body() (which makes calls_per_run calls) until every sample takes at
+// least min_time_s / SAMPLE_COUNT, and keep the fastest sample and the
+// relative spread of the samples
+template <typename Body>
+void run_benchmark(std::vector<benchmark_result> &results,
+                   const benchmark_options &options, const std::string &name,
+                   std::size_t calls_per_run, Body body) {
+  if (name.find(options.filter) == std::string::npos) {
+    return;
+  }
+  using clock = std::chrono::steady_clock;
+  double sample_time_s{options.min_time_s / SAMPLE_COUNT};
+
+  body();
+  std::size_t runs{1};
+  while (true) {
+    auto start{clock::now()};
+    for (std::size_t r = 0; r < runs; ++r) {
+      body();
+    }
+    std::chrono::duration<double> elapsed{clock::now() - start};
+    if (elapsed.count() >= sample_time_s) {
+      break;
+    }
+    runs *= elapsed.count() > 0.0
+                ? std::max<std::size_t>(
+                      2, static_cast<std::size_t>(1.2 * sample_time_s /
+                                                  elapsed.count()))
+                : 10;
+  }
+
+  benchmark_result result{name, 0.0, 0.0, 0.0,
+                          std::vector<double>(SAMPLE_COUNT)};
+  for (double &sample : result.samples) {
+    auto start{clock::now()};
+    for (std::size_t r = 0; r < runs; ++r) {
+      body();
+    }
+    std::chrono::duration<double> elapsed{clock::now() - start};
+    sample = elapsed.count() * 1e9 / static_cast<double>(runs * calls_per_run);
+  }
+  summarize(result);
+  std::cerr << name << ": " << result.ns_per_call << " ns/call, noise "
+            << 100.0 * result.noise << "%\n";
+  results.push_back(std::move(result));
+}
+
+std::string to_json(const std::vector<benchmark_result> &results) {
+  std::ostringstream json;
+  json.precision(6);
+  json << "{\n  \"benchmarks\": [\n";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    json << "    {\"name\": \"" << results[i].name
+         << "\", \"ns_per_call\": " << results[i].ns_per_call
+         << ", \"noise\": " << results[i].noise
+         << ", \"calls_per_second\": " << results[i].calls_per_second << "}"
+         << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  json << "  ]\n}\n";
+  return json.str();
+}
+
+struct baseline_entry {
+  double ns_per_call{0.0};
+  double noise{0.0};
+  double threshold{-1.0};
+};
+
+// benchmarks of a JSON file written by to_json (threshold may be added by
+// hand); reads the flat objects of the "benchmarks" array and throws on
+// anything else
+std::map<std::string, baseline_entry> read_baseline(const std::string &path) {
+  std::ifstream file{path};
+  if (!file) {
+    throw std::runtime_error("cannot read baseline " + path);
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string text{buffer.str()};
+  auto malformed = [&path](const std::string &what) {
+    return std::runtime_error("malformed baseline " + path + ": " + what);
+  };
+
+  std::size_t position{text.find("\"benchmarks\"")};
+  if (position == std::string::npos) {
+    throw malformed("no \"benchmarks\"");
+  }
+  position = text.find('[', position);
+  std::size_t array_end{text.find(']', position)};
+  if (position == std::string::npos || array_end == std::string::npos) {
+    throw malformed("no benchmark array");
+  }
+
+  std::map<std::string, baseline_entry> baseline;
+  while (true) {
+    std::size_t open{text.find('{', position)};
+    if (open == std::string::npos || open > array_end) {
+      break;
+    }
+    std::size_t close{text.find('}', open)};
+    if (close == std::string::npos || close > array_end) {
+      throw malformed("unterminated benchmark");
+    }
+    std::string object{text.substr(open + 1, close - open - 1)};
+    position = close + 1;
+
+    std::string name;
+    baseline_entry entry;
+    std::size_t key{object.find('"')};
+    while (key != std::string::npos) {
+      std::size_t key_end{object.find('"', key + 1)};
+      if (key_end == std::string::npos) {
+        throw malformed("unterminated field name");
+      }
+      std::string field{object.substr(key + 1, key_end - key - 1)};
+      std::size_t colon{object.find_first_not_of(" \t\r\n", key_end + 1)};
+      if (colon == std::string::npos || object[colon] != ':') {
+        throw malformed("no value of \"" + field + "\"");
+      }
+      std::size_t value{object.find_first_not_of(" \t\r\n", colon + 1)};
+      if (value == std::string::npos) {
+        throw malformed("no value of \"" + field + "\"");
+      }
+      std::size_t next;
+      if (object[value] == '"') {
+        std::size_t value_end{object.find('"', value + 1)};
+        if (value_end == std::string::npos) {
+          throw malformed("unterminated value of \"" + field + "\"");
+        }
+        if (field == "name") {
+          name = object.substr(value + 1, value_end - value - 1);
+        }
+        next = value_end + 1;
+      } else {
+        const char *begin{object.c_str() + value};
+        char *end{nullptr};
+        double number{std::strtod(begin, &end)};
+        if (end == begin || !std::isfinite(number)) {
+          throw malformed("bad number in \"" + field + "\"");
+        }
+        if (field == "ns_per_call") {
+          entry.ns_per_call = number;
+        } else if (field == "noise") {
+          entry.noise = number;
+        } else if (field == "threshold") {
+          entry.threshold = number;
+        }
+        next = static_cast<std::size_t>(end - object.c_str());
+      }
+      std::size_t separator{object.find_first_not_of(" \t\r\n", next)};
+      if (separator != std::string::npos && object[separator] != ',') {
+        throw malformed("missing ',' after \"" + field + "\"");
+      }
+      key = separator == std::string::npos
+                ? std::string::npos
+                : object.find('"', separator);
+    }
+    if (name.empty() || !(entry.ns_per_call > 0.0)) {
+      throw malformed("benchmark without a name or ns_per_call");
+    }
+    baseline[name] = entry;
+  }
+  return baseline;
+}
+
+// inputs shared by the benchmarks
+struct benchmark_inputs {
+  std::vector<double> height_m, true_airspeed_mps, temperature_K, pressure_Pa;
+  std::vector<double> roll, pitch, yaw, rate_x, rate_y, rate_z;
+  std::vector<aircraft_state> states;
+  std::vector<std::array<double, 3>> vectors, forces, moments;
+
+  benchmark_inputs() {
+    std::mt19937_64 generator{2024};
+    std::uniform_real_distribution<double> unit{0.0, 1.0};
+    auto uniform = [&](double low, double high) {
+      return low + (high - low) * unit(generator);
+    };
+    for (std::size_t i = 0; i < INPUT_COUNT; ++i) {
+      height_m.push_back(uniform(0.0, 20000.0));
+      true_airspeed_mps.push_back(uniform(30.0, 250.0));
+      temperature_K.push_back(ISA_temperature(height_m.back()));
+      pressure_Pa.push_back(
+          ISA_airpressure(temperature_K.back(), height_m.back()));
+      roll.push_back(uniform(-3.0, 3.0));
+      pitch.push_back(uniform(-1.4, 1.4));
+      yaw.push_back(uniform(-3.0, 3.0));
+      rate_x.push_back(uniform(-1.0, 1.0));
+      rate_y.push_back(uniform(-1.0, 1.0));
+      rate_z.push_back(uniform(-1.0, 1.0));
+      states.push_back({uniform(-1e3, 1e3), uniform(-1e3, 1e3),
+                        -height_m.back(), roll.back(), pitch.back(),
+                        yaw.back(), uniform(40.0, 80.0), uniform(-5.0, 5.0),
+                        uniform(-5.0, 5.0), rate_x.back(), rate_y.back(),
+                        rate_z.back()});
+      vectors.push_back({uniform(-100.0, 100.0), uniform(-100.0, 100.0),
+                         uniform(-100.0, 100.0)});
+      forces.push_back({uniform(-1e3, 1e3), uniform(-1e3, 1e3),
+                        uniform(-1e4, 1e4)});
+      moments.push_back({uniform(-500.0, 500.0), uniform(-500.0, 500.0),
+                         uniform(-500.0, 500.0)});
+    }
+  }
+};
+
+const std::array<std::array<double, 3>, 3> BENCH_INERTIA_TENSOR{
+    {{1300.0, 0.0, -60.0}, {0.0, 1800.0, 0.0}, {-60.0, 0.0, 2600.0}}};
+const double BENCH_MASS_kg{1200.0};
+
+// gravity and damping, for the integrator benchmarks
+struct bench_force_model {
+  void operator()(double, const aircraft_state &state,
+                  const direction_cosine_matrix &attitude,
+                  std::array<double, 3> &force, std::array<double, 3> &moment) {
+    force = attitude.earth_to_body(
+        {0.0, 0.0, BENCH_MASS_kg * GRAVITY_SEALEVEL_mps2});
+    force[0] += 2000.0 - 5.0 * state[STATE_FORWARD_VEL];
+    force[2] -= 200.0 * state[STATE_DOWNWARD_VEL];
+    for (std::size_t c = 0; c < 3; ++c) {
+      moment[c] = -500.0 * state[STATE_FORWARD_ANG_VEL + c];
+    }
+  }
+};
+
+// same model for the ensemble
+struct bench_ensemble_model {
+  void operator()(double, const ensemble_chunk &chunk) const {
+    for (std::size_t i = 0; i < chunk.count; ++i) {
+      double mass{chunk.mass_properties.mass[i]};
+      double roll{chunk.state[STATE_ROLL][i]};
+      double pitch{chunk.state[STATE_PITCH][i]};
+      double weight{mass * GRAVITY_SEALEVEL_mps2};
+      chunk.force[0][i] = 2000.0 - 5.0 * chunk.state[STATE_FORWARD_VEL][i] -
+                          weight * std::sin(pitch);
+      chunk.force[1][i] = weight * std::cos(pitch) * std::sin(roll);
+      chunk.force[2][i] = weight * std::cos(pitch) * std::cos(roll) -
+                          200.0 * chunk.state[STATE_DOWNWARD_VEL][i];
+      for (std::size_t c = 0; c < 3; ++c) {
+        chunk.moment[c][i] =
+            -500.0 * chunk.state[STATE_FORWARD_ANG_VEL + c][i];
+      }
+    }
+  }
+};
+
+std::vector<benchmark_result> run_all(const benchmark_options &options) {
+  std::vector<benchmark_result> results;
+  benchmark_inputs in;
+  const std::size_t n{INPUT_COUNT};
+
+  // atmosphere and air data, one call per sample
+  run_benchmark(results, options, "ISA_temperature", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(ISA_temperature(in.height_m[i]));
+    }
+  });
+  run_benchmark(results, options, "ISA_airpressure", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(ISA_airpressure(in.temperature_K[i], in.height_m[i]));
+    }
+  });
+  run_benchmark(results, options, "ISA_density", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(ISA_density(in.temperature_K[i], in.pressure_Pa[i]));
+    }
+  });
+  run_benchmark(results, options, "ISA_soundspeed", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(ISA_soundspeed(in.temperature_K[i]));
+    }
+  });
+  run_benchmark(results, options, "calibrated_airspeed", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(
+          calibrated_airspeed(in.true_airspeed_mps[i], in.height_m[i]));
+    }
+  });
+  run_benchmark(results, options, "compute_air_data", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(
+          compute_air_data(in.height_m[i], in.true_airspeed_mps[i]));
+    }
+  });
+
+  // batch atmosphere and air data, one call per element
+  std::vector<double> out_a(n), out_b(n), out_c(n), out_d(n), out_e(n),
+      out_f(n), out_g(n), out_h(n), out_i(n);
+  run_benchmark(results, options, "ISA_batch", n, [&] {
+    ISA_batch(in.height_m.data(), n, out_a.data(), out_b.data(), out_c.data(),
+              out_d.data());
+    do_not_optimize(out_a[n - 1]);
+  });
+  const ISA_table &table{ISA_default_table()};
+  run_benchmark(results, options, "ISA_table_batch", n, [&] {
+    table.evaluate(in.height_m.data(), n, out_a.data(), out_b.data(),
+                   out_c.data(), out_d.data());
+    do_not_optimize(out_a[n - 1]);
+  });
+  std::vector<ISA_status> status(n);
+  air_data_arrays air{out_a.data(), out_b.data(), out_c.data(),
+                      out_d.data(), out_e.data(), out_f.data(),
+                      out_g.data(), out_h.data(), out_i.data(), status.data()};
+  run_benchmark(results, options, "compute_air_data_batch", n, [&] {
+    compute_air_data(in.height_m.data(), in.true_airspeed_mps.data(), n, air);
+    do_not_optimize(out_h[n - 1]);
+  });
+
+  // rotations
+  run_benchmark(results, options, "body_to_earth", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(
+          body_to_earth(in.vectors[i], in.roll[i], in.pitch[i], in.yaw[i]));
+    }
+  });
+  run_benchmark(results, options, "earth_to_body", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(
+          earth_to_body(in.vectors[i], in.roll[i], in.pitch[i], in.yaw[i]));
+    }
+  });
+  run_benchmark(results, options, "body_angular_vel", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(body_angular_vel(in.roll[i], in.pitch[i], in.yaw[i],
+                                       in.rate_x[i], in.rate_y[i],
+                                       in.rate_z[i]));
+    }
+  });
+  vector_arrays vector_in{in.rate_x.data(), in.rate_y.data(),
+                          in.rate_z.data()};
+  vector_arrays vector_out{out_a.data(), out_b.data(), out_c.data()};
+  run_benchmark(results, options, "body_to_earth_batch", n, [&] {
+    body_to_earth_batch(n, in.roll.data(), in.pitch.data(), in.yaw.data(),
+                        vector_in, vector_out);
+    do_not_optimize(out_a[n - 1]);
+  });
+  run_benchmark(results, options, "earth_to_body_batch", n, [&] {
+    earth_to_body_batch(n, in.roll.data(), in.pitch.data(), in.yaw.data(),
+                        vector_in, vector_out);
+    do_not_optimize(out_a[n - 1]);
+  });
+  run_benchmark(results, options, "body_angular_vel_batch", n, [&] {
+    body_angular_vel_batch(n, in.roll.data(), in.pitch.data(),
+                           in.rate_x.data(), in.rate_y.data(),
+                           in.rate_z.data(), vector_out);
+    do_not_optimize(out_a[n - 1]);
+  });
+
+  // equations of motion
+  run_benchmark(results, options, "aircrafts_EOM", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(aircrafts_EOM(in.states[i], BENCH_MASS_kg, in.forces[i],
+                                    in.moments[i], BENCH_INERTIA_TENSOR));
+    }
+  });
+  mass_properties<double> properties{BENCH_MASS_kg, BENCH_INERTIA_TENSOR};
+  run_benchmark(results, options, "aircrafts_EOM_mass_properties", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(
+          aircrafts_EOM(in.states[i], properties, in.forces[i], in.moments[i]));
+    }
+  });
+  // the same with the attitude already turned into direction cosine
+  // matrices, so that only the dynamic part (where the precomputed inertia
+  // coefficients save the divisions) is compared
+  std::vector<direction_cosine_matrix> attitudes;
+  attitudes.reserve(n);
+  for (const aircraft_state &state : in.states) {
+    attitudes.emplace_back(state[STATE_ROLL], state[STATE_PITCH],
+                           state[STATE_YAW]);
+  }
+  run_benchmark(results, options, "aircrafts_EOM_attitude", n, [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      do_not_optimize(aircrafts_EOM(in.states[i], attitudes[i], BENCH_MASS_kg,
+                                    in.forces[i], in.moments[i],
+                                    BENCH_INERTIA_TENSOR));
+    }
+  });
+  run_benchmark(results, options, "aircrafts_EOM_attitude_mass_properties", n,
+                [&] {
+                  for (std::size_t i = 0; i < n; ++i) {
+                    do_not_optimize(aircrafts_EOM(in.states[i], attitudes[i],
+                                                  properties, in.forces[i],
+                                                  in.moments[i]));
+                  }
+                });
+
+  thread_pool serial_pool{1};
+  aircraft_ensemble ensemble{n};
+  for (std::size_t i = 0; i < n; ++i) {
+    ensemble.set_member_state(i, in.states[i]);
+    ensemble.set_member_mass(i, BENCH_MASS_kg, BENCH_INERTIA_TENSOR);
+  }
+  std::vector<double> derivative_data(AIRCRAFT_STATE_SIZE * n);
+  aircraft_state_arrays derivative;
+  for (std::size_t c = 0; c < AIRCRAFT_STATE_SIZE; ++c) {
+    derivative[c] = derivative_data.data() + c * n;
+  }
+  vector_arrays force_arrays{out_a.data(), out_b.data(), out_c.data()};
+  vector_arrays moment_arrays{out_d.data(), out_e.data(), out_f.data()};
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t c = 0; c < 3; ++c) {
+      force_arrays[c][i] = in.forces[i][c];
+      moment_arrays[c][i] = in.moments[i][c];
+    }
+  }
+  run_benchmark(results, options, "aircrafts_EOM_batch", n, [&] {
+    aircrafts_EOM_batch(n, ensemble.state_arrays(), ensemble.mass_arrays(),
+                        force_arrays, moment_arrays, derivative);
+    do_not_optimize(derivative_data[n - 1]);
+  });
+
+  // integrators, one call per step (per member step for the ensemble)
+  aircraft_dynamics<bench_force_model> dynamics{
+      BENCH_MASS_kg, BENCH_INERTIA_TENSOR, bench_force_model{}};
+  RK4_integrator<AIRCRAFT_STATE_SIZE> rk4;
+  aircraft_state rk4_state{in.states[0]};
+  run_benchmark(results, options, "RK4_step", 1000, [&] {
+    aircraft_state state{rk4_state};
+    double time_s{0.0};
+    for (int i = 0; i < 1000; ++i) {
+      rk4.step(dynamics, time_s, 0.001, state);
+      time_s += 0.001;
+    }
+    do_not_optimize(state[0]);
+  });
+  DormandPrince54_integrator<AIRCRAFT_STATE_SIZE> dp54{1e-8, 1e-8};
+  integration_stats dp54_stats{};
+  {
+    aircraft_state state{rk4_state};
+    double time_s{0.0}, step_s{0.01};
+    dp54_stats = dp54.integrate(dynamics, time_s, 10.0, step_s, state);
+  }
+  run_benchmark(results, options, "DormandPrince54_step",
+                dp54_stats.accepted_steps + dp54_stats.rejected_steps, [&] {
+                  aircraft_state state{rk4_state};
+                  double time_s{0.0}, step_s{0.01};
+                  dp54.integrate(dynamics, time_s, 10.0, step_s, state);
+                  do_not_optimize(state[0]);
+                });
+  ensemble_integrator<bench_ensemble_model> ensemble_rk4{
+      ensemble, bench_ensemble_model{}, serial_pool};
+  run_benchmark(results, options, "ensemble_RK4_member_step", n, [&] {
+    ensemble_rk4.step(0.0, 1e-6);
+    do_not_optimize(derivative_data[0]);
+  });
+
+  // aerodynamic table, 4 axes and 3 coefficients
+  std::vector<std::vector<double>> breakpoints{
+      {-0.2, -0.1, 0.0, 0.05, 0.1, 0.15, 0.2, 0.3},
+      {-0.1, 0.0, 0.1},
+      {0.1, 0.4, 0.6, 0.8, 0.9},
+      {-0.4, -0.2, 0.0, 0.2, 0.4}};
+  std::vector<double> values(8 * 3 * 5 * 5 * 3);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = std::sin(0.1 * static_cast<double>(i));
+  }
+  aero_table aero{{"alpha", "beta", "Mach", "elevator"},
+                  breakpoints,
+                  {"CL", "CD", "Cm"},
+                  values};
+  std::vector<double> alpha(n), beta(n), Mach(n), elevator(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    double s{static_cast<double>(i) / n};
+    alpha[i] = -0.2 + 0.5 * s;
+    beta[i] = 0.1 * in.rate_x[i];
+    Mach[i] = 0.1 + 0.8 * s;
+    elevator[i] = 0.4 * in.rate_y[i];
+  }
+  const double *aero_in[4]{alpha.data(), beta.data(), Mach.data(),
+                           elevator.data()};
+  double *aero_out[3]{out_a.data(), out_b.data(), out_c.data()};
+  run_benchmark(results, options, "aero_table_batch", n, [&] {
+    aero.evaluate(n, aero_in, aero_out);
+    do_not_optimize(out_a[n - 1]);
+  });
+
+  return results;
+}
+
+int main(int argc, char **argv) {
+  benchmark_options options;
+  std::string json_path, baseline_path;
+  double threshold{0.10};
+  double noise_cap{0.10};
+  int repeat{1};
+  for (int i = 1; i < argc; ++i) {
+    std::string argument{argv[i]};
+    bool has_value{i + 1 < argc};
+    if (argument == "--filter" && has_value) {
+      options.filter = argv[++i];
+    } else if (argument == "--min-time-ms" && has_value) {
+      options.min_time_s = 1e-3 * std::atof(argv[++i]);
+    } else if (argument == "--repeat" && has_value) {
+      repeat = std::max(1, std::atoi(argv[++i]));
+    } else if (argument == "--json" && has_value) {
+      json_path = argv[++i];
+    } else if (argument == "--baseline" && has_value) {
+      baseline_path = argv[++i];
+    } else if (argument == "--threshold" && has_value) {
+      threshold = std::atof(argv[++i]);
+    } else if (argument == "--noise-cap" && has_value) {
+      noise_cap = std::max(0.0, std::atof(argv[++i]));
+    } else {
+      std::cerr << "usage: bench_flightmech [--filter TEXT] [--min-time-ms "
+                   "MS] [--repeat N] [--json FILE] [--baseline FILE] "
+                   "[--threshold FRACTION] [--noise-cap FRACTION]\n"
+                   "Baselines are machine specific: write one on the "
+                   "machine that checks against it (--repeat 5 --json "
+                   "FILE).\n";
+      return 2;
+    }
+  }
+
+  std::vector<benchmark_result> results{run_all(options)};
+  for (int run = 1; run < repeat; ++run) {
+    std::vector<benchmark_result> more{run_all(options)};
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      results[i].samples.insert(results[i].samples.end(),
+                                more[i].samples.begin(),
+                                more[i].samples.end());
+      summarize(results[i]);
+    }
+  }
+  std::string json{to_json(results)};
+  if (json_path.empty()) {
+    std::cout << json;
+  } else {
+    std::ofstream file{json_path};
+    file << json;
+    if (!file) {
+      std::cerr << "cannot write " << json_path << "\n";
+      return 2;
+    }
+  }
+
+  if (baseline_path.empty()) {
+    return 0;
+  }
+  std::map<std::string, baseline_entry> baseline;
+  try {
+    baseline = read_baseline(baseline_path);
+  } catch (const std::exception &error) {
+    std::cerr << error.what() << "\n";
+    return 2;
+  }
+  int regressions{0};
+  for (const benchmark_result &result : results) {
+    auto entry{baseline.find(result.name)};
+    if (entry == baseline.end()) {
+      std::cerr << result.name << ": no baseline\n";
+      continue;
+    }
+    double noise_allowance{std::min(
+        3.0 * std::max(entry->second.noise, result.noise), noise_cap)};
+    double allowed{(entry->second.threshold >= 0.0 ? entry->second.threshold
+                                                   : threshold) +
+                   noise_allowance};
+    double change{result.ns_per_call / entry->second.ns_per_call - 1.0};
+    bool regressed{change > allowed};
+    regressions += regressed;
+    std::fprintf(stderr,
+                 "%-32s %10.3f ns, baseline %10.3f ns, %+6.1f%% (allowed "
+                 "%+.1f%%)%s\n",
+                 result.name.c_str(), result.ns_per_call,
+                 entry->second.ns_per_call, 100.0 * change, 100.0 * allowed,
+                 regressed ? "  REGRESSION" : "");
+  }
+  std::cerr << regressions << " regression(s)\n";
+  return regressions == 0 ? 0 : 1;
+}
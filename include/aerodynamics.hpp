@@ -25,3 +25,440 @@ Example, suppose Software X was used for data analysis:
 "The data analysis was performed using Software X, developed by
 Dr. Rodolfo B. Negri~\footnote{[URL]}."
 */
+
+#ifndef AERODYNAMICS_HPP
+#define AERODYNAMICS_HPP
+
+// Aerodynamic coefficient tables and the loads they produce.
+//
+// An aero_table holds one or more coefficients (CL, CD, Cm, ...) tabulated
+// over the same N axes (angle of attack, sideslip, Mach number, control
+// deflections, ...) and interpolates them multilinearly. Outside the
+// breakpoints the values are held at the edge of the table.
+//
+// Layout: the grid nodes are stored row major (the last axis varies
+// fastest) and all the coefficients of a node are stored next to each
+// other, so one query reads 2^N short contiguous runs and every coefficient
+// comes from the same cache lines. The breakpoint search starts from the
+// cells of the previous query (aero_table_hint), which makes queries along a
+// trajectory O(1).
+//
+// The whole table (header, names, breakpoints, values) lives in one binary
+// image. save() writes the image as it is and load() maps the file into
+// memory, so starting up costs a header check instead of parsing text. The
+// image is in native byte order and the header rejects files written on a
+// machine of the other order.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const std::size_t AERO_TABLE_MAX_DIMENSIONS{8};
+const std::size_t AERO_TABLE_NAME_SIZE{16};
+const std::uint32_t AERO_TABLE_VERSION{1};
+
+// cell of the previous query on every axis, where the next search starts
+struct aero_table_hint {
+  std::array<std::size_t, AERO_TABLE_MAX_DIMENSIONS> cell{};
+};
+
+// header at the start of the binary image; names, breakpoints and values
+// follow, each section a multiple of 8 bytes
+struct aero_table_header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint32_t dimension_count;
+  std::uint32_t coefficient_count;
+  std::uint64_t breakpoint_count[AERO_TABLE_MAX_DIMENSIONS];
+  std::uint64_t size_bytes;
+};
+
+class aero_table {
+public:
+  // values holds the coefficients node by node, the last axis varying
+  // fastest: values[node * coefficient count + coefficient]. Breakpoints
+  // must be strictly increasing, at least two per axis. Names are cut to
+  // AERO_TABLE_NAME_SIZE - 1 characters.
+  aero_table(const std::vector<std::string> &axis_names,
+             const std::vector<std::vector<double>> &breakpoints,
+             const std::vector<std::string> &coefficient_names,
+             const std::vector<double> &values) {
+    if (axis_names.size() != breakpoints.size() || breakpoints.empty() ||
+        breakpoints.size() > AERO_TABLE_MAX_DIMENSIONS ||
+        coefficient_names.empty()) {
+      throw std::invalid_argument("aero_table: bad number of axes");
+    }
+    std::size_t node_count{1}, breakpoint_total{0};
+    for (const std::vector<double> &axis : breakpoints) {
+      node_count *= axis.size();
+      breakpoint_total += axis.size();
+    }
+    if (values.size() != node_count * coefficient_names.size()) {
+      throw std::invalid_argument("aero_table: values do not fill the grid");
+    }
+
+    std::size_t name_count{axis_names.size() + coefficient_names.size()};
+    std::size_t size_bytes{sizeof(aero_table_header) +
+                           name_count * AERO_TABLE_NAME_SIZE +
+                           (breakpoint_total + values.size()) * sizeof(double)};
+    // doubles, so the image is aligned for the values
+    auto image{std::make_shared<std::vector<double>>(size_bytes /
+                                                     sizeof(double))};
+    unsigned char *bytes{reinterpret_cast<unsigned char *>(image->data())};
+
+    aero_table_header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = AERO_TABLE_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.dimension_count = static_cast<std::uint32_t>(breakpoints.size());
+    header.coefficient_count =
+        static_cast<std::uint32_t>(coefficient_names.size());
+    for (std::size_t d = 0; d < breakpoints.size(); ++d) {
+      header.breakpoint_count[d] = breakpoints[d].size();
+    }
+    header.size_bytes = size_bytes;
+    std::memcpy(bytes, &header, sizeof(header));
+
+    unsigned char *names{bytes + sizeof(header)};
+    for (std::size_t i = 0; i < name_count; ++i) {
+      const std::string &name{i < axis_names.size()
+                                   ? axis_names[i]
+                                   : coefficient_names[i - axis_names.size()]};
+      std::memcpy(names + i * AERO_TABLE_NAME_SIZE, name.data(),
+                  std::min(name.size(), AERO_TABLE_NAME_SIZE - 1));
+    }
+    double *data{reinterpret_cast<double *>(names +
+                                            name_count * AERO_TABLE_NAME_SIZE)};
+    for (const std::vector<double> &axis : breakpoints) {
+      data = std::copy(axis.begin(), axis.end(), data);
+    }
+    std::copy(values.begin(), values.end(), data);
+
+    attach(std::shared_ptr<const void>(image, image->data()), size_bytes);
+  }
+
+  // table stored by save(); the file is mapped read-only and stays mapped
+  // while any copy of the table exists
+  static aero_table load(const std::string &path) {
+    int file{::open(path.c_str(), O_RDONLY)};
+    if (file < 0) {
+      throw std::runtime_error("aero_table: cannot open " + path);
+    }
+    struct stat status;
+    if (::fstat(file, &status) != 0 ||
+        static_cast<std::size_t>(status.st_size) < sizeof(aero_table_header)) {
+      ::close(file);
+      throw std::runtime_error("aero_table: " + path + " is not a table");
+    }
+    std::size_t size_bytes{static_cast<std::size_t>(status.st_size)};
+    void *address{
+        ::mmap(nullptr, size_bytes, PROT_READ, MAP_PRIVATE, file, 0)};
+    ::close(file);
+    if (address == MAP_FAILED) {
+      throw std::runtime_error("aero_table: cannot map " + path);
+    }
+    std::shared_ptr<const void> image(address, [size_bytes](const void *p) {
+      ::munmap(const_cast<void *>(p), size_bytes);
+    });
+    return aero_table(std::move(image), size_bytes);
+  }
+
+  // write the binary image to path
+  void save(const std::string &path) const {
+    std::FILE *file{std::fopen(path.c_str(), "wb")};
+    if (file == nullptr) {
+      throw std::runtime_error("aero_table: cannot create " + path);
+    }
+    bool written{std::fwrite(m_image.get(), 1, m_image_size, file) ==
+                 m_image_size};
+    if (std::fclose(file) != 0 || !written) {
+      throw std::runtime_error("aero_table: cannot write " + path);
+    }
+  }
+
+  std::size_t dimension_count() const { return m_dimension_count; }
+  std::size_t coefficient_count() const { return m_coefficient_count; }
+  std::size_t breakpoint_count(std::size_t axis) const {
+    return m_breakpoint_count[axis];
+  }
+  const double *breakpoints(std::size_t axis) const {
+    return m_breakpoints[axis];
+  }
+  std::string axis_name(std::size_t axis) const { return name(axis); }
+  std::string coefficient_name(std::size_t coefficient) const {
+    return name(m_dimension_count + coefficient);
+  }
+  // index of the named axis or coefficient, -1 if the table has none
+  int axis_index(const std::string &axis_name) const {
+    return find_name(axis_name, 0, m_dimension_count);
+  }
+  int coefficient_index(const std::string &coefficient_name) const {
+    return find_name(coefficient_name, m_dimension_count, m_coefficient_count);
+  }
+
+  // coefficients at one point (one coordinate per axis)
+  void evaluate(const double *point, double *coefficients,
+                aero_table_hint &hint) const {
+    std::array<double, std::size_t{1} << AERO_TABLE_MAX_DIMENSIONS> weights;
+    std::size_t base{locate(point, hint, weights.data())};
+    const double *values{m_values + base};
+    std::size_t corner_count{std::size_t{1} << m_dimension_count};
+
+    for (std::size_t k = 0; k < m_coefficient_count; ++k) {
+      coefficients[k] = 0.0;
+    }
+    for (std::size_t c = 0; c < corner_count; ++c) {
+      const double *node{values + m_corner_offsets[c]};
+      double weight{weights[c]};
+      for (std::size_t k = 0; k < m_coefficient_count; ++k) {
+        coefficients[k] += weight * node[k];
+      }
+    }
+  }
+
+  void evaluate(const double *point, double *coefficients) const {
+    aero_table_hint hint;
+    evaluate(point, coefficients, hint);
+  }
+
+  // coefficients at count points: inputs[axis][i] is the coordinate of
+  // point i, outputs[coefficient][i] its value. The hint carries over from
+  // one point to the next, so points ordered along the axes (a trajectory,
+  // a sweep) are found without searching.
+  void evaluate(std::size_t count, const double *const *inputs,
+                double *const *outputs, aero_table_hint &hint) const {
+    std::array<double, AERO_TABLE_MAX_DIMENSIONS> point;
+    std::vector<double> coefficients(m_coefficient_count);
+    for (std::size_t i = 0; i < count; ++i) {
+      for (std::size_t d = 0; d < m_dimension_count; ++d) {
+        point[d] = inputs[d][i];
+      }
+      evaluate(point.data(), coefficients.data(), hint);
+      for (std::size_t k = 0; k < m_coefficient_count; ++k) {
+        outputs[k][i] = coefficients[k];
+      }
+    }
+  }
+
+  void evaluate(std::size_t count, const double *const *inputs,
+                double *const *outputs) const {
+    aero_table_hint hint;
+    evaluate(count, inputs, outputs, hint);
+  }
+
+private:
+  static constexpr char MAGIC[9]{"FMAEROTB"};
+  static constexpr std::uint32_t BYTE_ORDER_MARK{0x01020304};
+
+  aero_table(std::shared_ptr<const void> image, std::size_t size_bytes) {
+    attach(std::move(image), size_bytes);
+  }
+
+  // check the image and point the table into it
+  void attach(std::shared_ptr<const void> image, std::size_t size_bytes) {
+    const unsigned char *bytes{static_cast<const unsigned char *>(image.get())};
+    aero_table_header header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != AERO_TABLE_VERSION) {
+      throw std::runtime_error("aero_table: not a table image");
+    }
+    if (header.byte_order != BYTE_ORDER_MARK) {
+      throw std::runtime_error("aero_table: image of another byte order");
+    }
+    if (header.dimension_count == 0 ||
+        header.dimension_count > AERO_TABLE_MAX_DIMENSIONS ||
+        header.coefficient_count == 0) {
+      throw std::runtime_error("aero_table: bad number of axes");
+    }
+
+    m_dimension_count = header.dimension_count;
+    m_coefficient_count = header.coefficient_count;
+    std::size_t node_count{1}, breakpoint_total{0};
+    for (std::size_t d = 0; d < m_dimension_count; ++d) {
+      if (header.breakpoint_count[d] < 2) {
+        throw std::runtime_error("aero_table: axis with fewer than 2 points");
+      }
+      m_breakpoint_count[d] = header.breakpoint_count[d];
+      node_count *= m_breakpoint_count[d];
+      breakpoint_total += m_breakpoint_count[d];
+    }
+    std::size_t name_bytes{(m_dimension_count + m_coefficient_count) *
+                           AERO_TABLE_NAME_SIZE};
+    std::size_t value_count{node_count * m_coefficient_count};
+    if (header.size_bytes != size_bytes ||
+        size_bytes != sizeof(header) + name_bytes +
+                          (breakpoint_total + value_count) * sizeof(double)) {
+      throw std::runtime_error("aero_table: truncated image");
+    }
+
+    m_names = reinterpret_cast<const char *>(bytes + sizeof(header));
+    const double *data{
+        reinterpret_cast<const double *>(bytes + sizeof(header) + name_bytes)};
+    for (std::size_t d = 0; d < m_dimension_count; ++d) {
+      m_breakpoints[d] = data;
+      for (std::size_t i = 1; i < m_breakpoint_count[d]; ++i) {
+        if (!(data[i] > data[i - 1])) {
+          throw std::runtime_error("aero_table: breakpoints not increasing");
+        }
+      }
+      data += m_breakpoint_count[d];
+    }
+    m_values = data;
+
+    // distance between neighbouring nodes along each axis, in doubles
+    std::size_t stride{m_coefficient_count};
+    for (std::size_t d = m_dimension_count; d-- > 0;) {
+      m_strides[d] = stride;
+      stride *= m_breakpoint_count[d];
+    }
+    // offsets of the 2^N corners of a cell from its lower corner; bit d of
+    // the corner number selects the upper breakpoint of axis d
+    for (std::size_t c = 0; c < (std::size_t{1} << m_dimension_count); ++c) {
+      m_corner_offsets[c] = 0;
+      for (std::size_t d = 0; d < m_dimension_count; ++d) {
+        m_corner_offsets[c] += ((c >> d) & 1) * m_strides[d];
+      }
+    }
+
+    m_image = std::move(image);
+    m_image_size = size_bytes;
+  }
+
+  // cell of x in breakpoints[0..count-1], starting from the hint; the first
+  // and last cells extend to -inf and +inf
+  static std::size_t find_cell(const double *breakpoints, std::size_t count,
+                               double x, std::size_t hint) {
+    hint = std::min(hint, count - 2);
+    if (x >= breakpoints[hint]) {
+      if (hint == count - 2 || x < breakpoints[hint + 1]) {
+        return hint;
+      }
+      if (hint + 1 == count - 2 || x < breakpoints[hint + 2]) {
+        return hint + 1;
+      }
+    } else if (hint == 0) {
+      return 0;
+    } else if (x >= breakpoints[hint - 1]) {
+      return hint - 1;
+    }
+    return static_cast<std::size_t>(
+               std::upper_bound(breakpoints + 1, breakpoints + count - 1, x) -
+               breakpoints) -
+           1;
+  }
+
+  // offset of the lower corner of the cell containing point and the
+  // interpolation weights of its corners
+  std::size_t locate(const double *point, aero_table_hint &hint,
+                     double *weights) const {
+    std::size_t base{0};
+    weights[0] = 1.0;
+    for (std::size_t d = 0; d < m_dimension_count; ++d) {
+      const double *b{m_breakpoints[d]};
+      std::size_t cell{
+          find_cell(b, m_breakpoint_count[d], point[d], hint.cell[d])};
+      hint.cell[d] = cell;
+      base += cell * m_strides[d];
+
+      // held at the edges of the table
+      double t{(point[d] - b[cell]) / (b[cell + 1] - b[cell])};
+      t = std::min(std::max(t, 0.0), 1.0);
+      std::size_t half{std::size_t{1} << d};
+      for (std::size_t c = 0; c < half; ++c) {
+        weights[c + half] = weights[c] * t;
+        weights[c] *= 1.0 - t;
+      }
+    }
+    return base;
+  }
+
+  std::string name(std::size_t index) const {
+    const char *text{m_names + index * AERO_TABLE_NAME_SIZE};
+    return std::string(text, strnlen(text, AERO_TABLE_NAME_SIZE));
+  }
+
+  int find_name(const std::string &wanted, std::size_t first,
+                std::size_t count) const {
+    for (std::size_t i = 0; i < count; ++i) {
+      if (name(first + i) == wanted) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  std::shared_ptr<const void> m_image;
+  std::size_t m_image_size{0};
+  std::size_t m_dimension_count{0};
+  std::size_t m_coefficient_count{0};
+  std::array<std::size_t, AERO_TABLE_MAX_DIMENSIONS> m_breakpoint_count{};
+  std::array<const double *, AERO_TABLE_MAX_DIMENSIONS> m_breakpoints{};
+  std::array<std::size_t, AERO_TABLE_MAX_DIMENSIONS> m_strides{};
+  std::array<std::size_t, std::size_t{1} << AERO_TABLE_MAX_DIMENSIONS>
+      m_corner_offsets{};
+  const char *m_names{nullptr};
+  const double *m_values{nullptr};
+};
+
+// reference geometry of the coefficients
+struct aero_reference {
+  double area_m2;
+  double span_m;
+  double chord_m;
+};
+
+// force coefficients in wind axes (drag, side force, lift) and moment
+// coefficients in body axes (roll, pitch, yaw)
+struct aero_coefficients {
+  double CD;
+  double CY;
+  double CL;
+  double Cl;
+  double Cm;
+  double Cn;
+};
+
+// Calculate the aerodynamic force and moment in body axes, as used by
+// aircrafts_EOM, from the coefficients at the dynamic pressure, angle of
+// attack and sideslip angle
+inline void aerodynamic_loads(const aero_coefficients &coefficients,
+                              const aero_reference &reference,
+                              double dynamic_pressure_Pa,
+                              double angle_of_attack_rad, double sideslip_rad,
+                              std::array<double, 3> &force_vector,
+                              std::array<double, 3> &moment_vector) {
+  double qS{dynamic_pressure_Pa * reference.area_m2};
+  double drag_N{qS * coefficients.CD};
+  double side_N{qS * coefficients.CY};
+  double lift_N{qS * coefficients.CL};
+  double c_alpha{std::cos(angle_of_attack_rad)};
+  double s_alpha{std::sin(angle_of_attack_rad)};
+  double c_beta{std::cos(sideslip_rad)}, s_beta{std::sin(sideslip_rad)};
+
+  // wind axes (-drag, side, -lift) to body axes
+  force_vector = {-c_alpha * c_beta * drag_N - c_alpha * s_beta * side_N +
+                      s_alpha * lift_N,
+                  -s_beta * drag_N + c_beta * side_N,
+                  -s_alpha * c_beta * drag_N - s_alpha * s_beta * side_N -
+                      c_alpha * lift_N};
+  moment_vector = {qS * reference.span_m * coefficients.Cl,
+                   qS * reference.chord_m * coefficients.Cm,
+                   qS * reference.span_m * coefficients.Cn};
+}
+
+#endif // !AERODYNAMICS_HPP
@@ -27,82 +27,657 @@ Dr. Rodolfo B. Negri~\footnote{[URL]}."
 */
 
 #ifndef AIRCRAFTMOTION_HPP
+#define AIRCRAFTMOTION_HPP
 
-// #include "framesnrotations.h"
+#include "fastmath.hpp"
+#include "framesnrotations.hpp"
+#include "massproperties.hpp"
 #include <array>
 #include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
 
-// Calculate the aircraft's equations of motion
-inline std::array<double, 12>
-aircrafts_EOM(double earth_pos_x, double earth_pos_y, double earth_pos_z,
-              double roll, double pitch, double yaw, double forward_vel,
-              double lateral_vel, double downward_vel, double forward_ang_vel,
-              double lateral_ang_vel, double downward_ang_vel, double mass,
-              std::array<double, 3> force_vector,
-              std::array<double, 3> moment_vector,
-              std::array<std::array<double, 3>, 3> inertia_tensor) {
+// positions of the states in the state vector used by aircrafts_EOM (the
+// derivative vector uses the same order)
+enum aircraft_state_index : std::size_t {
+  STATE_EARTH_POS_X,
+  STATE_EARTH_POS_Y,
+  STATE_EARTH_POS_Z,
+  STATE_ROLL,
+  STATE_PITCH,
+  STATE_YAW,
+  STATE_FORWARD_VEL,
+  STATE_LATERAL_VEL,
+  STATE_DOWNWARD_VEL,
+  STATE_FORWARD_ANG_VEL,
+  STATE_LATERAL_ANG_VEL,
+  STATE_DOWNWARD_ANG_VEL,
+  AIRCRAFT_STATE_SIZE
+};
 
-  std::array<double, 12> state_vector{0.0};
+// state of the aircraft: earth position, Euler angles, body velocities and
+// body angular velocities, indexed by aircraft_state_index
+using aircraft_state = std::array<double, AIRCRAFT_STATE_SIZE>;
+
+// Calculate the body accelerations (forward, lateral, downward) and angular
+// accelerations (forward, lateral, downward), the dynamic part of the
+// equations of motion shared by the Euler angle and quaternion forms
+inline std::array<double, 6> aircrafts_body_accelerations(
+    double forward_vel, double lateral_vel, double downward_vel,
+    double forward_ang_vel, double lateral_ang_vel, double downward_ang_vel,
+    double mass, const std::array<double, 3> &force_vector,
+    const std::array<double, 3> &moment_vector,
+    const std::array<std::array<double, 3>, 3> &inertia_tensor) {
+  std::array<double, 6> accelerations{0.0};
 
-  // inertial x velocity
-  state_vector[0] =
-      forward_vel * cos(pitch) * cos(yaw) +
-      lateral_vel * (sin(roll) * sin(pitch) * cos(yaw) - cos(roll) * sin(yaw)) +
-      downward_vel * (cos(roll) * sin(pitch) * cos(yaw) - sin(roll) * sin(yaw));
-  // inertial y velocity
-  state_vector[1] =
-      forward_vel * cos(pitch) * sin(yaw) +
-      lateral_vel * (sin(roll) * sin(pitch) * sin(yaw) + cos(roll) * cos(yaw)) +
-      downward_vel * (cos(roll) * sin(pitch) * sin(yaw) - sin(roll) * cos(yaw));
-  // inertial z velocity
-  state_vector[2] = -forward_vel * sin(pitch) +
-                    lateral_vel * sin(roll) * cos(pitch) +
-                    downward_vel * cos(roll) * cos(pitch);
-  // roll angle angular velocity
-  state_vector[3] = forward_ang_vel + lateral_ang_vel * sin(roll) * tan(pitch) +
-                    downward_ang_vel * cos(roll) * tan(pitch);
-  // pitch angle angular velocity
-  state_vector[4] = lateral_ang_vel * cos(pitch) - downward_ang_vel * sin(roll);
-  // yaw angle angular velocity
-  state_vector[5] =
-      1.0 / cos(pitch) *
-      (lateral_ang_vel * sin(pitch) + downward_ang_vel * cos(roll));
   // forward acceleration
-  state_vector[6] = downward_ang_vel * lateral_vel -
-                    lateral_ang_vel * downward_vel + force_vector[0] / mass;
+  accelerations[0] = downward_ang_vel * lateral_vel -
+                     lateral_ang_vel * downward_vel + force_vector[0] / mass;
   // lateral acceleration
-  state_vector[7] = forward_ang_vel * downward_vel -
-                    downward_ang_vel * forward_vel + force_vector[1] / mass;
+  accelerations[1] = forward_ang_vel * downward_vel -
+                     downward_ang_vel * forward_vel + force_vector[1] / mass;
   // downward acceleration
-  state_vector[8] = lateral_ang_vel * forward_vel -
-                    forward_ang_vel * lateral_vel + force_vector[2] / mass;
+  accelerations[2] = lateral_ang_vel * forward_vel -
+                     forward_ang_vel * lateral_vel + force_vector[2] / mass;
   //  elements of the inertia tensor
   double Ixz{-inertia_tensor[0][2]};
   // double Izx{-inertia_tensor[3][1]};
   double Ixx{inertia_tensor[0][0]};
   double Iyy{inertia_tensor[1][1]};
   double Izz{inertia_tensor[2][2]};
+  double gamma{Ixx * Izz - Ixz * Ixz};
   // forward angular velocity
-  state_vector[9] =
+  accelerations[3] =
       (Ixz * moment_vector[2] + Izz * moment_vector[0] +
        Ixz * (Ixx - Iyy + Izz) * forward_ang_vel * lateral_ang_vel -
-       (pow(Ixz, 2) - Iyy * Izz + pow(Izz, 2)) * lateral_ang_vel *
+       (Ixz * Ixz - Iyy * Izz + Izz * Izz) * lateral_ang_vel *
            downward_ang_vel) /
-      (Ixx * Izz - pow(Ixz, 2));
+      gamma;
   // lateral angular velocity
-  state_vector[10] =
+  accelerations[4] =
       (moment_vector[1] - (Ixx - Izz) * downward_ang_vel * forward_ang_vel -
-       Ixz * (pow(forward_ang_vel, 2) - pow(downward_ang_vel, 2))) /
+       Ixz * (forward_ang_vel * forward_ang_vel -
+              downward_ang_vel * downward_ang_vel)) /
       Iyy;
   // downward angular velocity
-  state_vector[11] =
+  accelerations[5] =
       (Ixx * moment_vector[2] + Ixz * moment_vector[0] -
        Ixz * (Ixx - Iyy + Izz) * downward_ang_vel * lateral_ang_vel +
-       (pow(Ixz, 2) - Iyy * Ixx + pow(Ixx, 2)) * lateral_ang_vel *
+       (Ixz * Ixz - Iyy * Ixx + Ixx * Ixx) * lateral_ang_vel *
            forward_ang_vel) /
-      (Ixx * Izz - pow(Ixz, 2));
+      gamma;
+
+  return accelerations;
+}
+
+// Calculate the aircraft's equations of motion for a state whose attitude
+// (roll, pitch, yaw) has already been turned into a direction cosine matrix
+inline std::array<double, 12>
+aircrafts_EOM(const aircraft_state &state,
+              const direction_cosine_matrix &attitude, double mass,
+              const std::array<double, 3> &force_vector,
+              const std::array<double, 3> &moment_vector,
+              const std::array<std::array<double, 3>, 3> &inertia_tensor) {
+  double forward_vel{state[STATE_FORWARD_VEL]};
+  double lateral_vel{state[STATE_LATERAL_VEL]};
+  double downward_vel{state[STATE_DOWNWARD_VEL]};
+  double forward_ang_vel{state[STATE_FORWARD_ANG_VEL]};
+  double lateral_ang_vel{state[STATE_LATERAL_ANG_VEL]};
+  double downward_ang_vel{state[STATE_DOWNWARD_ANG_VEL]};
+  double s_roll{attitude.sin_roll()};
+  double c_roll{attitude.cos_roll()};
+  double t_pitch{attitude.tan_pitch()};
+
+  std::array<double, 12> state_vector{0.0};
+
+  // inertial velocity
+  std::array<double, 3> earth_vel{
+      attitude.body_to_earth({forward_vel, lateral_vel, downward_vel})};
+  state_vector[0] = earth_vel[0];
+  state_vector[1] = earth_vel[1];
+  state_vector[2] = earth_vel[2];
+  // roll angle angular velocity
+  state_vector[3] = forward_ang_vel + lateral_ang_vel * s_roll * t_pitch +
+                    downward_ang_vel * c_roll * t_pitch;
+  // pitch angle angular velocity
+  state_vector[4] = lateral_ang_vel * c_roll - downward_ang_vel * s_roll;
+  // yaw angle angular velocity
+  state_vector[5] = 1.0 / attitude.cos_pitch() *
+                    (lateral_ang_vel * s_roll + downward_ang_vel * c_roll);
+  // body accelerations and angular accelerations
+  std::array<double, 6> accelerations{aircrafts_body_accelerations(
+      forward_vel, lateral_vel, downward_vel, forward_ang_vel, lateral_ang_vel,
+      downward_ang_vel, mass, force_vector, moment_vector, inertia_tensor)};
+  for (std::size_t i = 0; i < 6; ++i) {
+    state_vector[6 + i] = accelerations[i];
+  }
 
   return state_vector;
 }
 
-#endif // !
+// Calculate the aircraft's equations of motion from a state vector
+inline std::array<double, 12>
+aircrafts_EOM(const aircraft_state &state, double mass,
+              const std::array<double, 3> &force_vector,
+              const std::array<double, 3> &moment_vector,
+              const std::array<std::array<double, 3>, 3> &inertia_tensor) {
+  return aircrafts_EOM(state,
+                       direction_cosine_matrix{state[STATE_ROLL],
+                                               state[STATE_PITCH],
+                                               state[STATE_YAW]},
+                       mass, force_vector, moment_vector, inertia_tensor);
+}
+
+// Calculate the aircraft's equations of motion
+inline std::array<double, 12>
+aircrafts_EOM(double earth_pos_x, double earth_pos_y, double earth_pos_z,
+              double roll, double pitch, double yaw, double forward_vel,
+              double lateral_vel, double downward_vel, double forward_ang_vel,
+              double lateral_ang_vel, double downward_ang_vel, double mass,
+              std::array<double, 3> force_vector,
+              std::array<double, 3> moment_vector,
+              std::array<std::array<double, 3>, 3> inertia_tensor) {
+  return aircrafts_EOM(
+      aircraft_state{earth_pos_x, earth_pos_y, earth_pos_z, roll, pitch, yaw,
+                     forward_vel, lateral_vel, downward_vel, forward_ang_vel,
+                     lateral_ang_vel, downward_ang_vel},
+      mass, force_vector, moment_vector, inertia_tensor);
+}
+
+// Calculate the aircraft's equations of motion with precomputed mass
+// properties, from the sines and cosines of the Euler angles. Scalar may
+// also be a dual number (autodiff.hpp) over mass properties of doubles.
+template <typename Scalar, typename MassScalar, inertia_symmetry SYMMETRY>
+inline std::array<Scalar, 12>
+aircrafts_EOM(const std::array<Scalar, 12> &state, const Scalar &s_roll,
+              const Scalar &c_roll, const Scalar &s_pitch,
+              const Scalar &c_pitch, const Scalar &s_yaw, const Scalar &c_yaw,
+              const mass_properties<MassScalar, SYMMETRY> &mass_properties,
+              const std::array<Scalar, 3> &force_vector,
+              const std::array<Scalar, 3> &moment_vector) {
+  Scalar u{state[STATE_FORWARD_VEL]};
+  Scalar v{state[STATE_LATERAL_VEL]};
+  Scalar w{state[STATE_DOWNWARD_VEL]};
+  Scalar p{state[STATE_FORWARD_ANG_VEL]};
+  Scalar q{state[STATE_LATERAL_ANG_VEL]};
+  Scalar r{state[STATE_DOWNWARD_ANG_VEL]};
+  Scalar inverse_c_pitch{MassScalar(1) / c_pitch};
+  MassScalar inverse_mass{mass_properties.inverse_mass()};
+
+  std::array<Scalar, 12> state_vector;
+
+  // inertial velocity
+  state_vector[0] = u * c_pitch * c_yaw +
+                    v * (s_roll * s_pitch * c_yaw - c_roll * s_yaw) +
+                    w * (c_roll * s_pitch * c_yaw + s_roll * s_yaw);
+  state_vector[1] = u * c_pitch * s_yaw +
+                    v * (s_roll * s_pitch * s_yaw + c_roll * c_yaw) +
+                    w * (c_roll * s_pitch * s_yaw - s_roll * c_yaw);
+  state_vector[2] = -u * s_pitch + v * s_roll * c_pitch + w * c_roll * c_pitch;
+  // Euler angle rates
+  Scalar q_s_roll_r_c_roll{q * s_roll + r * c_roll};
+  state_vector[3] = p + q_s_roll_r_c_roll * s_pitch * inverse_c_pitch;
+  state_vector[4] = q * c_roll - r * s_roll;
+  state_vector[5] = q_s_roll_r_c_roll * inverse_c_pitch;
+  // body accelerations
+  state_vector[6] = r * v - q * w + force_vector[0] * inverse_mass;
+  state_vector[7] = p * w - r * u + force_vector[1] * inverse_mass;
+  state_vector[8] = q * u - p * v + force_vector[2] * inverse_mass;
+  // angular accelerations
+  std::array<Scalar, 3> angular_acceleration{
+      mass_properties.angular_acceleration(p, q, r, moment_vector)};
+  state_vector[9] = angular_acceleration[0];
+  state_vector[10] = angular_acceleration[1];
+  state_vector[11] = angular_acceleration[2];
+
+  return state_vector;
+}
+
+// Calculate the aircraft's equations of motion with precomputed mass
+// properties (float, double or dual states)
+template <typename Scalar, typename MassScalar, inertia_symmetry SYMMETRY>
+inline std::array<Scalar, 12>
+aircrafts_EOM(const std::array<Scalar, 12> &state,
+              const mass_properties<MassScalar, SYMMETRY> &mass_properties,
+              const std::array<Scalar, 3> &force_vector,
+              const std::array<Scalar, 3> &moment_vector) {
+  using std::cos;
+  using std::sin;
+  return aircrafts_EOM(state, sin(state[STATE_ROLL]), cos(state[STATE_ROLL]),
+                       sin(state[STATE_PITCH]), cos(state[STATE_PITCH]),
+                       sin(state[STATE_YAW]), cos(state[STATE_YAW]),
+                       mass_properties, force_vector, moment_vector);
+}
+
+// Calculate the aircraft's equations of motion with precomputed mass
+// properties and a direction cosine matrix of the state's attitude. The
+// inertial velocity uses the matrix itself instead of rebuilding its
+// elements from the sines and cosines.
+template <inertia_symmetry SYMMETRY>
+inline std::array<double, 12>
+aircrafts_EOM(const aircraft_state &state,
+              const direction_cosine_matrix &attitude,
+              const mass_properties<double, SYMMETRY> &mass_properties,
+              const std::array<double, 3> &force_vector,
+              const std::array<double, 3> &moment_vector) {
+  double u{state[STATE_FORWARD_VEL]};
+  double v{state[STATE_LATERAL_VEL]};
+  double w{state[STATE_DOWNWARD_VEL]};
+  double p{state[STATE_FORWARD_ANG_VEL]};
+  double q{state[STATE_LATERAL_ANG_VEL]};
+  double r{state[STATE_DOWNWARD_ANG_VEL]};
+  double s_roll{attitude.sin_roll()};
+  double c_roll{attitude.cos_roll()};
+  double inverse_c_pitch{1.0 / attitude.cos_pitch()};
+  double inverse_mass{mass_properties.inverse_mass()};
+
+  std::array<double, 12> state_vector;
+
+  // inertial velocity
+  std::array<double, 3> earth_vel{attitude.body_to_earth({u, v, w})};
+  state_vector[0] = earth_vel[0];
+  state_vector[1] = earth_vel[1];
+  state_vector[2] = earth_vel[2];
+  // Euler angle rates
+  double q_s_roll_r_c_roll{q * s_roll + r * c_roll};
+  state_vector[3] =
+      p + q_s_roll_r_c_roll * attitude.sin_pitch() * inverse_c_pitch;
+  state_vector[4] = q * c_roll - r * s_roll;
+  state_vector[5] = q_s_roll_r_c_roll * inverse_c_pitch;
+  // body accelerations
+  state_vector[6] = r * v - q * w + force_vector[0] * inverse_mass;
+  state_vector[7] = p * w - r * u + force_vector[1] * inverse_mass;
+  state_vector[8] = q * u - p * v + force_vector[2] * inverse_mass;
+  // angular accelerations
+  std::array<double, 3> angular_acceleration{
+      mass_properties.angular_acceleration(p, q, r, moment_vector)};
+  state_vector[9] = angular_acceleration[0];
+  state_vector[10] = angular_acceleration[1];
+  state_vector[11] = angular_acceleration[2];
+
+  return state_vector;
+}
+
+// Aircraft dynamics for the integrators (integrators.hpp): the equations of
+// motion with the forces and moments of a user model. ForceModel is called
+// as model(time_s, state, force_vector, moment_vector) and fills the total
+// body-axes force (including gravity) and moment. A model that also accepts
+// the attitude, model(time_s, state, attitude, force_vector, moment_vector),
+// gets the direction cosine matrix used by the EOM instead of rotating with
+// the angles again. When the model is inlined the compiler usually merges
+// the repeated sines and cosines itself, so this saves time mainly for
+// models compiled separately. The inertia terms are precomputed in
+// MassProperties (see massproperties.hpp).
+template <typename ForceModel,
+          typename MassProperties = mass_properties<double>>
+class aircraft_dynamics {
+  static_assert(
+      std::is_same_v<typename MassProperties::scalar_type, double>,
+      "aircraft_dynamics works on aircraft_state, which holds doubles");
+
+public:
+  aircraft_dynamics(double mass,
+                    const std::array<std::array<double, 3>, 3> &inertia_tensor,
+                    ForceModel force_model)
+      : m_mass_properties{mass, inertia_tensor},
+        m_force_model{std::move(force_model)} {}
+
+  aircraft_dynamics(const MassProperties &mass_properties,
+                    ForceModel force_model)
+      : m_mass_properties{mass_properties},
+        m_force_model{std::move(force_model)} {}
+
+  void operator()(double time_s, const aircraft_state &state,
+                  aircraft_state &derivative) {
+    std::array<double, 3> force_vector{0.0};
+    std::array<double, 3> moment_vector{0.0};
+    direction_cosine_matrix attitude{state[STATE_ROLL], state[STATE_PITCH],
+                                     state[STATE_YAW]};
+    if constexpr (std::is_invocable_v<ForceModel &, double,
+                                      const aircraft_state &,
+                                      const direction_cosine_matrix &,
+                                      std::array<double, 3> &,
+                                      std::array<double, 3> &>) {
+      m_force_model(time_s, state, attitude, force_vector, moment_vector);
+    } else {
+      m_force_model(time_s, state, force_vector, moment_vector);
+    }
+    derivative = aircrafts_EOM(state, attitude, m_mass_properties,
+                               force_vector, moment_vector);
+  }
+
+  ForceModel &force_model() { return m_force_model; }
+  const MassProperties &mass_properties() const { return m_mass_properties; }
+
+private:
+  MassProperties m_mass_properties;
+  ForceModel m_force_model;
+};
+
+// positions of the states in the quaternion form of the state vector: the
+// Euler angles are replaced by the attitude quaternion, whose kinematics are
+// polynomial and have no singularity at pitch = +-90 deg
+enum aircraft_quaternion_state_index : std::size_t {
+  QUAT_STATE_EARTH_POS_X,
+  QUAT_STATE_EARTH_POS_Y,
+  QUAT_STATE_EARTH_POS_Z,
+  QUAT_STATE_W,
+  QUAT_STATE_X,
+  QUAT_STATE_Y,
+  QUAT_STATE_Z,
+  QUAT_STATE_FORWARD_VEL,
+  QUAT_STATE_LATERAL_VEL,
+  QUAT_STATE_DOWNWARD_VEL,
+  QUAT_STATE_FORWARD_ANG_VEL,
+  QUAT_STATE_LATERAL_ANG_VEL,
+  QUAT_STATE_DOWNWARD_ANG_VEL,
+  AIRCRAFT_QUATERNION_STATE_SIZE
+};
+
+using aircraft_quaternion_state =
+    std::array<double, AIRCRAFT_QUATERNION_STATE_SIZE>;
+
+// rate at which aircrafts_quaternion_EOM pulls the quaternion norm back to
+// one (the drift left by the integrator decays as exp(-2 gain t))
+const double QUATERNION_NORM_GAIN_1ps{1.0};
+
+inline quaternion state_quaternion(const aircraft_quaternion_state &state) {
+  return {state[QUAT_STATE_W], state[QUAT_STATE_X], state[QUAT_STATE_Y],
+          state[QUAT_STATE_Z]};
+}
+
+// Function to convert an Euler angle state to the quaternion form
+inline aircraft_quaternion_state
+to_quaternion_state(const aircraft_state &state) {
+  quaternion q{euler_to_quaternion(state[STATE_ROLL], state[STATE_PITCH],
+                                   state[STATE_YAW])};
+  aircraft_quaternion_state quaternion_state{0.0};
+  quaternion_state[QUAT_STATE_EARTH_POS_X] = state[STATE_EARTH_POS_X];
+  quaternion_state[QUAT_STATE_EARTH_POS_Y] = state[STATE_EARTH_POS_Y];
+  quaternion_state[QUAT_STATE_EARTH_POS_Z] = state[STATE_EARTH_POS_Z];
+  quaternion_state[QUAT_STATE_W] = q.w;
+  quaternion_state[QUAT_STATE_X] = q.x;
+  quaternion_state[QUAT_STATE_Y] = q.y;
+  quaternion_state[QUAT_STATE_Z] = q.z;
+  for (std::size_t i = 0; i < 6; ++i) {
+    quaternion_state[QUAT_STATE_FORWARD_VEL + i] = state[STATE_FORWARD_VEL + i];
+  }
+  return quaternion_state;
+}
+
+// Function to convert a quaternion state to the Euler angle form
+inline aircraft_state
+to_euler_state(const aircraft_quaternion_state &state) {
+  std::array<double, 3> euler{
+      quaternion_to_euler(normalize(state_quaternion(state)))};
+  aircraft_state euler_state{0.0};
+  euler_state[STATE_EARTH_POS_X] = state[QUAT_STATE_EARTH_POS_X];
+  euler_state[STATE_EARTH_POS_Y] = state[QUAT_STATE_EARTH_POS_Y];
+  euler_state[STATE_EARTH_POS_Z] = state[QUAT_STATE_EARTH_POS_Z];
+  euler_state[STATE_ROLL] = euler[0];
+  euler_state[STATE_PITCH] = euler[1];
+  euler_state[STATE_YAW] = euler[2];
+  for (std::size_t i = 0; i < 6; ++i) {
+    euler_state[STATE_FORWARD_VEL + i] = state[QUAT_STATE_FORWARD_VEL + i];
+  }
+  return euler_state;
+}
+
+// Function to rescale the quaternion of a state to unit norm, e.g. after
+// every accepted integration step
+inline void normalize_quaternion(aircraft_quaternion_state &state) {
+  quaternion q{normalize(state_quaternion(state))};
+  state[QUAT_STATE_W] = q.w;
+  state[QUAT_STATE_X] = q.x;
+  state[QUAT_STATE_Y] = q.y;
+  state[QUAT_STATE_Z] = q.z;
+}
+
+// Calculate the kinematic part of the quaternion form of the equations of
+// motion (earth velocity and quaternion rates, entries 0 to 6)
+inline void aircrafts_quaternion_kinematics(
+    const aircraft_quaternion_state &state,
+    const direction_cosine_matrix &attitude, double norm_gain,
+    std::array<double, 13> &state_vector) {
+  double forward_vel{state[QUAT_STATE_FORWARD_VEL]};
+  double lateral_vel{state[QUAT_STATE_LATERAL_VEL]};
+  double downward_vel{state[QUAT_STATE_DOWNWARD_VEL]};
+  double p{state[QUAT_STATE_FORWARD_ANG_VEL]};
+  double q{state[QUAT_STATE_LATERAL_ANG_VEL]};
+  double r{state[QUAT_STATE_DOWNWARD_ANG_VEL]};
+  quaternion att{state_quaternion(state)};
+
+  // inertial velocity
+  std::array<double, 3> earth_vel{
+      attitude.body_to_earth({forward_vel, lateral_vel, downward_vel})};
+  state_vector[0] = earth_vel[0];
+  state_vector[1] = earth_vel[1];
+  state_vector[2] = earth_vel[2];
+  // quaternion rates with the norm correction
+  double correction{norm_gain * (1.0 - (att.w * att.w + att.x * att.x +
+                                        att.y * att.y + att.z * att.z))};
+  state_vector[3] =
+      -0.5 * (att.x * p + att.y * q + att.z * r) + correction * att.w;
+  state_vector[4] =
+      0.5 * (att.w * p + att.y * r - att.z * q) + correction * att.x;
+  state_vector[5] =
+      0.5 * (att.w * q + att.z * p - att.x * r) + correction * att.y;
+  state_vector[6] =
+      0.5 * (att.w * r + att.x * q - att.y * p) + correction * att.z;
+}
+
+// Calculate the aircraft's equations of motion in quaternion form. attitude
+// must be built from the state's quaternion. The quaternion derivative is
+// 0.5 q (0, p, q, r) plus norm_gain (1 - |q|^2) q, which keeps |q| at one
+// without changing the attitude.
+inline std::array<double, 13> aircrafts_quaternion_EOM(
+    const aircraft_quaternion_state &state,
+    const direction_cosine_matrix &attitude, double mass,
+    const std::array<double, 3> &force_vector,
+    const std::array<double, 3> &moment_vector,
+    const std::array<std::array<double, 3>, 3> &inertia_tensor,
+    double norm_gain = QUATERNION_NORM_GAIN_1ps) {
+  std::array<double, 13> state_vector{0.0};
+  aircrafts_quaternion_kinematics(state, attitude, norm_gain, state_vector);
+  // body accelerations and angular accelerations
+  std::array<double, 6> accelerations{aircrafts_body_accelerations(
+      state[QUAT_STATE_FORWARD_VEL], state[QUAT_STATE_LATERAL_VEL],
+      state[QUAT_STATE_DOWNWARD_VEL], state[QUAT_STATE_FORWARD_ANG_VEL],
+      state[QUAT_STATE_LATERAL_ANG_VEL], state[QUAT_STATE_DOWNWARD_ANG_VEL],
+      mass, force_vector, moment_vector, inertia_tensor)};
+  for (std::size_t i = 0; i < 6; ++i) {
+    state_vector[7 + i] = accelerations[i];
+  }
+
+  return state_vector;
+}
+
+// Calculate the aircraft's equations of motion in quaternion form with
+// precomputed mass properties
+template <inertia_symmetry SYMMETRY>
+inline std::array<double, 13> aircrafts_quaternion_EOM(
+    const aircraft_quaternion_state &state,
+    const direction_cosine_matrix &attitude,
+    const mass_properties<double, SYMMETRY> &mass_properties,
+    const std::array<double, 3> &force_vector,
+    const std::array<double, 3> &moment_vector,
+    double norm_gain = QUATERNION_NORM_GAIN_1ps) {
+  double u{state[QUAT_STATE_FORWARD_VEL]};
+  double v{state[QUAT_STATE_LATERAL_VEL]};
+  double w{state[QUAT_STATE_DOWNWARD_VEL]};
+  double p{state[QUAT_STATE_FORWARD_ANG_VEL]};
+  double q{state[QUAT_STATE_LATERAL_ANG_VEL]};
+  double r{state[QUAT_STATE_DOWNWARD_ANG_VEL]};
+  double inverse_mass{mass_properties.inverse_mass()};
+
+  std::array<double, 13> state_vector;
+  aircrafts_quaternion_kinematics(state, attitude, norm_gain, state_vector);
+  // body accelerations
+  state_vector[7] = r * v - q * w + force_vector[0] * inverse_mass;
+  state_vector[8] = p * w - r * u + force_vector[1] * inverse_mass;
+  state_vector[9] = q * u - p * v + force_vector[2] * inverse_mass;
+  // angular accelerations
+  std::array<double, 3> angular_acceleration{
+      mass_properties.angular_acceleration(p, q, r, moment_vector)};
+  state_vector[10] = angular_acceleration[0];
+  state_vector[11] = angular_acceleration[1];
+  state_vector[12] = angular_acceleration[2];
+
+  return state_vector;
+}
+
+inline std::array<double, 13> aircrafts_quaternion_EOM(
+    const aircraft_quaternion_state &state, double mass,
+    const std::array<double, 3> &force_vector,
+    const std::array<double, 3> &moment_vector,
+    const std::array<std::array<double, 3>, 3> &inertia_tensor,
+    double norm_gain = QUATERNION_NORM_GAIN_1ps) {
+  return aircrafts_quaternion_EOM(
+      state, direction_cosine_matrix{state_quaternion(state)}, mass,
+      force_vector, moment_vector, inertia_tensor, norm_gain);
+}
+
+// Quaternion form of aircraft_dynamics, for aerobatic or spinning flight.
+// ForceModel is called as model(time_s, state, attitude, force_vector,
+// moment_vector) or model(time_s, state, force_vector, moment_vector) with
+// the quaternion state. The inertia terms are precomputed in MassProperties
+// (see massproperties.hpp).
+template <typename ForceModel,
+          typename MassProperties = mass_properties<double>>
+class aircraft_quaternion_dynamics {
+  static_assert(std::is_same_v<typename MassProperties::scalar_type, double>,
+                "aircraft_quaternion_dynamics works on "
+                "aircraft_quaternion_state, which holds doubles");
+
+public:
+  aircraft_quaternion_dynamics(
+      double mass, const std::array<std::array<double, 3>, 3> &inertia_tensor,
+      ForceModel force_model, double norm_gain = QUATERNION_NORM_GAIN_1ps)
+      : m_mass_properties{mass, inertia_tensor},
+        m_force_model{std::move(force_model)}, m_norm_gain{norm_gain} {}
+
+  aircraft_quaternion_dynamics(const MassProperties &mass_properties,
+                               ForceModel force_model,
+                               double norm_gain = QUATERNION_NORM_GAIN_1ps)
+      : m_mass_properties{mass_properties},
+        m_force_model{std::move(force_model)}, m_norm_gain{norm_gain} {}
+
+  void operator()(double time_s, const aircraft_quaternion_state &state,
+                  aircraft_quaternion_state &derivative) {
+    std::array<double, 3> force_vector{0.0};
+    std::array<double, 3> moment_vector{0.0};
+    direction_cosine_matrix attitude{state_quaternion(state)};
+    if constexpr (std::is_invocable_v<ForceModel &, double,
+                                      const aircraft_quaternion_state &,
+                                      const direction_cosine_matrix &,
+                                      std::array<double, 3> &,
+                                      std::array<double, 3> &>) {
+      m_force_model(time_s, state, attitude, force_vector, moment_vector);
+    } else {
+      m_force_model(time_s, state, force_vector, moment_vector);
+    }
+    derivative =
+        aircrafts_quaternion_EOM(state, attitude, m_mass_properties,
+                                 force_vector, moment_vector, m_norm_gain);
+  }
+
+  ForceModel &force_model() { return m_force_model; }
+  const MassProperties &mass_properties() const { return m_mass_properties; }
+
+private:
+  MassProperties m_mass_properties;
+  ForceModel m_force_model;
+  double m_norm_gain;
+};
+
+// Structure-of-arrays view of many aircraft: element c points to the values
+// of state component c for consecutive aircraft (forces and moments use
+// vector_arrays from framesnrotations.hpp)
+using aircraft_state_arrays = std::array<double *, AIRCRAFT_STATE_SIZE>;
+
+// mass properties of many aircraft, one entry per aircraft. The inertia
+// entries are elements of the inertia tensor as passed to aircrafts_EOM
+// ([0][0], [1][1], [2][2] and [0][2]).
+struct aircraft_mass_arrays {
+  double *mass;
+  double *inertia_xx;
+  double *inertia_yy;
+  double *inertia_zz;
+  double *inertia_xz;
+};
+
+// Calculate the equations of motion of count aircraft stored as structure of
+// arrays; same equations as aircrafts_EOM, in a loop that the compiler
+// vectorizes
+inline void aircrafts_EOM_batch(std::size_t count,
+                                const aircraft_state_arrays &state,
+                                const aircraft_mass_arrays &mass_properties,
+                                const vector_arrays &force,
+                                const vector_arrays &moment,
+                                const aircraft_state_arrays &derivative) {
+  // local copies of the pointers, so the loop does not reload them after
+  // every store
+  const aircraft_state_arrays x{state};
+  const aircraft_state_arrays dx{derivative};
+  const vector_arrays F{force};
+  const vector_arrays M{moment};
+  const aircraft_mass_arrays m{mass_properties};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double s_roll, c_roll, s_pitch, c_pitch, s_yaw, c_yaw;
+    batch_sincos(x[STATE_ROLL][i], s_roll, c_roll);
+    batch_sincos(x[STATE_PITCH][i], s_pitch, c_pitch);
+    batch_sincos(x[STATE_YAW][i], s_yaw, c_yaw);
+    double t_pitch{s_pitch / c_pitch};
+
+    double u{x[STATE_FORWARD_VEL][i]};
+    double v{x[STATE_LATERAL_VEL][i]};
+    double w{x[STATE_DOWNWARD_VEL][i]};
+    double p{x[STATE_FORWARD_ANG_VEL][i]};
+    double q{x[STATE_LATERAL_ANG_VEL][i]};
+    double r{x[STATE_DOWNWARD_ANG_VEL][i]};
+
+    // inertial velocities
+    dx[STATE_EARTH_POS_X][i] =
+        u * c_pitch * c_yaw +
+        v * (s_roll * s_pitch * c_yaw - c_roll * s_yaw) +
+        w * (c_roll * s_pitch * c_yaw + s_roll * s_yaw);
+    dx[STATE_EARTH_POS_Y][i] =
+        u * c_pitch * s_yaw +
+        v * (s_roll * s_pitch * s_yaw + c_roll * c_yaw) +
+        w * (c_roll * s_pitch * s_yaw - s_roll * c_yaw);
+    dx[STATE_EARTH_POS_Z][i] =
+        -u * s_pitch + v * s_roll * c_pitch + w * c_roll * c_pitch;
+    // Euler angle rates
+    dx[STATE_ROLL][i] = p + q * s_roll * t_pitch + r * c_roll * t_pitch;
+    dx[STATE_PITCH][i] = q * c_roll - r * s_roll;
+    dx[STATE_YAW][i] = (q * s_roll + r * c_roll) / c_pitch;
+
+    // body accelerations
+    double mass{m.mass[i]};
+    dx[STATE_FORWARD_VEL][i] = r * v - q * w + F[0][i] / mass;
+    dx[STATE_LATERAL_VEL][i] = p * w - r * u + F[1][i] / mass;
+    dx[STATE_DOWNWARD_VEL][i] = q * u - p * v + F[2][i] / mass;
+
+    // angular accelerations
+    double Ixx{m.inertia_xx[i]};
+    double Iyy{m.inertia_yy[i]};
+    double Izz{m.inertia_zz[i]};
+    double Ixz{-m.inertia_xz[i]};
+    double determinant{Ixx * Izz - Ixz * Ixz};
+    dx[STATE_FORWARD_ANG_VEL][i] =
+        (Ixz * M[2][i] + Izz * M[0][i] + Ixz * (Ixx - Iyy + Izz) * p * q -
+         (Ixz * Ixz - Iyy * Izz + Izz * Izz) * q * r) /
+        determinant;
+    dx[STATE_LATERAL_ANG_VEL][i] =
+        (M[1][i] - (Ixx - Izz) * r * p - Ixz * (p * p - r * r)) / Iyy;
+    dx[STATE_DOWNWARD_ANG_VEL][i] =
+        (Ixx * M[2][i] + Ixz * M[0][i] - Ixz * (Ixx - Iyy + Izz) * r * q +
+         (Ixz * Ixz - Iyy * Ixx + Ixx * Ixx) * q * p) /
+        determinant;
+  }
+}
+
+#endif // !AIRCRAFTMOTION_HPP
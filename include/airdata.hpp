@@ -0,0 +1,354 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef AIRDATA_HPP
+#define AIRDATA_HPP
+
+// Air data derived from the ISA model in one evaluation, and the inverse
+// conversions (CAS -> TAS, Mach -> CAS, pressure -> pressure altitude) in
+// closed form. Airspeeds use the subsonic compressible (isentropic) pitot
+// relations, the same as calibrated_airspeed().
+
+#include "atmosphere.hpp"
+#include "fastmath.hpp"
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+// everything derived from one height/true airspeed pair. When status is not
+// ISA_VALID only the temperature, sound speed and Mach number are meaningful.
+struct air_data {
+  double temperature_K;
+  double pressure_Pa;
+  double density_kgpm3;
+  double sound_speed_mps;
+  double Mach_number;
+  double dynamic_pressure_Pa;
+  double impact_pressure_Pa;
+  double calibrated_airspeed_mps;
+  double equivalent_airspeed_mps;
+  ISA_status status;
+};
+
+// output arrays of the batch version of compute_air_data (all of size count)
+struct air_data_arrays {
+  double *temperature_K;
+  double *pressure_Pa;
+  double *density_kgpm3;
+  double *sound_speed_mps;
+  double *Mach_number;
+  double *dynamic_pressure_Pa;
+  double *impact_pressure_Pa;
+  double *calibrated_airspeed_mps;
+  double *equivalent_airspeed_mps;
+  ISA_status *status;
+};
+
+// function to calculate the impact pressure (pitot minus static) for a Mach
+// number
+inline double impact_pressure(double Mach_number, double pressure_Pa) {
+  double ratio{0.5 * (HEAT_CAPACITY_RATIO - 1) * Mach_number * Mach_number +
+               1};
+  return pressure_Pa *
+         (std::pow(ratio, HEAT_CAPACITY_RATIO / (HEAT_CAPACITY_RATIO - 1)) - 1);
+}
+
+// function to calculate the calibrated airspeed that gives an impact
+// pressure at sea level
+inline double calibrated_airspeed_from_impact_pressure(
+    double impact_pressure_Pa) {
+  return std::sqrt(2 * SOUND_SPEED_SEALEVEL_mps * SOUND_SPEED_SEALEVEL_mps /
+                   (HEAT_CAPACITY_RATIO - 1) *
+                   (std::pow(impact_pressure_Pa / PRESSURE_SEALEVEL_Pa + 1,
+                             (HEAT_CAPACITY_RATIO - 1) / HEAT_CAPACITY_RATIO) -
+                    1));
+}
+
+// function to calculate the Mach number that gives an impact pressure at a
+// static pressure (inverse of impact_pressure)
+inline double Mach_from_impact_pressure(double impact_pressure_Pa,
+                                        double pressure_Pa) {
+  return std::sqrt(2 / (HEAT_CAPACITY_RATIO - 1) *
+                   (std::pow(impact_pressure_Pa / pressure_Pa + 1,
+                             (HEAT_CAPACITY_RATIO - 1) / HEAT_CAPACITY_RATIO) -
+                    1));
+}
+
+// sea level density of the ISA model, the reference of the equivalent
+// airspeed (DENSITY_SEALEVEL_kgpm3 is rounded, so that EAS would differ
+// from TAS at sea level)
+inline double ISA_density_sealevel() {
+  static const double density_kgpm3{ISA_density(
+      ISA_temperature(0.0), ISA_airpressure(ISA_temperature(0.0), 0.0))};
+  return density_kgpm3;
+}
+
+// function to calculate all the air data for a height and true airspeed,
+// evaluating the atmosphere once
+inline air_data compute_air_data(double height_m, double true_air_speed_mps) {
+  air_data data{};
+  data.temperature_K = ISA_temperature(height_m);
+  data.pressure_Pa =
+      ISA_airpressure(data.temperature_K, height_m, data.status);
+  data.density_kgpm3 = ISA_density(data.temperature_K, data.pressure_Pa);
+  data.sound_speed_mps = ISA_soundspeed(data.temperature_K);
+  data.Mach_number = true_air_speed_mps / data.sound_speed_mps;
+  data.dynamic_pressure_Pa =
+      0.5 * data.density_kgpm3 * true_air_speed_mps * true_air_speed_mps;
+  data.impact_pressure_Pa =
+      impact_pressure(data.Mach_number, data.pressure_Pa);
+  data.calibrated_airspeed_mps =
+      calibrated_airspeed_from_impact_pressure(data.impact_pressure_Pa);
+  data.equivalent_airspeed_mps =
+      true_air_speed_mps *
+      std::sqrt(data.density_kgpm3 / ISA_density_sealevel());
+  return data;
+}
+
+// function to calculate the true airspeed from the calibrated airspeed
+inline double true_airspeed_from_calibrated(double calibrated_airspeed_mps,
+                                            double height_m) {
+  double temperature_K{ISA_temperature(height_m)};
+  double pressure_Pa{ISA_airpressure(temperature_K, height_m)};
+  // CAS is defined by the impact pressure at sea level
+  double impact_pressure_Pa{
+      impact_pressure(calibrated_airspeed_mps / SOUND_SPEED_SEALEVEL_mps,
+                      PRESSURE_SEALEVEL_Pa)};
+  return Mach_from_impact_pressure(impact_pressure_Pa, pressure_Pa) *
+         ISA_soundspeed(temperature_K);
+}
+
+// function to calculate the calibrated airspeed from the Mach number
+inline double calibrated_airspeed_from_Mach(double Mach_number,
+                                            double height_m) {
+  double pressure_Pa{ISA_airpressure(ISA_temperature(height_m), height_m)};
+  return calibrated_airspeed_from_impact_pressure(
+      impact_pressure(Mach_number, pressure_Pa));
+}
+
+// index of the ISA layer containing a (positive) pressure, branch-free
+inline int ISA_pressure_layer_index(const ISA_layer *layers,
+                                    double pressure_Pa) {
+  int index{0};
+#pragma GCC unroll 8
+  for (std::size_t i = 1; i < ISA_LAYER_BASE_HEIGHTS_m.size(); ++i) {
+    index += pressure_Pa < layers[i].base_pressure_Pa;
+  }
+  return index;
+}
+
+// function to calculate the pressure altitude (the ISA height with a given
+// static pressure). Outside the model the layer formulas are extrapolated and
+// status tells which side. A pressure that is not positive (including the -1
+// of ISA_airpressure outside the model) or NaN gives NaN and
+// ISA_INVALID_INPUT.
+inline double pressure_altitude(double pressure_Pa, ISA_status &status) {
+  if (!(pressure_Pa > 0.0)) {
+    status = ISA_INVALID_INPUT;
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  const ISA_layer *layers{ISA_layers().data()};
+  const ISA_layer &layer{layers[ISA_pressure_layer_index(layers, pressure_Pa)]};
+  double height_m{0.0};
+  if (layer.lapse_rate_Kpm != 0.0)
+  // layer with a temperature gradient
+  {
+    double temperature_K{layer.base_temperature_K *
+                         std::pow(pressure_Pa / layer.base_pressure_Pa,
+                                  1.0 / layer.pow_coeff)};
+    height_m = layer.base_height_m +
+               (temperature_K - layer.base_temperature_K) /
+                   layer.lapse_rate_Kpm;
+  } else
+  // isothermal layer
+  {
+    height_m =
+        layer.base_height_m +
+        std::log(pressure_Pa / layer.base_pressure_Pa) / layer.iso_coeff;
+  };
+  status = ISA_height_status(height_m);
+  return height_m;
+}
+
+// function to calculate the pressure altitude
+inline double pressure_altitude(double pressure_Pa) {
+  ISA_status status{ISA_VALID};
+  return pressure_altitude(pressure_Pa, status);
+}
+
+// batch version of compute_air_data
+inline void compute_air_data(const double *height_m,
+                             const double *true_air_speed_mps,
+                             std::size_t count, const air_data_arrays &out) {
+  const ISA_layer *layers{ISA_layers().data()};
+  const double exponent{HEAT_CAPACITY_RATIO / (HEAT_CAPACITY_RATIO - 1)};
+  const double inverse_exponent{(HEAT_CAPACITY_RATIO - 1) /
+                                HEAT_CAPACITY_RATIO};
+  const double density_sealevel{ISA_density_sealevel()};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double h{height_m[i]};
+    double tas{true_air_speed_mps[i]};
+    double temperature{0.0}, pressure{0.0};
+    ISA_batch_state(layers, h, temperature, pressure);
+
+    double density{pressure / UNIVERSAL_GAS_CONSTANT_JpKpkg / temperature};
+    double sound_speed{std::sqrt(temperature * UNIVERSAL_GAS_CONSTANT_JpKpkg *
+                                 HEAT_CAPACITY_RATIO)};
+    double Mach{tas / sound_speed};
+    double qc{pressure *
+              (batch_pow(0.5 * (HEAT_CAPACITY_RATIO - 1) * Mach * Mach + 1,
+                         exponent) -
+               1)};
+    double cas{std::sqrt(
+        2 * SOUND_SPEED_SEALEVEL_mps * SOUND_SPEED_SEALEVEL_mps /
+        (HEAT_CAPACITY_RATIO - 1) *
+        (batch_pow(qc / PRESSURE_SEALEVEL_Pa + 1, inverse_exponent) - 1))};
+
+    out.temperature_K[i] = temperature;
+    out.pressure_Pa[i] = pressure;
+    out.density_kgpm3[i] = density;
+    out.sound_speed_mps[i] = sound_speed;
+    out.Mach_number[i] = Mach;
+    out.dynamic_pressure_Pa[i] = 0.5 * density * tas * tas;
+    out.impact_pressure_Pa[i] = qc;
+    out.calibrated_airspeed_mps[i] = cas;
+    out.equivalent_airspeed_mps[i] =
+        tas * std::sqrt(density / density_sealevel);
+    out.status[i] = ISA_height_status(h);
+  }
+}
+
+// batch version of true_airspeed_from_calibrated
+inline void true_airspeed_from_calibrated(const double *calibrated_airspeed_mps,
+                                          const double *height_m,
+                                          std::size_t count,
+                                          double *true_air_speed_mps) {
+  const ISA_layer *layers{ISA_layers().data()};
+  const double exponent{HEAT_CAPACITY_RATIO / (HEAT_CAPACITY_RATIO - 1)};
+  const double inverse_exponent{(HEAT_CAPACITY_RATIO - 1) /
+                                HEAT_CAPACITY_RATIO};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double temperature{0.0}, pressure{0.0};
+    ISA_batch_state(layers, height_m[i], temperature, pressure);
+
+    double cas_ratio{calibrated_airspeed_mps[i] / SOUND_SPEED_SEALEVEL_mps};
+    double qc{PRESSURE_SEALEVEL_Pa *
+              (batch_pow(0.5 * (HEAT_CAPACITY_RATIO - 1) * cas_ratio *
+                                 cas_ratio +
+                             1,
+                         exponent) -
+               1)};
+    double Mach{
+        std::sqrt(2 / (HEAT_CAPACITY_RATIO - 1) *
+                  (batch_pow(qc / pressure + 1, inverse_exponent) - 1))};
+    true_air_speed_mps[i] =
+        Mach * std::sqrt(temperature * UNIVERSAL_GAS_CONSTANT_JpKpkg *
+                         HEAT_CAPACITY_RATIO);
+  }
+}
+
+// batch version of calibrated_airspeed_from_Mach
+inline void calibrated_airspeed_from_Mach(const double *Mach_number,
+                                          const double *height_m,
+                                          std::size_t count,
+                                          double *calibrated_airspeed_mps) {
+  const ISA_layer *layers{ISA_layers().data()};
+  const double exponent{HEAT_CAPACITY_RATIO / (HEAT_CAPACITY_RATIO - 1)};
+  const double inverse_exponent{(HEAT_CAPACITY_RATIO - 1) /
+                                HEAT_CAPACITY_RATIO};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double temperature{0.0}, pressure{0.0};
+    ISA_batch_state(layers, height_m[i], temperature, pressure);
+
+    double Mach{Mach_number[i]};
+    double qc{pressure *
+              (batch_pow(0.5 * (HEAT_CAPACITY_RATIO - 1) * Mach * Mach + 1,
+                         exponent) -
+               1)};
+    calibrated_airspeed_mps[i] = std::sqrt(
+        2 * SOUND_SPEED_SEALEVEL_mps * SOUND_SPEED_SEALEVEL_mps /
+        (HEAT_CAPACITY_RATIO - 1) *
+        (batch_pow(qc / PRESSURE_SEALEVEL_Pa + 1, inverse_exponent) - 1));
+  }
+}
+
+// height inside one layer with a given pressure, for the batch loops (same
+// trade-off as ISA_layer_pressure)
+inline double ISA_layer_height(const ISA_layer &layer, double pressure_Pa) {
+#if defined(__AVX2__)
+  // both layer types, selected without branches
+  double log_ratio{fast_log(pressure_Pa / layer.base_pressure_Pa)};
+  double gradient_height{layer.base_height_m +
+                         layer.base_temperature_K *
+                             (fast_exp(log_ratio / layer.pow_coeff) - 1) /
+                             layer.lapse_rate_Kpm};
+  double isothermal_height{layer.base_height_m + log_ratio / layer.iso_coeff};
+  return layer.lapse_rate_Kpm != 0.0 ? gradient_height : isothermal_height;
+#else
+  if (layer.lapse_rate_Kpm != 0.0) {
+    return layer.base_height_m +
+           layer.base_temperature_K *
+               (std::pow(pressure_Pa / layer.base_pressure_Pa,
+                         1.0 / layer.pow_coeff) -
+                1) /
+               layer.lapse_rate_Kpm;
+  }
+  return layer.base_height_m +
+         std::log(pressure_Pa / layer.base_pressure_Pa) / layer.iso_coeff;
+#endif
+}
+
+// batch version of pressure_altitude
+inline void pressure_altitude(const double *pressure_Pa, std::size_t count,
+                              double *height_m, ISA_status *status = nullptr) {
+  const ISA_layer *layers{ISA_layers().data()};
+  const double invalid_height_m{std::numeric_limits<double>::quiet_NaN()};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double p{pressure_Pa[i]};
+    const ISA_layer &layer{layers[ISA_pressure_layer_index(layers, p)]};
+    double height{ISA_layer_height(layer, p)};
+    height_m[i] = p > 0.0 ? height : invalid_height_m;
+  }
+
+  if (status != nullptr) {
+    for (std::size_t i = 0; i < count; ++i) {
+      status[i] = pressure_Pa[i] > 0.0 ? ISA_height_status(height_m[i])
+                                       : ISA_INVALID_INPUT;
+    }
+  }
+}
+
+#endif // !AIRDATA_HPP
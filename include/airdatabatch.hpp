@@ -0,0 +1,515 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef AIRDATABATCH_HPP
+#define AIRDATABATCH_HPP
+
+// Batch conversion of (height, true airspeed) rows to air data.
+//
+// Input rows are CSV text (height_m and true airspeed in m/s separated by a
+// comma, semicolon, spaces or tabs; a header line and blank lines are
+// skipped) or binary pairs of native doubles. Output rows hold the columns
+// of AIR_DATA_COLUMN_NAMES, as CSV text (with a header line) or binary rows
+// of AIR_DATA_OUTPUT_COLUMNS native doubles (the status as 0 to 3).
+// Rows outside the ISA model (status not ISA_VALID) keep only the
+// temperature, sound speed and Mach number; the other computed columns are
+// NaN ("nan" in CSV). Rows with a NaN or infinite height (ISA_INVALID_INPUT)
+// have NaN in every computed column.
+//
+// convert_air_data runs three stages at once: a thread reads the input in
+// large blocks, the thread pool parses, evaluates (compute_air_data) and
+// formats pieces of the previous block, and another thread writes the block
+// before that. Pieces end on row boundaries and are written in input order,
+// so the output does not depend on the number of threads.
+
+#include "airdata.hpp"
+#include "threadpool.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum air_data_format : unsigned char { AIR_DATA_CSV, AIR_DATA_BINARY };
+
+// columns of the output rows
+enum air_data_output_column : std::size_t {
+  AIR_DATA_HEIGHT,
+  AIR_DATA_TRUE_AIRSPEED,
+  AIR_DATA_CALIBRATED_AIRSPEED,
+  AIR_DATA_EQUIVALENT_AIRSPEED,
+  AIR_DATA_MACH,
+  AIR_DATA_DENSITY,
+  AIR_DATA_TEMPERATURE,
+  AIR_DATA_PRESSURE,
+  AIR_DATA_SOUND_SPEED,
+  AIR_DATA_DYNAMIC_PRESSURE,
+  AIR_DATA_IMPACT_PRESSURE,
+  AIR_DATA_STATUS,
+  AIR_DATA_OUTPUT_COLUMNS
+};
+
+const std::array<const char *, AIR_DATA_OUTPUT_COLUMNS> AIR_DATA_COLUMN_NAMES{
+    "height_m",
+    "true_airspeed_mps",
+    "calibrated_airspeed_mps",
+    "equivalent_airspeed_mps",
+    "Mach_number",
+    "density_kgpm3",
+    "temperature_K",
+    "pressure_Pa",
+    "sound_speed_mps",
+    "dynamic_pressure_Pa",
+    "impact_pressure_Pa",
+    "status"};
+
+// bytes of one binary input row (height and true airspeed)
+const std::size_t AIR_DATA_BINARY_ROW_SIZE{2 * sizeof(double)};
+// bytes read from the input at once
+const std::size_t AIR_DATA_READ_SIZE{std::size_t{8} << 20};
+// bytes of input per task of the thread pool
+const std::size_t AIR_DATA_PIECE_SIZE{std::size_t{256} << 10};
+
+struct air_data_batch_options {
+  air_data_format input_format{AIR_DATA_CSV};
+  air_data_format output_format{AIR_DATA_CSV};
+  // write the header line of CSV output
+  bool header{true};
+  std::size_t read_size{AIR_DATA_READ_SIZE};
+  std::size_t piece_size{AIR_DATA_PIECE_SIZE};
+};
+
+// rows of one piece, from input to formatted output; reused between blocks
+struct air_data_piece {
+  std::vector<double> height_m;
+  std::vector<double> true_airspeed_mps;
+  // AIR_DATA_STATUS - AIR_DATA_CALIBRATED_AIRSPEED columns of results
+  std::vector<double> results;
+  std::vector<ISA_status> status;
+  std::string output;
+};
+
+// Bounded first-in first-out queue between the stages of convert_air_data.
+// push() waits while the queue is full and fails once it is closed; pop()
+// fails once it is closed and empty.
+template <typename T> class pipeline_queue {
+public:
+  explicit pipeline_queue(std::size_t capacity)
+      : m_capacity{std::max<std::size_t>(capacity, 1)} {}
+
+  bool push(T value) {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_not_full.wait(lock,
+                    [this] { return m_closed || m_items.size() < m_capacity; });
+    if (m_closed) {
+      return false;
+    }
+    m_items.push_back(std::move(value));
+    m_not_empty.notify_one();
+    return true;
+  }
+
+  bool pop(T &value) {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_not_empty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+    if (m_items.empty()) {
+      return false;
+    }
+    value = std::move(m_items.front());
+    m_items.pop_front();
+    m_not_full.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_closed = true;
+    m_not_full.notify_all();
+    m_not_empty.notify_all();
+  }
+
+private:
+  std::size_t m_capacity;
+  std::deque<T> m_items;
+  bool m_closed{false};
+  std::mutex m_mutex;
+  std::condition_variable m_not_full;
+  std::condition_variable m_not_empty;
+};
+
+// function to skip spaces and tabs
+inline const char *skip_blanks(const char *begin, const char *end) {
+  while (begin != end && (*begin == ' ' || *begin == '\t')) {
+    ++begin;
+  }
+  return begin;
+}
+
+// function to read one number of a CSV field; nullptr when there is none
+inline const char *parse_csv_number(const char *begin, const char *end,
+                                    double &value) {
+  if (begin != end && *begin == '+') {
+    ++begin;
+  }
+  std::from_chars_result result{std::from_chars(begin, end, value)};
+  return result.ec == std::errc{} ? result.ptr : nullptr;
+}
+
+// function to tell whether a line starts with a number (and so is not a
+// header line)
+inline bool starts_with_number(const char *begin, const char *end) {
+  double value;
+  return parse_csv_number(skip_blanks(begin, end), end, value) != nullptr;
+}
+
+// Function to append the rows of CSV text [begin, end) to height_m and
+// true_airspeed_mps. Blank lines are skipped; any other line that is not
+// two numbers throws std::invalid_argument.
+inline void parse_air_data_csv(const char *begin, const char *end,
+                               std::vector<double> &height_m,
+                               std::vector<double> &true_airspeed_mps) {
+  while (begin != end) {
+    const char *line_end{static_cast<const char *>(
+        std::memchr(begin, '\n', static_cast<std::size_t>(end - begin)))};
+    const char *next{line_end == nullptr ? end : line_end + 1};
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+    if (line_end != begin && line_end[-1] == '\r') {
+      --line_end;
+    }
+
+    const char *p{skip_blanks(begin, line_end)};
+    if (p != line_end) {
+      double height{0.0}, airspeed{0.0};
+      p = parse_csv_number(p, line_end, height);
+      if (p != nullptr) {
+        p = skip_blanks(p, line_end);
+        if (p != line_end && (*p == ',' || *p == ';')) {
+          p = skip_blanks(p + 1, line_end);
+        }
+        p = parse_csv_number(p, line_end, airspeed);
+      }
+      if (p == nullptr || skip_blanks(p, line_end) != line_end) {
+        throw std::invalid_argument("invalid air data row: " +
+                                    std::string(begin, line_end));
+      }
+      height_m.push_back(height);
+      true_airspeed_mps.push_back(airspeed);
+    }
+    begin = next;
+  }
+}
+
+// function to append the binary rows [begin, end) (a whole number of
+// AIR_DATA_BINARY_ROW_SIZE rows) to height_m and true_airspeed_mps
+inline void parse_air_data_binary(const char *begin, const char *end,
+                                  std::vector<double> &height_m,
+                                  std::vector<double> &true_airspeed_mps) {
+  std::size_t rows{static_cast<std::size_t>(end - begin) /
+                   AIR_DATA_BINARY_ROW_SIZE};
+  std::size_t first{height_m.size()};
+  height_m.resize(first + rows);
+  true_airspeed_mps.resize(first + rows);
+  for (std::size_t i = 0; i < rows; ++i) {
+    double pair[2];
+    std::memcpy(pair, begin + i * AIR_DATA_BINARY_ROW_SIZE, sizeof(pair));
+    height_m[first + i] = pair[0];
+    true_airspeed_mps[first + i] = pair[1];
+  }
+}
+
+// columns that are not meaningful outside the ISA model (see air_data)
+const std::array<air_data_output_column, 6> AIR_DATA_MODEL_COLUMNS{
+    AIR_DATA_CALIBRATED_AIRSPEED, AIR_DATA_EQUIVALENT_AIRSPEED,
+    AIR_DATA_DENSITY,             AIR_DATA_PRESSURE,
+    AIR_DATA_DYNAMIC_PRESSURE,    AIR_DATA_IMPACT_PRESSURE};
+
+// function to fill the results of the parsed rows of a piece; the columns
+// of AIR_DATA_MODEL_COLUMNS are NaN in rows outside the model, and all of
+// them in rows with invalid input
+inline void compute_air_data(air_data_piece &piece) {
+  std::size_t count{piece.height_m.size()};
+  piece.results.resize((AIR_DATA_STATUS - AIR_DATA_CALIBRATED_AIRSPEED) *
+                       count);
+  piece.status.resize(count);
+  auto column = [&](std::size_t output_column) {
+    return piece.results.data() +
+           (output_column - AIR_DATA_CALIBRATED_AIRSPEED) * count;
+  };
+  compute_air_data(
+      piece.height_m.data(), piece.true_airspeed_mps.data(), count,
+      air_data_arrays{column(AIR_DATA_TEMPERATURE), column(AIR_DATA_PRESSURE),
+                      column(AIR_DATA_DENSITY), column(AIR_DATA_SOUND_SPEED),
+                      column(AIR_DATA_MACH), column(AIR_DATA_DYNAMIC_PRESSURE),
+                      column(AIR_DATA_IMPACT_PRESSURE),
+                      column(AIR_DATA_CALIBRATED_AIRSPEED),
+                      column(AIR_DATA_EQUIVALENT_AIRSPEED),
+                      piece.status.data()});
+  const double nan{std::numeric_limits<double>::quiet_NaN()};
+  for (std::size_t row = 0; row < count; ++row) {
+    if (piece.status[row] == ISA_INVALID_INPUT) {
+      for (std::size_t c = AIR_DATA_CALIBRATED_AIRSPEED; c < AIR_DATA_STATUS;
+           ++c) {
+        column(c)[row] = nan;
+      }
+    } else if (piece.status[row] != ISA_VALID) {
+      for (air_data_output_column output_column : AIR_DATA_MODEL_COLUMNS) {
+        column(output_column)[row] = nan;
+      }
+    }
+  }
+}
+
+// function to get the value of an output column of a computed piece
+inline double air_data_value(const air_data_piece &piece,
+                             std::size_t output_column, std::size_t row) {
+  switch (output_column) {
+  case AIR_DATA_HEIGHT:
+    return piece.height_m[row];
+  case AIR_DATA_TRUE_AIRSPEED:
+    return piece.true_airspeed_mps[row];
+  case AIR_DATA_STATUS:
+    return static_cast<double>(piece.status[row]);
+  default:
+    return piece.results[(output_column - AIR_DATA_CALIBRATED_AIRSPEED) *
+                             piece.height_m.size() +
+                         row];
+  }
+}
+
+// function to get the CSV header line of the output
+inline std::string air_data_csv_header() {
+  std::string header;
+  for (std::size_t c = 0; c < AIR_DATA_OUTPUT_COLUMNS; ++c) {
+    header += AIR_DATA_COLUMN_NAMES[c];
+    header += c + 1 < AIR_DATA_OUTPUT_COLUMNS ? ',' : '\n';
+  }
+  return header;
+}
+
+// Function to write the rows of a computed piece to its output, as CSV
+// (shortest representation that reads back to the same double) or binary
+// rows
+inline void format_air_data(air_data_piece &piece, air_data_format format) {
+  std::size_t count{piece.height_m.size()};
+  piece.output.clear();
+  if (format == AIR_DATA_BINARY) {
+    piece.output.resize(count * AIR_DATA_OUTPUT_COLUMNS * sizeof(double));
+    char *out{piece.output.data()};
+    for (std::size_t row = 0; row < count; ++row) {
+      for (std::size_t c = 0; c < AIR_DATA_OUTPUT_COLUMNS; ++c) {
+        double value{air_data_value(piece, c, row)};
+        std::memcpy(out, &value, sizeof(value));
+        out += sizeof(value);
+      }
+    }
+    return;
+  }
+  char number[32];
+  for (std::size_t row = 0; row < count; ++row) {
+    for (std::size_t c = 0; c < AIR_DATA_STATUS; ++c) {
+      std::to_chars_result result{std::to_chars(
+          number, number + sizeof(number), air_data_value(piece, c, row))};
+      piece.output.append(number, result.ptr);
+      piece.output += ',';
+    }
+    piece.output += static_cast<char>('0' + piece.status[row]);
+    piece.output += '\n';
+  }
+}
+
+// Function to convert every row of input to output. Returns the number of
+// rows. Throws std::invalid_argument for invalid input rows and
+// std::runtime_error when reading or writing fails; output already
+// written is kept.
+inline std::uint64_t
+convert_air_data(std::FILE *input, std::FILE *output,
+                 const air_data_batch_options &options = {},
+                 thread_pool &pool = default_thread_pool()) {
+  bool csv_input{options.input_format == AIR_DATA_CSV};
+  std::size_t piece_size{std::max(options.piece_size,
+                                  AIR_DATA_BINARY_ROW_SIZE)};
+  if (!csv_input) {
+    piece_size -= piece_size % AIR_DATA_BINARY_ROW_SIZE;
+  }
+  std::size_t read_size{std::max(options.read_size, piece_size)};
+
+  // blocks of whole rows; a partial row is carried to the next block
+  pipeline_queue<std::vector<char>> blocks{2};
+  std::exception_ptr read_error;
+  std::thread reader{[&] {
+    try {
+      std::vector<char> carry;
+      while (true) {
+        std::vector<char> block{std::move(carry)};
+        std::size_t kept{block.size()};
+        block.resize(kept + read_size);
+        std::size_t got{std::fread(block.data() + kept, 1, read_size, input)};
+        block.resize(kept + got);
+        bool last{got < read_size};
+        if (last && std::ferror(input)) {
+          throw std::runtime_error("cannot read the air data input");
+        }
+        std::size_t whole{block.size()};
+        if (!last) {
+          if (csv_input) {
+            auto newline{std::find(block.rbegin(), block.rend(), '\n')};
+            whole = static_cast<std::size_t>(block.rend() - newline);
+          } else {
+            whole -= whole % AIR_DATA_BINARY_ROW_SIZE;
+          }
+        } else if (!csv_input && whole % AIR_DATA_BINARY_ROW_SIZE != 0) {
+          throw std::runtime_error("binary air data input ends inside a row");
+        }
+        carry.assign(block.begin() + static_cast<std::ptrdiff_t>(whole),
+                     block.end());
+        block.resize(whole);
+        if ((!block.empty() && !blocks.push(std::move(block))) || last) {
+          break;
+        }
+      }
+    } catch (...) {
+      read_error = std::current_exception();
+    }
+    blocks.close();
+  }};
+
+  // formatted pieces of one block, in order
+  pipeline_queue<std::vector<std::string>> outputs{2};
+  std::exception_ptr write_error;
+  std::thread writer{[&] {
+    std::vector<std::string> texts;
+    while (outputs.pop(texts)) {
+      for (const std::string &text : texts) {
+        if (std::fwrite(text.data(), 1, text.size(), output) != text.size()) {
+          write_error = std::make_exception_ptr(
+              std::runtime_error("cannot write the air data output"));
+          outputs.close();
+          return;
+        }
+      }
+    }
+  }};
+
+  std::uint64_t rows{0};
+  std::exception_ptr error;
+  try {
+    if (options.output_format == AIR_DATA_CSV && options.header) {
+      outputs.push({air_data_csv_header()});
+    }
+    std::vector<air_data_piece> pieces;
+    std::vector<std::pair<const char *, const char *>> ranges;
+    std::vector<char> block;
+    bool first_block{true};
+    while (blocks.pop(block)) {
+      const char *begin{block.data()};
+      const char *end{begin + block.size()};
+      if (csv_input && first_block) {
+        const char *line_end{std::find(begin, end, '\n')};
+        if (!starts_with_number(begin, line_end)) {
+          begin = line_end == end ? end : line_end + 1;
+        }
+      }
+      first_block = false;
+
+      ranges.clear();
+      while (begin != end) {
+        const char *piece_end{end};
+        if (static_cast<std::size_t>(end - begin) > piece_size) {
+          piece_end = begin + piece_size;
+          if (csv_input) {
+            piece_end = std::find(piece_end, end, '\n');
+            piece_end = piece_end == end ? end : piece_end + 1;
+          }
+        }
+        ranges.emplace_back(begin, piece_end);
+        begin = piece_end;
+      }
+      if (pieces.size() < ranges.size()) {
+        pieces.resize(ranges.size());
+      }
+
+      pool.parallel_for(
+          ranges.size(), 1, [&](std::size_t first, std::size_t last) {
+            for (std::size_t p = first; p < last; ++p) {
+              air_data_piece &piece{pieces[p]};
+              piece.height_m.clear();
+              piece.true_airspeed_mps.clear();
+              if (csv_input) {
+                parse_air_data_csv(ranges[p].first, ranges[p].second,
+                                   piece.height_m, piece.true_airspeed_mps);
+              } else {
+                parse_air_data_binary(ranges[p].first, ranges[p].second,
+                                      piece.height_m, piece.true_airspeed_mps);
+              }
+              compute_air_data(piece);
+              format_air_data(piece, options.output_format);
+            }
+          });
+
+      std::vector<std::string> texts(ranges.size());
+      for (std::size_t p = 0; p < ranges.size(); ++p) {
+        rows += pieces[p].height_m.size();
+        texts[p].swap(pieces[p].output);
+      }
+      if (!outputs.push(std::move(texts))) {
+        break;
+      }
+    }
+  } catch (...) {
+    error = std::current_exception();
+  }
+  blocks.close();
+  outputs.close();
+  reader.join();
+  writer.join();
+  for (std::exception_ptr stage_error : {error, read_error, write_error}) {
+    if (stage_error) {
+      std::rethrow_exception(stage_error);
+    }
+  }
+  if (std::fflush(output) != 0) {
+    throw std::runtime_error("cannot write the air data output");
+  }
+  return rows;
+}
+
+#endif // !AIRDATABATCH_HPP
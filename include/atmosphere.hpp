@@ -27,9 +27,19 @@ Dr. Rodolfo B. Negri~\footnote{[URL]}."
 */
 
 #ifndef ATMOSPHERE_HPP
+#define ATMOSPHERE_HPP
 
+// International Standard Atmosphere, following the layers of the 1976 U.S.
+// Standard Atmosphere from sea level up to 86 km geometric height (84852 m
+// geopotential). Heights are geopotential; see geopotential_height().
+// The layer constants are derived from the constants below (R = 287), so
+// base pressures differ from the 1976 tables by up to ~0.3% at the top.
+
+#include "autodiff.hpp"
+#include "fastmath.hpp"
+#include <array>
 #include <cmath>
-#include <iostream>
+#include <cstddef>
 
 const double GRAVITY_SEALEVEL_mps2{9.80665};
 const double UNIVERSAL_GAS_CONSTANT_JpKpkg{287}; // (dry air)
@@ -39,65 +49,191 @@ const double DENSITY_SEALEVEL_kgpm3{1.225};
 const double PRESSURE_SEALEVEL_Pa{101325};
 const double TEMPERATURE_SEALEVEL_K{288.15};
 const int TROPOPAUSE_HEIGHT_m{11000};
+const double ISA_MAX_HEIGHT_m{84852};
+const double EARTH_RADIUS_m{6356766}; // (used for geopotential height)
+
+// layer bases and temperature gradients of the 1976 standard atmosphere
+const std::array<double, 7> ISA_LAYER_BASE_HEIGHTS_m{
+    {0, 11000, 20000, 32000, 47000, 51000, 71000}};
+const std::array<double, 7> ISA_LAYER_LAPSE_RATES_Kpm{
+    {-0.0065, 0.0, 0.001, 0.0028, 0.0, -0.0028, -0.002}};
+
+// validity of a height for the ISA model; reported instead of printing, so
+// out-of-range samples cost the same as valid ones
+enum ISA_status : unsigned char {
+  ISA_VALID = 0,
+  ISA_BELOW_MODEL = 1, // negative height
+  ISA_ABOVE_MODEL = 2, // above ISA_MAX_HEIGHT_m
+  ISA_INVALID_INPUT = 3 // NaN or infinite height, pressure <= 0 or NaN
+};
+
+// constants of one layer of the ISA model
+struct ISA_layer {
+  double base_height_m;
+  double base_temperature_K;
+  double base_pressure_Pa;
+  double lapse_rate_Kpm;
+  // pressure ratio exponents: p/pb = exp(pow_coeff * log(T/Tb) + iso_coeff *
+  // (h - hb)); only one of them is non-zero for a given layer
+  double pow_coeff;
+  double iso_coeff;
+};
+
+// layers of the ISA model, with base temperatures and pressures integrated
+// once from sea level
+inline const std::array<ISA_layer, 7> &ISA_layers() {
+  static const std::array<ISA_layer, 7> layers = [] {
+    std::array<ISA_layer, 7> table{};
+    double base_temperature_K{TEMPERATURE_SEALEVEL_K};
+    double base_pressure_Pa{PRESSURE_SEALEVEL_Pa};
+    for (std::size_t i = 0; i < table.size(); ++i) {
+      ISA_layer &layer{table[i]};
+      layer.base_height_m = ISA_LAYER_BASE_HEIGHTS_m[i];
+      layer.base_temperature_K = base_temperature_K;
+      layer.base_pressure_Pa = base_pressure_Pa;
+      layer.lapse_rate_Kpm = ISA_LAYER_LAPSE_RATES_Kpm[i];
+      layer.pow_coeff = 0.0;
+      layer.iso_coeff = 0.0;
+      if (layer.lapse_rate_Kpm != 0.0) {
+        layer.pow_coeff = -GRAVITY_SEALEVEL_mps2 /
+                          UNIVERSAL_GAS_CONSTANT_JpKpkg / layer.lapse_rate_Kpm;
+      } else {
+        layer.iso_coeff = -GRAVITY_SEALEVEL_mps2 /
+                          UNIVERSAL_GAS_CONSTANT_JpKpkg /
+                          layer.base_temperature_K;
+      }
+
+      // values at the base of the next layer
+      if (i + 1 < table.size()) {
+        double thickness_m{ISA_LAYER_BASE_HEIGHTS_m[i + 1] -
+                           layer.base_height_m};
+        base_temperature_K += layer.lapse_rate_Kpm * thickness_m;
+        if (layer.lapse_rate_Kpm != 0.0) {
+          base_pressure_Pa *=
+              std::pow(base_temperature_K / layer.base_temperature_K,
+                       layer.pow_coeff);
+        } else {
+          base_pressure_Pa *= std::exp(layer.iso_coeff * thickness_m);
+        }
+      }
+    }
+    return table;
+  }();
+  return layers;
+}
+
+// index of the layer containing a height (branch-free). Heights below sea
+// level use the first layer and heights above the model the last one.
+inline int ISA_layer_index(double height_m) {
+  int index{0};
+#pragma GCC unroll 8
+  for (std::size_t i = 1; i < ISA_LAYER_BASE_HEIGHTS_m.size(); ++i) {
+    index += height_m > ISA_LAYER_BASE_HEIGHTS_m[i];
+  }
+  return index;
+}
+
+// function to check whether a height is inside the ISA model. Every
+// comparison with NaN is false, so non-finite heights are checked first.
+inline ISA_status ISA_height_status(double height_m) {
+  ISA_status status{static_cast<ISA_status>(
+      (height_m < 0.0) + 2 * (height_m > ISA_MAX_HEIGHT_m))};
+  return std::isfinite(height_m) ? status : ISA_INVALID_INPUT;
+}
+
+// The model functions below are templated on the scalar type (double or a
+// dual number of autodiff.hpp) and have double overloads.
 
 // function to calculate the temperature following the ISA model
-inline double ISA_temperature(double height_m) {
-  double temperature_K{TEMPERATURE_SEALEVEL_K - 0.0065 * height_m};
-  if (height_m > TROPOPAUSE_HEIGHT_m) {
-    temperature_K = TEMPERATURE_SEALEVEL_K - 0.0065 * TROPOPAUSE_HEIGHT_m;
-  };
+template <typename Scalar>
+inline generic_scalar<Scalar> ISA_temperature(const Scalar &height_m) {
+  const ISA_layer &layer{ISA_layers()[ISA_layer_index(scalar_value(height_m))]};
+  Scalar temperature_K{layer.base_temperature_K +
+                       layer.lapse_rate_Kpm * (height_m - layer.base_height_m)};
   return temperature_K;
 }
 
+inline double ISA_temperature(double height_m) {
+  return ISA_temperature<double>(height_m);
+}
+
 // function to calculate the sound speed following the ISA model
-inline double ISA_soundspeed(double temperature_K) {
+template <typename Scalar>
+inline generic_scalar<Scalar> ISA_soundspeed(const Scalar &temperature_K) {
+  using std::sqrt;
 
-  double sound_speed_mps{std::sqrt(
-      temperature_K * UNIVERSAL_GAS_CONSTANT_JpKpkg * HEAT_CAPACITY_RATIO)};
+  Scalar sound_speed_mps{sqrt(temperature_K * UNIVERSAL_GAS_CONSTANT_JpKpkg *
+                              HEAT_CAPACITY_RATIO)};
 
   return sound_speed_mps;
 }
 
-// function to calculate the pressure following the ISA model
-inline double ISA_airpressure(double temperature_K, double height_m) {
+inline double ISA_soundspeed(double temperature_K) {
+  return ISA_soundspeed<double>(temperature_K);
+}
 
-  if (height_m <= TROPOPAUSE_HEIGHT_m && height_m >= 0)
-  // aircraft is inside troposphere
-  {
-    double pressure_Pa{
-        PRESSURE_SEALEVEL_Pa *
-        pow(temperature_K / TEMPERATURE_SEALEVEL_K,
-            GRAVITY_SEALEVEL_mps2 / UNIVERSAL_GAS_CONSTANT_JpKpkg / 0.0065)};
-    return pressure_Pa;
-  } else if (height_m > TROPOPAUSE_HEIGHT_m &&
-             height_m < 20100) // aircrafit is inside stratosphere
+// function to calculate the pressure following the ISA model. Returns -1
+// and sets status when the height is outside the model.
+template <typename Scalar>
+inline generic_scalar<Scalar> ISA_airpressure(const Scalar &temperature_K,
+                                              const Scalar &height_m,
+                                              ISA_status &status) {
+  using std::exp;
+  using std::pow;
+
+  status = ISA_height_status(scalar_value(height_m));
+  if (status != ISA_VALID) {
+    return Scalar(-1);
+  }
+
+  const ISA_layer &layer{ISA_layers()[ISA_layer_index(scalar_value(height_m))]};
+  if (layer.lapse_rate_Kpm != 0.0)
+  // layer with a temperature gradient
   {
-    // tropopause value
-    double T11{ISA_temperature(TROPOPAUSE_HEIGHT_m)};
-    double p11{
-        PRESSURE_SEALEVEL_Pa *
-        pow(temperature_K / TEMPERATURE_SEALEVEL_K,
-            GRAVITY_SEALEVEL_mps2 / UNIVERSAL_GAS_CONSTANT_JpKpkg / 0.0065)};
-    // calculating the pressure
-    double pressure_Pa{p11 * std::exp(-GRAVITY_SEALEVEL_mps2 /
-                                      UNIVERSAL_GAS_CONSTANT_JpKpkg / T11 *
-                                      (height_m - TROPOPAUSE_HEIGHT_m))};
+    Scalar pressure_Pa{
+        layer.base_pressure_Pa *
+        pow(temperature_K / layer.base_temperature_K, layer.pow_coeff)};
     return pressure_Pa;
   } else
-  // error
+  // isothermal layer
   {
-    std::cerr << "Error: Invalid height (not implemented).\n";
-    return -1;
+    Scalar pressure_Pa{layer.base_pressure_Pa *
+                       exp(layer.iso_coeff * (height_m - layer.base_height_m))};
+    return pressure_Pa;
   };
 }
 
+inline double ISA_airpressure(double temperature_K, double height_m,
+                              ISA_status &status) {
+  return ISA_airpressure<double>(temperature_K, height_m, status);
+}
+
+// function to calculate the pressure following the ISA model (-1 outside
+// the model)
+template <typename Scalar>
+inline generic_scalar<Scalar> ISA_airpressure(const Scalar &temperature_K,
+                                              const Scalar &height_m) {
+  ISA_status status{ISA_VALID};
+  return ISA_airpressure(temperature_K, height_m, status);
+}
+
+inline double ISA_airpressure(double temperature_K, double height_m) {
+  return ISA_airpressure<double>(temperature_K, height_m);
+}
+
 // function to calculate the density in accordance with the ISA model
-inline double ISA_density(double temperature_K, double pressure_Pa) {
-  double density_kgpm3{pressure_Pa / UNIVERSAL_GAS_CONSTANT_JpKpkg /
+template <typename Scalar>
+inline generic_scalar<Scalar> ISA_density(const Scalar &temperature_K,
+                                          const Scalar &pressure_Pa) {
+  Scalar density_kgpm3{pressure_Pa / UNIVERSAL_GAS_CONSTANT_JpKpkg /
                        temperature_K};
   return density_kgpm3;
 }
 
+inline double ISA_density(double temperature_K, double pressure_Pa) {
+  return ISA_density<double>(temperature_K, pressure_Pa);
+}
+
 // function to calculate the calibrated airspeed
 inline double calibrated_airspeed(double true_air_speed_mps, double height_m) {
   double temperature_K = ISA_temperature(height_m);
@@ -120,4 +256,86 @@ inline double calibrated_airspeed(double true_air_speed_mps, double height_m) {
   return calibrated_airspeed_mps;
 }
 
+// function to convert a geometric height into the geopotential height used by
+// the ISA functions
+inline double geopotential_height(double geometric_height_m) {
+  return EARTH_RADIUS_m * geometric_height_m /
+         (EARTH_RADIUS_m + geometric_height_m);
+}
+
+// pressure inside one layer, without range checks. With AVX2/AVX-512 both
+// layer types share one branch-free expression using the vectorizable
+// exp/log kernels; otherwise the loop stays scalar and a single libm call
+// per sample is cheaper.
+inline double ISA_layer_pressure(const ISA_layer &layer, double temperature_K,
+                                 double height_m) {
+#if defined(__AVX2__)
+  double exponent{
+      layer.pow_coeff * fast_log(temperature_K / layer.base_temperature_K) +
+      layer.iso_coeff * (height_m - layer.base_height_m)};
+  return layer.base_pressure_Pa * fast_exp(exponent);
+#else
+  if (layer.lapse_rate_Kpm != 0.0) {
+    return layer.base_pressure_Pa *
+           std::pow(temperature_K / layer.base_temperature_K, layer.pow_coeff);
+  }
+  return layer.base_pressure_Pa *
+         std::exp(layer.iso_coeff * (height_m - layer.base_height_m));
+#endif
+}
+
+// temperature and pressure at one height inside a batch loop (layers is
+// ISA_layers().data(), loaded once outside the loop). Branch-free; the
+// pressure is -1 outside the model.
+inline void ISA_batch_state(const ISA_layer *layers, double height_m,
+                            double &temperature_K, double &pressure_Pa) {
+  const ISA_layer &layer{layers[ISA_layer_index(height_m)]};
+  temperature_K = layer.base_temperature_K +
+                  layer.lapse_rate_Kpm * (height_m - layer.base_height_m);
+  pressure_Pa = ISA_layer_pressure(layer, temperature_K, height_m);
+  pressure_Pa = height_m >= 0.0 ? pressure_Pa : -1.0;
+  pressure_Pa = height_m <= ISA_MAX_HEIGHT_m ? pressure_Pa : -1.0;
+}
+
+template <bool WRITE_STATUS>
+inline void ISA_batch_kernel(const double *height_m, std::size_t count,
+                             double *temperature_K, double *pressure_Pa,
+                             double *density_kgpm3, double *sound_speed_mps,
+                             ISA_status *status) {
+  const ISA_layer *layers{ISA_layers().data()};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double h{height_m[i]};
+    double temperature{0.0}, pressure{0.0};
+    ISA_batch_state(layers, h, temperature, pressure);
+
+    temperature_K[i] = temperature;
+    pressure_Pa[i] = pressure;
+    density_kgpm3[i] = pressure / UNIVERSAL_GAS_CONSTANT_JpKpkg / temperature;
+    sound_speed_mps[i] = std::sqrt(temperature * UNIVERSAL_GAS_CONSTANT_JpKpkg *
+                                   HEAT_CAPACITY_RATIO);
+    if constexpr (WRITE_STATUS) {
+      status[i] = ISA_height_status(h);
+    }
+  }
+}
+
+// function to evaluate the ISA model for a batch of heights. Fills the
+// temperature, pressure, density and sound speed arrays (all of size count).
+// Heights outside the model get a pressure of -1, as in ISA_airpressure, and
+// the matching flag in status when it is given.
+inline void ISA_batch(const double *height_m, std::size_t count,
+                      double *temperature_K, double *pressure_Pa,
+                      double *density_kgpm3, double *sound_speed_mps,
+                      ISA_status *status = nullptr) {
+  if (status != nullptr) {
+    ISA_batch_kernel<true>(height_m, count, temperature_K, pressure_Pa,
+                           density_kgpm3, sound_speed_mps, status);
+  } else {
+    ISA_batch_kernel<false>(height_m, count, temperature_K, pressure_Pa,
+                            density_kgpm3, sound_speed_mps, status);
+  }
+}
+
 #endif // !ATMOSPHERE_HPP
@@ -0,0 +1,198 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef ATMOSPHERETABLE_HPP
+#define ATMOSPHERETABLE_HPP
+
+// Lookup-table backend for the ISA model. The table is built once from the
+// closed-form model with nodes every ISA_TABLE_STEP_m; queries cost one
+// multiplication to find the cell and a cubic Hermite interpolation, with no
+// pow/exp.
+//
+// Temperature is linear inside each layer and every layer base is a node, so
+// it is interpolated exactly (to rounding). Pressure is interpolated with
+// cubic Hermite polynomials using the exact slope dp/dh = -rho*g at the
+// nodes. Density and sound speed follow from T and p.
+//
+// With 20 m cells the pressure error is about 3.3e-13 (the Hermite error
+// scales with the fourth power of the step) and the table takes ~100 kB.
+// Maximum relative error against ISA_temperature/ISA_airpressure/ISA_density/
+// ISA_soundspeed over the implemented range: ISA_TABLE_MAX_RELATIVE_ERROR
+// (checked by tests/test_atmosphere_table.cpp).
+
+#include "atmosphere.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+const double ISA_TABLE_STEP_m{20.0};
+const double ISA_TABLE_MAX_RELATIVE_ERROR{5e-13};
+
+// atmospheric properties at one height
+struct ISA_properties {
+  double temperature_K;
+  double pressure_Pa;
+  double density_kgpm3;
+  double sound_speed_mps;
+  ISA_status status;
+};
+
+class ISA_table {
+public:
+  ISA_table() {
+    std::size_t node_count{static_cast<std::size_t>(
+                               std::ceil(ISA_MAX_HEIGHT_m / ISA_TABLE_STEP_m)) +
+                           1};
+    m_nodes.resize(node_count);
+    m_last_cell = static_cast<double>(node_count - 2);
+
+    for (std::size_t i = 0; i < node_count; ++i) {
+      double height_m{static_cast<double>(i) * ISA_TABLE_STEP_m};
+      // node values from the closed-form model; the last node may lie above
+      // the model and extends its top layer
+      const ISA_layer &layer{ISA_layers()[ISA_layer_index(height_m)]};
+      double temperature_K{layer.base_temperature_K +
+                           layer.lapse_rate_Kpm *
+                               (height_m - layer.base_height_m)};
+      double pressure_Pa{
+          layer.base_pressure_Pa *
+          std::exp(layer.pow_coeff *
+                       std::log(temperature_K / layer.base_temperature_K) +
+                   layer.iso_coeff * (height_m - layer.base_height_m))};
+      double density_kgpm3{ISA_density(temperature_K, pressure_Pa)};
+
+      m_nodes[i].temperature_K = temperature_K;
+      m_nodes[i].pressure_Pa = pressure_Pa;
+      // hydrostatic equation, scaled to the cell width
+      m_nodes[i].pressure_slope_Pa =
+          -density_kgpm3 * GRAVITY_SEALEVEL_mps2 * ISA_TABLE_STEP_m;
+    }
+  }
+
+  // properties at one height; outside the model the pressure (and hence the
+  // density) is -1, as in ISA_airpressure, and status tells why. A NaN or
+  // infinite height gives NaN properties and ISA_INVALID_INPUT.
+  ISA_properties evaluate(double height_m) const {
+    return interpolate(m_nodes.data(), m_last_cell, height_m);
+  }
+
+  // same as ISA_batch, using the table
+  void evaluate(const double *height_m, std::size_t count,
+                double *temperature_K, double *pressure_Pa,
+                double *density_kgpm3, double *sound_speed_mps,
+                ISA_status *status = nullptr) const {
+    if (status != nullptr) {
+      evaluate_kernel<true>(height_m, count, temperature_K, pressure_Pa,
+                            density_kgpm3, sound_speed_mps, status);
+    } else {
+      evaluate_kernel<false>(height_m, count, temperature_K, pressure_Pa,
+                             density_kgpm3, sound_speed_mps, status);
+    }
+  }
+
+private:
+  struct node {
+    double temperature_K;
+    double pressure_Pa;
+    double pressure_slope_Pa;
+  };
+
+  template <bool WRITE_STATUS>
+  void evaluate_kernel(const double *height_m, std::size_t count,
+                       double *temperature_K, double *pressure_Pa,
+                       double *density_kgpm3, double *sound_speed_mps,
+                       ISA_status *status) const {
+    // local copies, so the loop does not reload them after every store
+    const node *nodes{m_nodes.data()};
+    double last_cell{m_last_cell};
+
+#pragma omp simd
+    for (std::size_t i = 0; i < count; ++i) {
+      ISA_properties properties{interpolate(nodes, last_cell, height_m[i])};
+      temperature_K[i] = properties.temperature_K;
+      pressure_Pa[i] = properties.pressure_Pa;
+      density_kgpm3[i] = properties.density_kgpm3;
+      sound_speed_mps[i] = properties.sound_speed_mps;
+      if constexpr (WRITE_STATUS) {
+        status[i] = properties.status;
+      }
+    }
+  }
+
+  static ISA_properties interpolate(const node *nodes, double last_cell,
+                                    double height_m) {
+    // a NaN or infinite height would give an index outside the table: it is
+    // evaluated in the first cell and its properties replaced by NaN below
+    bool finite{std::isfinite(height_m)};
+    double cell{finite ? height_m / ISA_TABLE_STEP_m : 0.0};
+    double index{std::min(std::max(std::floor(cell), 0.0), last_cell)};
+    double t{cell - index};
+    // 32-bit index: int64 conversions do not vectorize before AVX-512
+    int lower{static_cast<int>(index)};
+    int upper{lower + 1};
+
+    double temperature_K{
+        nodes[lower].temperature_K +
+        t * (nodes[upper].temperature_K - nodes[lower].temperature_K)};
+
+    // cubic Hermite basis
+    double t2{t * t};
+    double t3{t2 * t};
+    double h00{2.0 * t3 - 3.0 * t2 + 1.0};
+    double h10{t3 - 2.0 * t2 + t};
+    double h01{-2.0 * t3 + 3.0 * t2};
+    double h11{t3 - t2};
+    double pressure_Pa{
+        h00 * nodes[lower].pressure_Pa + h10 * nodes[lower].pressure_slope_Pa +
+        h01 * nodes[upper].pressure_Pa + h11 * nodes[upper].pressure_slope_Pa};
+    pressure_Pa = height_m >= 0.0 ? pressure_Pa : -1.0;
+    pressure_Pa = height_m <= ISA_MAX_HEIGHT_m ? pressure_Pa : -1.0;
+    const double nan{std::numeric_limits<double>::quiet_NaN()};
+    temperature_K = finite ? temperature_K : nan;
+    pressure_Pa = finite ? pressure_Pa : nan;
+
+    return {temperature_K, pressure_Pa,
+            pressure_Pa / UNIVERSAL_GAS_CONSTANT_JpKpkg / temperature_K,
+            std::sqrt(temperature_K * UNIVERSAL_GAS_CONSTANT_JpKpkg *
+                      HEAT_CAPACITY_RATIO),
+            ISA_height_status(height_m)};
+  }
+
+  double m_last_cell{0.0};
+  std::vector<node> m_nodes;
+};
+
+// table shared by the whole program, built on first use
+inline const ISA_table &ISA_default_table() {
+  static const ISA_table table;
+  return table;
+}
+
+#endif // !ATMOSPHERETABLE_HPP
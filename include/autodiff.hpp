@@ -0,0 +1,263 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef AUTODIFF_HPP
+#define AUTODIFF_HPP
+
+// Forward-mode automatic differentiation with dual numbers.
+//
+// dual<N> carries a value and its gradient with respect to N independent
+// variables. Evaluating a function templated on the scalar type with dual
+// arguments gives the value and the exact derivatives in one pass, e.g. the
+// whole Jacobian of aircrafts_EOM with respect to the 12 states and the
+// controls, with no step size to tune. The gradient loops have a fixed
+// length and vectorize.
+//
+// Functions that accept dual numbers are templated on the scalar type and
+// call the math functions unqualified (after using std::sin, ...), so the
+// overloads below are found by argument-dependent lookup.
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+template <std::size_t N> struct dual {
+  double value;
+  std::array<double, N> gradient;
+
+  dual() : value{0.0}, gradient{} {}
+  // constants have no gradient
+  dual(double constant) : value{constant}, gradient{} {}
+  dual(double value_, const std::array<double, N> &gradient_)
+      : value{value_}, gradient(gradient_) {}
+
+  // independent variable number index
+  static dual variable(double value, std::size_t index) {
+    dual x{value};
+    x.gradient[index] = 1.0;
+    return x;
+  }
+
+  dual &operator+=(const dual &other) {
+    value += other.value;
+    for (std::size_t i = 0; i < N; ++i) {
+      gradient[i] += other.gradient[i];
+    }
+    return *this;
+  }
+  dual &operator-=(const dual &other) {
+    value -= other.value;
+    for (std::size_t i = 0; i < N; ++i) {
+      gradient[i] -= other.gradient[i];
+    }
+    return *this;
+  }
+  dual &operator*=(const dual &other) {
+    for (std::size_t i = 0; i < N; ++i) {
+      gradient[i] = gradient[i] * other.value + value * other.gradient[i];
+    }
+    value *= other.value;
+    return *this;
+  }
+  dual &operator/=(const dual &other) {
+    double inverse{1.0 / other.value};
+    // divided, not multiplied by the inverse, so the value rounds as a
+    // double quotient
+    double quotient{value / other.value};
+    for (std::size_t i = 0; i < N; ++i) {
+      gradient[i] = (gradient[i] - quotient * other.gradient[i]) * inverse;
+    }
+    value = quotient;
+    return *this;
+  }
+  dual &operator+=(double constant) {
+    value += constant;
+    return *this;
+  }
+  dual &operator-=(double constant) {
+    value -= constant;
+    return *this;
+  }
+  dual &operator*=(double constant) {
+    value *= constant;
+    for (std::size_t i = 0; i < N; ++i) {
+      gradient[i] *= constant;
+    }
+    return *this;
+  }
+  dual &operator/=(double constant) {
+    value /= constant;
+    for (std::size_t i = 0; i < N; ++i) {
+      gradient[i] /= constant;
+    }
+    return *this;
+  }
+};
+
+template <typename T> struct is_dual : std::false_type {};
+template <std::size_t N> struct is_dual<dual<N>> : std::true_type {};
+
+// T, when T is a scalar type the generic functions accept (double or dual);
+// keeps other arguments on their double overloads
+template <typename T>
+using generic_scalar =
+    std::enable_if_t<std::is_same_v<T, double> || is_dual<T>::value, T>;
+
+// value without the derivatives, for branches and table lookups
+inline double scalar_value(double x) { return x; }
+inline float scalar_value(float x) { return x; }
+template <std::size_t N> inline double scalar_value(const dual<N> &x) {
+  return x.value;
+}
+
+// value and derivative of f at x.value: f(x) and f'(x) * gradient
+template <std::size_t N>
+inline dual<N> chain(const dual<N> &x, double value, double derivative) {
+  dual<N> result{value};
+  for (std::size_t i = 0; i < N; ++i) {
+    result.gradient[i] = derivative * x.gradient[i];
+  }
+  return result;
+}
+
+template <std::size_t N> inline dual<N> operator-(const dual<N> &x) {
+  return chain(x, -x.value, -1.0);
+}
+template <std::size_t N>
+inline dual<N> operator+(dual<N> a, const dual<N> &b) {
+  return a += b;
+}
+template <std::size_t N>
+inline dual<N> operator-(dual<N> a, const dual<N> &b) {
+  return a -= b;
+}
+template <std::size_t N>
+inline dual<N> operator*(dual<N> a, const dual<N> &b) {
+  return a *= b;
+}
+template <std::size_t N>
+inline dual<N> operator/(dual<N> a, const dual<N> &b) {
+  return a /= b;
+}
+template <std::size_t N> inline dual<N> operator+(dual<N> a, double b) {
+  return a += b;
+}
+template <std::size_t N> inline dual<N> operator+(double a, dual<N> b) {
+  return b += a;
+}
+template <std::size_t N> inline dual<N> operator-(dual<N> a, double b) {
+  return a -= b;
+}
+template <std::size_t N> inline dual<N> operator-(double a, const dual<N> &b) {
+  return chain(b, a - b.value, -1.0);
+}
+template <std::size_t N> inline dual<N> operator*(dual<N> a, double b) {
+  return a *= b;
+}
+template <std::size_t N> inline dual<N> operator*(double a, dual<N> b) {
+  return b *= a;
+}
+template <std::size_t N> inline dual<N> operator/(dual<N> a, double b) {
+  return a /= b;
+}
+template <std::size_t N> inline dual<N> operator/(double a, const dual<N> &b) {
+  double inverse{1.0 / b.value};
+  return chain(b, a * inverse, -a * inverse * inverse);
+}
+
+// comparisons use the values
+template <std::size_t N>
+inline bool operator<(const dual<N> &a, const dual<N> &b) {
+  return a.value < b.value;
+}
+template <std::size_t N>
+inline bool operator>(const dual<N> &a, const dual<N> &b) {
+  return a.value > b.value;
+}
+template <std::size_t N>
+inline bool operator<=(const dual<N> &a, const dual<N> &b) {
+  return a.value <= b.value;
+}
+template <std::size_t N>
+inline bool operator>=(const dual<N> &a, const dual<N> &b) {
+  return a.value >= b.value;
+}
+template <std::size_t N>
+inline bool operator==(const dual<N> &a, const dual<N> &b) {
+  return a.value == b.value;
+}
+template <std::size_t N>
+inline bool operator!=(const dual<N> &a, const dual<N> &b) {
+  return a.value != b.value;
+}
+
+template <std::size_t N> inline dual<N> sin(const dual<N> &x) {
+  return chain(x, std::sin(x.value), std::cos(x.value));
+}
+template <std::size_t N> inline dual<N> cos(const dual<N> &x) {
+  return chain(x, std::cos(x.value), -std::sin(x.value));
+}
+template <std::size_t N> inline dual<N> tan(const dual<N> &x) {
+  double t{std::tan(x.value)};
+  return chain(x, t, 1.0 + t * t);
+}
+template <std::size_t N> inline dual<N> asin(const dual<N> &x) {
+  return chain(x, std::asin(x.value),
+               1.0 / std::sqrt(1.0 - x.value * x.value));
+}
+template <std::size_t N>
+inline dual<N> atan2(const dual<N> &y, const dual<N> &x) {
+  double inverse{1.0 / (x.value * x.value + y.value * y.value)};
+  dual<N> result{std::atan2(y.value, x.value)};
+  for (std::size_t i = 0; i < N; ++i) {
+    result.gradient[i] =
+        (x.value * y.gradient[i] - y.value * x.gradient[i]) * inverse;
+  }
+  return result;
+}
+template <std::size_t N> inline dual<N> sqrt(const dual<N> &x) {
+  double root{std::sqrt(x.value)};
+  return chain(x, root, 0.5 / root);
+}
+template <std::size_t N> inline dual<N> exp(const dual<N> &x) {
+  double e{std::exp(x.value)};
+  return chain(x, e, e);
+}
+template <std::size_t N> inline dual<N> log(const dual<N> &x) {
+  return chain(x, std::log(x.value), 1.0 / x.value);
+}
+template <std::size_t N> inline dual<N> pow(const dual<N> &x, double y) {
+  double p{std::pow(x.value, y)};
+  return chain(x, p, y * p / x.value);
+}
+template <std::size_t N> inline dual<N> fabs(const dual<N> &x) {
+  return chain(x, std::fabs(x.value), x.value < 0.0 ? -1.0 : 1.0);
+}
+
+#endif // !AUTODIFF_HPP
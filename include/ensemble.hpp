@@ -0,0 +1,323 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+// Ensemble (Monte Carlo) simulation of many aircraft.
+//
+// The states and mass properties of the members are stored as structure of
+// arrays, so aircrafts_EOM_batch evaluates the equations of motion of a whole
+// chunk of members in one vectorized loop. ensemble_integrator advances the
+// ensemble with RK4, spreading chunks of ENSEMBLE_CHUNK_SIZE members over a
+// thread_pool.
+//
+// Results are bit-reproducible for any number of threads: members never
+// interact, the chunk boundaries are fixed, and the random dispersions come
+// from a counter-based generator keyed by (seed, member), so they do not
+// depend on which thread draws them or in which order.
+
+#include "aircraftmotion.hpp"
+#include "threadpool.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+const std::size_t ENSEMBLE_CHUNK_SIZE{256};
+
+// SplitMix64 finalizer, a bijective 64-bit mixing function
+inline std::uint64_t splitmix64(std::uint64_t x) {
+  x += 0x9e3779b97f4a7c15;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+// random number stream of one ensemble member: the n-th number is a hash of
+// (seed, member, n), so streams are independent of each other and of the
+// order in which members are processed
+class member_random {
+public:
+  member_random(std::uint64_t seed, std::size_t member)
+      : m_key{splitmix64(seed ^ splitmix64(static_cast<std::uint64_t>(
+                                    member)))} {}
+
+  std::uint64_t next_bits() { return splitmix64(m_key + m_counter++); }
+
+  // uniform in (0, 1)
+  double uniform() {
+    return (static_cast<double>(next_bits() >> 11) + 0.5) * 0x1.0p-53;
+  }
+
+  // standard normal (Box-Muller)
+  double normal() {
+    const double TWO_PI{6.283185307179586};
+    double radius{std::sqrt(-2.0 * std::log(uniform()))};
+    return radius * std::cos(TWO_PI * uniform());
+  }
+
+private:
+  std::uint64_t m_key;
+  std::uint64_t m_counter{0};
+};
+
+// nominal values and standard deviations of the ensemble members
+struct ensemble_dispersion {
+  aircraft_state nominal_state{};
+  aircraft_state state_sigma{};
+  double nominal_mass{1.0};
+  double mass_sigma{0.0};
+  std::array<std::array<double, 3>, 3> nominal_inertia_tensor{
+      {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
+  // relative standard deviation of the inertia tensor elements
+  double inertia_relative_sigma{0.0};
+};
+
+// N aircraft as structure of arrays: state component c of member i is
+// stored at c * size() + i
+class aircraft_ensemble {
+public:
+  explicit aircraft_ensemble(std::size_t size)
+      : m_size{size}, m_states(AIRCRAFT_STATE_SIZE * size, 0.0),
+        m_mass_properties(5 * size, 1.0) {
+    std::fill(m_mass_properties.begin() + 4 * size, m_mass_properties.end(),
+              0.0);
+  }
+
+  std::size_t size() const { return m_size; }
+
+  // component arrays, starting at member begin
+  aircraft_state_arrays state_arrays(std::size_t begin = 0) {
+    return columns<AIRCRAFT_STATE_SIZE>(m_states, begin);
+  }
+
+  aircraft_mass_arrays mass_arrays(std::size_t begin = 0) {
+    std::array<double *, 5> column{columns<5>(m_mass_properties, begin)};
+    return {column[0], column[1], column[2], column[3], column[4]};
+  }
+
+  aircraft_state member_state(std::size_t member) const {
+    aircraft_state state;
+    for (std::size_t c = 0; c < AIRCRAFT_STATE_SIZE; ++c) {
+      state[c] = m_states[c * m_size + member];
+    }
+    return state;
+  }
+
+  void set_member_state(std::size_t member, const aircraft_state &state) {
+    for (std::size_t c = 0; c < AIRCRAFT_STATE_SIZE; ++c) {
+      m_states[c * m_size + member] = state[c];
+    }
+  }
+
+  void set_member_mass(
+      std::size_t member, double mass,
+      const std::array<std::array<double, 3>, 3> &inertia_tensor) {
+    m_mass_properties[member] = mass;
+    m_mass_properties[m_size + member] = inertia_tensor[0][0];
+    m_mass_properties[2 * m_size + member] = inertia_tensor[1][1];
+    m_mass_properties[3 * m_size + member] = inertia_tensor[2][2];
+    m_mass_properties[4 * m_size + member] = inertia_tensor[0][2];
+  }
+
+  // draw every member from a normal dispersion around the nominal values
+  void disperse(const ensemble_dispersion &dispersion, std::uint64_t seed,
+                thread_pool &pool = default_thread_pool()) {
+    pool.parallel_for(
+        m_size, ENSEMBLE_CHUNK_SIZE, [&](std::size_t begin, std::size_t end) {
+          for (std::size_t i = begin; i < end; ++i) {
+            member_random random{seed, i};
+            aircraft_state state;
+            for (std::size_t c = 0; c < AIRCRAFT_STATE_SIZE; ++c) {
+              state[c] = dispersion.nominal_state[c] +
+                         dispersion.state_sigma[c] * random.normal();
+            }
+            double mass{dispersion.nominal_mass +
+                        dispersion.mass_sigma * random.normal()};
+            std::array<std::array<double, 3>, 3> inertia_tensor{
+                dispersion.nominal_inertia_tensor};
+            for (std::size_t row = 0; row < 3; ++row) {
+              for (std::size_t col = 0; col < 3; ++col) {
+                inertia_tensor[row][col] *=
+                    1.0 + dispersion.inertia_relative_sigma * random.normal();
+              }
+            }
+            set_member_state(i, state);
+            set_member_mass(i, mass, inertia_tensor);
+          }
+        });
+  }
+
+private:
+  template <std::size_t COUNT>
+  std::array<double *, COUNT> columns(std::vector<double> &data,
+                                      std::size_t begin) {
+    std::array<double *, COUNT> column;
+    for (std::size_t c = 0; c < COUNT; ++c) {
+      column[c] = data.data() + c * m_size + begin;
+    }
+    return column;
+  }
+
+  std::size_t m_size;
+  std::vector<double> m_states;
+  // mass, Ixx, Iyy, Izz and the [0][2] element of the inertia tensor
+  std::vector<double> m_mass_properties;
+};
+
+// members [begin, begin + count) of the ensemble, as seen by the force
+// model. All arrays start at member begin.
+struct ensemble_chunk {
+  std::size_t begin;
+  std::size_t count;
+  aircraft_state_arrays state;
+  aircraft_mass_arrays mass_properties;
+  vector_arrays force;
+  vector_arrays moment;
+};
+
+// RK4 integration of an aircraft_ensemble. ForceModel is called as
+// model(time_s, chunk) and fills chunk.force and chunk.moment (body axes,
+// including gravity) for the chunk.state of its members. Chunks are handed
+// to the model from several threads at once, so it must not modify shared
+// data; per-member parameters can be looked up with chunk.begin.
+template <typename ForceModel> class ensemble_integrator {
+public:
+  ensemble_integrator(aircraft_ensemble &ensemble, ForceModel force_model,
+                      thread_pool &pool = default_thread_pool())
+      : m_ensemble{ensemble}, m_force_model{std::move(force_model)},
+        m_pool{pool}, m_stage(AIRCRAFT_STATE_SIZE * ensemble.size()),
+        m_derivative(AIRCRAFT_STATE_SIZE * ensemble.size()),
+        m_increment(AIRCRAFT_STATE_SIZE * ensemble.size()),
+        m_loads(6 * ensemble.size()) {}
+
+  // advance every member from time_s to time_s + step_s
+  void step(double time_s, double step_s) {
+    m_pool.parallel_for(m_ensemble.size(), ENSEMBLE_CHUNK_SIZE,
+                        [&](std::size_t begin, std::size_t end) {
+                          step_chunk(begin, end - begin, time_s, step_s);
+                        });
+  }
+
+  // advance every member from time_s to end_time_s with steps of (at most)
+  // step_s; time_s is updated
+  void integrate(double &time_s, double end_time_s, double step_s) {
+    while (time_s < end_time_s) {
+      double h{std::min(step_s, end_time_s - time_s)};
+      step(time_s, h);
+      time_s += h;
+    }
+  }
+
+  ForceModel &force_model() { return m_force_model; }
+
+private:
+  std::array<double *, AIRCRAFT_STATE_SIZE>
+  buffer_arrays(std::vector<double> &buffer, std::size_t begin) {
+    std::array<double *, AIRCRAFT_STATE_SIZE> column;
+    for (std::size_t c = 0; c < AIRCRAFT_STATE_SIZE; ++c) {
+      column[c] = buffer.data() + c * m_ensemble.size() + begin;
+    }
+    return column;
+  }
+
+  // one RK4 step of members [begin, begin + count); every chunk works on
+  // its own slice of the stage buffers
+  void step_chunk(std::size_t begin, std::size_t count, double time_s,
+                  double step_s) {
+    aircraft_state_arrays state{m_ensemble.state_arrays(begin)};
+    aircraft_state_arrays stage{buffer_arrays(m_stage, begin)};
+    aircraft_state_arrays derivative{buffer_arrays(m_derivative, begin)};
+    aircraft_state_arrays increment{buffer_arrays(m_increment, begin)};
+    std::size_t size{m_ensemble.size()};
+    double *loads{m_loads.data() + begin};
+    ensemble_chunk chunk{begin,
+                         count,
+                         state,
+                         m_ensemble.mass_arrays(begin),
+                         {loads, loads + size, loads + 2 * size},
+                         {loads + 3 * size, loads + 4 * size,
+                          loads + 5 * size}};
+
+    const double stage_times[4]{0.0, 0.5, 0.5, 1.0};
+    // weight of each stage derivative in the increment, and fraction of the
+    // step used to build the next stage from it
+    const double weights[4]{1.0, 2.0, 2.0, 1.0};
+    const double next_stage[4]{0.5, 0.5, 1.0, 0.0};
+
+    for (int k = 0; k < 4; ++k) {
+      m_force_model(time_s + stage_times[k] * step_s, chunk);
+      aircrafts_EOM_batch(count, chunk.state, chunk.mass_properties,
+                          chunk.force, chunk.moment, derivative);
+
+      for (std::size_t c = 0; c < AIRCRAFT_STATE_SIZE; ++c) {
+        const double *x{state[c]};
+        const double *dx{derivative[c]};
+        double *sum{increment[c]};
+        double *next{stage[c]};
+        double weight{weights[k]};
+        double h{next_stage[k] * step_s};
+        if (k == 0) {
+#pragma omp simd
+          for (std::size_t i = 0; i < count; ++i) {
+            sum[i] = dx[i];
+            next[i] = x[i] + h * dx[i];
+          }
+        } else if (k < 3) {
+#pragma omp simd
+          for (std::size_t i = 0; i < count; ++i) {
+            sum[i] += weight * dx[i];
+            next[i] = x[i] + h * dx[i];
+          }
+        } else {
+          double *x_out{state[c]};
+#pragma omp simd
+          for (std::size_t i = 0; i < count; ++i) {
+            x_out[i] += step_s / 6.0 * (sum[i] + dx[i]);
+          }
+        }
+      }
+      chunk.state = stage;
+    }
+  }
+
+  aircraft_ensemble &m_ensemble;
+  ForceModel m_force_model;
+  thread_pool &m_pool;
+  std::vector<double> m_stage;
+  std::vector<double> m_derivative;
+  std::vector<double> m_increment;
+  // force x, y, z and moment x, y, z
+  std::vector<double> m_loads;
+};
+
+#endif // !ENSEMBLE_HPP
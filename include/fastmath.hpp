@@ -0,0 +1,194 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef FASTMATH_HPP
+#define FASTMATH_HPP
+
+// Branch-free elementary functions used by the batch kernels. They contain no
+// calls into libm and no data-dependent branches, so loops over them are
+// vectorized by the compiler when the target has AVX2 or AVX-512 (build with
+// FLIGHTMECH_NATIVE=ON). Accuracy is within a few ULPs of std::exp/std::log
+// for normal, finite arguments.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+inline std::uint64_t double_to_bits(double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+inline double bits_to_double(std::uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// exponential function, e^x (|x| < 708, normal results only)
+inline double fast_exp(double x) {
+  const double LOG2E{1.4426950408889634};
+  const double LN2_HI{6.93147180369123816490e-01};
+  const double LN2_LO{1.90821492927058770002e-10};
+  // adding 1.5*2^52 rounds to the nearest integer, which is left in the low
+  // bits of the mantissa
+  const double ROUNDING_SHIFT{6755399441055744.0};
+
+  double shifted{x * LOG2E + ROUNDING_SHIFT};
+  double n{shifted - ROUNDING_SHIFT};
+  // reduced argument, |r| <= ln(2)/2
+  double r{(x - n * LN2_HI) - n * LN2_LO};
+
+  // Taylor polynomial of degree 13 (truncation error < 1e-17 on |r| <= 0.347)
+  double p{1.0 / 6227020800.0};
+  p = p * r + 1.0 / 479001600.0;
+  p = p * r + 1.0 / 39916800.0;
+  p = p * r + 1.0 / 3628800.0;
+  p = p * r + 1.0 / 362880.0;
+  p = p * r + 1.0 / 40320.0;
+  p = p * r + 1.0 / 5040.0;
+  p = p * r + 1.0 / 720.0;
+  p = p * r + 1.0 / 120.0;
+  p = p * r + 1.0 / 24.0;
+  p = p * r + 1.0 / 6.0;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  p = p * r + 1.0;
+
+  // scale by 2^n adding n directly to the exponent field
+  return bits_to_double(double_to_bits(p) + (double_to_bits(shifted) << 52));
+}
+
+// natural logarithm (x must be positive, finite and normal)
+inline double fast_log(double x) {
+  const double LN2_HI{6.93147180369123816490e-01};
+  const double LN2_LO{1.90821492927058770002e-10};
+  // bit pattern of sqrt(0.5): the mantissa is brought into [sqrt(0.5),sqrt(2))
+  const std::int64_t SQRT_HALF_BITS{0x3fe6a09e667f3bcd};
+
+  std::int64_t offset_bits{static_cast<std::int64_t>(double_to_bits(x)) -
+                           SQRT_HALF_BITS};
+  std::int64_t k{offset_bits >> 52};
+  double m{bits_to_double(double_to_bits(x) -
+                          (static_cast<std::uint64_t>(k) << 52))};
+  // k as a double through the 1.5*2^52 shift (there is no vectorized
+  // int64->double conversion before AVX-512)
+  double kd{bits_to_double(static_cast<std::uint64_t>(k) +
+                           0x4338000000000000) -
+            6755399441055744.0};
+
+  // log(m) = 2 atanh(s), s = (m - 1)/(m + 1), |s| <= 0.1716
+  double f{m - 1.0};
+  double s{f / (2.0 + f)};
+  double s2{s * s};
+  double p{1.0 / 21.0};
+  p = p * s2 + 1.0 / 19.0;
+  p = p * s2 + 1.0 / 17.0;
+  p = p * s2 + 1.0 / 15.0;
+  p = p * s2 + 1.0 / 13.0;
+  p = p * s2 + 1.0 / 11.0;
+  p = p * s2 + 1.0 / 9.0;
+  p = p * s2 + 1.0 / 7.0;
+  p = p * s2 + 1.0 / 5.0;
+  p = p * s2 + 1.0 / 3.0;
+  // log(m) = 2s + 2s^3 p, with 2s rewritten as f - s*f
+  double log_m{f - s * (f - 2.0 * s2 * p)};
+
+  return kd * LN2_HI + (log_m + kd * LN2_LO);
+}
+
+// power function, x^y (x must be positive, finite and normal)
+inline double fast_pow(double x, double y) { return fast_exp(y * fast_log(x)); }
+
+// power function for batch loops: the polynomial kernels when the loop can
+// be vectorized (AVX2 gathers and 64-bit integer lanes), libm otherwise,
+// where one scalar std::pow is cheaper than fast_exp + fast_log
+inline double batch_pow(double x, double y) {
+#if defined(__AVX2__)
+  return fast_pow(x, y);
+#else
+  return std::pow(x, y);
+#endif
+}
+
+// sine and cosine together (|x| < 1e5); the quadrant is chosen with selects
+// rather than branches
+inline void fast_sincos(double x, double &sine, double &cosine) {
+  const double TWO_OVER_PI{0.63661977236758134308};
+  // pi/2 split in three parts (Cody-Waite reduction)
+  const double PIO2_1{1.57079632673412561417e+00};
+  const double PIO2_2{6.07710050630396597660e-11};
+  const double PIO2_3{2.02226624879595063154e-21};
+  const double ROUNDING_SHIFT{6755399441055744.0};
+
+  double shifted{x * TWO_OVER_PI + ROUNDING_SHIFT};
+  double n{shifted - ROUNDING_SHIFT};
+  std::uint64_t quadrant{double_to_bits(shifted)};
+  // reduced argument, |r| <= pi/4
+  double r{((x - n * PIO2_1) - n * PIO2_2) - n * PIO2_3};
+  double z{r * r};
+
+  // minimax polynomials of fdlibm's __kernel_sin and __kernel_cos
+  double ps{1.58969099521155010221e-10};
+  ps = ps * z - 2.50507602534068634195e-08;
+  ps = ps * z + 2.75573137070700676789e-06;
+  ps = ps * z - 1.98412698298579493134e-04;
+  ps = ps * z + 8.33333333332248946124e-03;
+  ps = ps * z - 1.66666666666666324348e-01;
+  double s{r + r * z * ps};
+
+  double pc{-1.13596475577881948265e-11};
+  pc = pc * z + 2.08757232129817482790e-09;
+  pc = pc * z - 2.75573143513906633035e-07;
+  pc = pc * z + 2.48015872894767294178e-05;
+  pc = pc * z - 1.38888888888741095749e-03;
+  pc = pc * z + 4.16666666666666019037e-02;
+  double c{1.0 - 0.5 * z + z * z * pc};
+
+  // odd quadrants swap sine and cosine; the signs follow the quadrant
+  bool swap{(quadrant & 1) != 0};
+  std::uint64_t sine_bits{double_to_bits(swap ? c : s) ^
+                          ((quadrant & 2) << 62)};
+  std::uint64_t cosine_bits{double_to_bits(swap ? s : c) ^
+                            (((quadrant + 1) & 2) << 62)};
+  sine = bits_to_double(sine_bits);
+  cosine = bits_to_double(cosine_bits);
+}
+
+// sine and cosine for batch loops, see batch_pow
+inline void batch_sincos(double x, double &sine, double &cosine) {
+#if defined(__AVX2__)
+  fast_sincos(x, sine, cosine);
+#else
+  sine = std::sin(x);
+  cosine = std::cos(x);
+#endif
+}
+
+#endif // !FASTMATH_HPP
@@ -27,108 +27,208 @@ Dr .Rodolfo B. Negri~\footnote{[URL]}."
 */
 
 #ifndef FRAMESNROTATIONS_HPP
+#define FRAMESNROTATIONS_HPP
 
+#include "autodiff.hpp"
+#include "fastmath.hpp"
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstddef>
 
-// Function to perform rotation from the body-fixed frame (aircraft) to the
-// Earth
-inline std::array<double, 3>
-body_to_earth(const std::array<double, 3> body_coords, double roll,
-              double pitch, double yaw) {
-  std::array<double, 3> earth_coords = {0.0};
-
-  // Compute elements of the rotation matrix
-  double c_pitch = cos(pitch);
-  double s_pitch = sin(pitch);
-  double c_roll = cos(roll);
-  double s_roll = sin(roll);
-  double c_yaw = cos(yaw);
-  double s_yaw = sin(yaw);
-
-  // Compute rotation matrix (earth to body)
-  std::array<std::array<double, 3>, 3> rotation_matrix = {
-      {{c_pitch * c_yaw, c_pitch * s_yaw, -s_pitch},
-       {c_yaw * s_roll * s_pitch - s_yaw * c_roll,
-        s_roll * s_pitch * s_yaw + c_roll * c_yaw, s_roll * c_pitch},
-       {c_roll * s_pitch * c_yaw + s_roll * s_yaw,
-        c_roll * s_pitch * s_yaw - s_roll * c_yaw, c_roll * c_pitch}}};
-
-  std::array<std::array<double, 3>, 3> transpose{{{0.0}}};
-
-  for (int i = 0; i < 3; ++i) {
-    for (int j = 0; j < 3; ++j) {
-      transpose[i][j] = rotation_matrix[j][i];
-    }
+// Attitude quaternion (scalar part w first), rotating the Earth frame into
+// the body-fixed frame in the same yaw-pitch-roll sequence as the Euler
+// angles
+struct quaternion {
+  double w;
+  double x;
+  double y;
+  double z;
+};
+
+// Function to convert Euler angles (roll, pitch, yaw) to a unit quaternion
+inline quaternion euler_to_quaternion(double roll, double pitch, double yaw) {
+  double c_roll{cos(0.5 * roll)}, s_roll{sin(0.5 * roll)};
+  double c_pitch{cos(0.5 * pitch)}, s_pitch{sin(0.5 * pitch)};
+  double c_yaw{cos(0.5 * yaw)}, s_yaw{sin(0.5 * yaw)};
+
+  return {c_roll * c_pitch * c_yaw + s_roll * s_pitch * s_yaw,
+          s_roll * c_pitch * c_yaw - c_roll * s_pitch * s_yaw,
+          c_roll * s_pitch * c_yaw + s_roll * c_pitch * s_yaw,
+          c_roll * c_pitch * s_yaw - s_roll * s_pitch * c_yaw};
+}
+
+// Function to convert a unit quaternion to Euler angles {roll, pitch, yaw};
+// at pitch = +-90 deg only roll - yaw (or roll + yaw) is defined and yaw
+// carries all of it
+inline std::array<double, 3> quaternion_to_euler(const quaternion &q) {
+  double s_pitch{2.0 * (q.w * q.y - q.z * q.x)};
+  s_pitch = std::min(1.0, std::max(-1.0, s_pitch));
+  return {atan2(2.0 * (q.w * q.x + q.y * q.z),
+                1.0 - 2.0 * (q.x * q.x + q.y * q.y)),
+          asin(s_pitch),
+          atan2(2.0 * (q.w * q.z + q.x * q.y),
+                1.0 - 2.0 * (q.y * q.y + q.z * q.z))};
+}
+
+// Function to scale a quaternion to unit norm
+inline quaternion normalize(const quaternion &q) {
+  double inverse_norm{1.0 / sqrt(q.w * q.w + q.x * q.x + q.y * q.y +
+                                 q.z * q.z)};
+  return {q.w * inverse_norm, q.x * inverse_norm, q.y * inverse_norm,
+          q.z * inverse_norm};
+}
+
+// Attitude of the aircraft as a direction cosine matrix. The sines and
+// cosines of the Euler angles and the rotation matrix (earth to body) are
+// computed once in the constructor; build one per step and pass it to
+// body_to_earth, earth_to_body, body_angular_vel and aircrafts_EOM instead
+// of the angles.
+// roll (bank angle)
+// pitch
+// yaw (heading angle)
+class direction_cosine_matrix {
+public:
+  direction_cosine_matrix(double roll, double pitch, double yaw)
+      : m_c_roll{cos(roll)}, m_s_roll{sin(roll)}, m_c_pitch{cos(pitch)},
+        m_s_pitch{sin(pitch)}, m_c_yaw{cos(yaw)}, m_s_yaw{sin(yaw)} {
+    // Compute rotation matrix (earth to body)
+    m_matrix = {{{m_c_pitch * m_c_yaw, m_c_pitch * m_s_yaw, -m_s_pitch},
+
+                 {m_c_yaw * m_s_roll * m_s_pitch - m_s_yaw * m_c_roll,
+                  m_s_roll * m_s_pitch * m_s_yaw + m_c_roll * m_c_yaw,
+                  m_s_roll * m_c_pitch},
+
+                 {m_c_roll * m_s_pitch * m_c_yaw + m_s_roll * m_s_yaw,
+                  m_c_roll * m_s_pitch * m_s_yaw - m_s_roll * m_c_yaw,
+                  m_c_roll * m_c_pitch}}};
   }
 
-  // Apply rotation matrix to convert Earth-fixed coordinates to body-fixed
-  // coordinates
-  for (int i = 0; i < 3; ++i) {
-    for (int j = 0; j < 3; ++j) {
-      earth_coords[i] += transpose[i][j] * body_coords[j];
+  // from an attitude quaternion, which need not be exactly unit: the matrix
+  // is that of the normalized quaternion and needs no trigonometric
+  // functions. The Euler angle sines and cosines are recovered from it; at
+  // pitch = +-90 deg roll is taken as zero.
+  explicit direction_cosine_matrix(const quaternion &q) {
+    double s{2.0 / (q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z)};
+    m_matrix = {{{1.0 - s * (q.y * q.y + q.z * q.z),
+                  s * (q.x * q.y + q.w * q.z), s * (q.x * q.z - q.w * q.y)},
+
+                 {s * (q.x * q.y - q.w * q.z),
+                  1.0 - s * (q.x * q.x + q.z * q.z),
+                  s * (q.y * q.z + q.w * q.x)},
+
+                 {s * (q.x * q.z + q.w * q.y), s * (q.y * q.z - q.w * q.x),
+                  1.0 - s * (q.x * q.x + q.y * q.y)}}};
+
+    const std::array<std::array<double, 3>, 3> &R{m_matrix};
+    m_s_pitch = -R[0][2];
+    m_c_pitch = sqrt(R[0][0] * R[0][0] + R[0][1] * R[0][1]);
+    if (m_c_pitch > 1e-12) {
+      m_c_yaw = R[0][0] / m_c_pitch;
+      m_s_yaw = R[0][1] / m_c_pitch;
+      m_c_roll = R[2][2] / m_c_pitch;
+      m_s_roll = R[1][2] / m_c_pitch;
+    } else {
+      m_c_roll = 1.0;
+      m_s_roll = 0.0;
+      m_c_yaw = R[1][1];
+      m_s_yaw = -R[1][0];
     }
   }
 
-  return earth_coords;
+  // rotation matrix from the Earth frame to the body-fixed frame; its
+  // transpose rotates from body to Earth
+  const std::array<std::array<double, 3>, 3> &matrix() const {
+    return m_matrix;
+  }
+
+  double cos_roll() const { return m_c_roll; }
+  double sin_roll() const { return m_s_roll; }
+  double cos_pitch() const { return m_c_pitch; }
+  double sin_pitch() const { return m_s_pitch; }
+  double tan_pitch() const { return m_s_pitch / m_c_pitch; }
+  double cos_yaw() const { return m_c_yaw; }
+  double sin_yaw() const { return m_s_yaw; }
+
+  // rotation from the Earth frame to the body-fixed frame
+  std::array<double, 3>
+  earth_to_body(const std::array<double, 3> &earth_coords) const {
+    const std::array<std::array<double, 3>, 3> &R{m_matrix};
+    return {R[0][0] * earth_coords[0] + R[0][1] * earth_coords[1] +
+                R[0][2] * earth_coords[2],
+            R[1][0] * earth_coords[0] + R[1][1] * earth_coords[1] +
+                R[1][2] * earth_coords[2],
+            R[2][0] * earth_coords[0] + R[2][1] * earth_coords[1] +
+                R[2][2] * earth_coords[2]};
+  }
+
+  // rotation from the body-fixed frame to the Earth frame, multiplying by
+  // the transpose in place
+  std::array<double, 3>
+  body_to_earth(const std::array<double, 3> &body_coords) const {
+    const std::array<std::array<double, 3>, 3> &R{m_matrix};
+    return {R[0][0] * body_coords[0] + R[1][0] * body_coords[1] +
+                R[2][0] * body_coords[2],
+            R[0][1] * body_coords[0] + R[1][1] * body_coords[1] +
+                R[2][1] * body_coords[2],
+            R[0][2] * body_coords[0] + R[1][2] * body_coords[1] +
+                R[2][2] * body_coords[2]};
+  }
+
+private:
+  double m_c_roll, m_s_roll;
+  double m_c_pitch, m_s_pitch;
+  double m_c_yaw, m_s_yaw;
+  std::array<std::array<double, 3>, 3> m_matrix;
+};
+
+// Function to perform rotation from the body-fixed frame (aircraft) to the
+// Earth
+inline std::array<double, 3>
+body_to_earth(const std::array<double, 3> &body_coords,
+              const direction_cosine_matrix &attitude) {
+  return attitude.body_to_earth(body_coords);
+}
+
+inline std::array<double, 3>
+body_to_earth(const std::array<double, 3> body_coords, double roll,
+              double pitch, double yaw) {
+  return body_to_earth(body_coords,
+                       direction_cosine_matrix{roll, pitch, yaw});
 }
 
 // Function to perform rotation from the Earth frame to the body-fixed frame
 // (aircraft)
+inline std::array<double, 3>
+earth_to_body(const std::array<double, 3> &earth_coords,
+              const direction_cosine_matrix &attitude) {
+  return attitude.earth_to_body(earth_coords);
+}
+
 // roll (bank angle)
 // pitch
 // yaw (heading angle)
 inline std::array<double, 3>
 earth_to_body(const std::array<double, 3> earth_coords, double roll,
               double pitch, double yaw) {
-  std::array<double, 3> body_coords = {0.0};
-
-  // Compute elements of the rotation matrix
-  double c_pitch = cos(pitch);
-  double s_pitch = sin(pitch);
-  double c_roll = cos(roll);
-  double s_roll = sin(roll);
-  double c_yaw = cos(yaw);
-  double s_yaw = sin(yaw);
-
-  // phi    roll
-  // psi    yaw
-  // theta  pitch
-
-  // Compute rotation matrix
-  std::array<std::array<double, 3>, 3> rotation_matrix = {
-      {{c_pitch * c_yaw, c_pitch * s_yaw, -s_pitch},
-
-       {c_yaw * s_roll * s_pitch - s_yaw * c_roll,
-        s_roll * s_pitch * s_yaw + c_roll * c_yaw, s_roll * c_pitch},
-
-       {c_roll * s_pitch * c_yaw + s_roll * s_yaw,
-        c_roll * s_pitch * s_yaw - s_roll * c_yaw, c_roll * c_pitch}}};
-
-  // Apply rotation matrix to convert Earth-fixed coordinates to body-fixed
-  // coordinates
-  for (int i = 0; i < 3; ++i) {
-    for (int j = 0; j < 3; ++j) {
-      body_coords[i] += rotation_matrix[i][j] * earth_coords[j];
-    }
-  }
-
-  return body_coords;
+  return earth_to_body(earth_coords,
+                       direction_cosine_matrix{roll, pitch, yaw});
 }
 
 // Function that returns the body angular velocities in the body-fixed frame
-inline std::array<double, 3> body_angular_vel(double roll, double pitch,
-                                              double yaw, double roll_vel,
-                                              double pitch_vel,
-                                              double yaw_vel) {
+inline std::array<double, 3>
+body_angular_vel(const direction_cosine_matrix &attitude, double roll_vel,
+                 double pitch_vel, double yaw_vel) {
   // forward_angle <-> p
   // lateral_angle <-> q
   // downward_angle <-> r
   double forward_angle{0.0}, lateral_angle{0.0}, downward_angle{0.0};
 
-  forward_angle = roll_vel - yaw_vel * sin(pitch);
-  lateral_angle = pitch_vel * cos(roll) + yaw_vel * cos(pitch) * sin(roll);
-  downward_angle = yaw_vel * cos(roll) * cos(pitch) - pitch_vel * sin(roll);
+  forward_angle = roll_vel - yaw_vel * attitude.sin_pitch();
+  lateral_angle = pitch_vel * attitude.cos_roll() +
+                  yaw_vel * attitude.cos_pitch() * attitude.sin_roll();
+  downward_angle = yaw_vel * attitude.cos_roll() * attitude.cos_pitch() -
+                   pitch_vel * attitude.sin_roll();
 
   std::array<double, 3> body_angular_vel_vector{
       {forward_angle, lateral_angle, downward_angle}};
@@ -136,4 +236,203 @@ inline std::array<double, 3> body_angular_vel(double roll, double pitch,
   return body_angular_vel_vector;
 }
 
-#endif
+inline std::array<double, 3> body_angular_vel(double roll, double pitch,
+                                              double yaw, double roll_vel,
+                                              double pitch_vel,
+                                              double yaw_vel) {
+  return body_angular_vel(direction_cosine_matrix{roll, pitch, yaw}, roll_vel,
+                          pitch_vel, yaw_vel);
+}
+
+// Rotations for any scalar type (double or a dual number of autodiff.hpp),
+// for functions differentiated with dual numbers; the double overloads
+// above are the ones to use with plain doubles.
+
+// Function that returns the rotation matrix from the Earth frame to the
+// body-fixed frame
+template <typename Scalar>
+inline std::array<std::array<generic_scalar<Scalar>, 3>, 3>
+euler_rotation_matrix(const Scalar &roll, const Scalar &pitch,
+                      const Scalar &yaw) {
+  using std::cos;
+  using std::sin;
+  Scalar c_roll{cos(roll)}, s_roll{sin(roll)};
+  Scalar c_pitch{cos(pitch)}, s_pitch{sin(pitch)};
+  Scalar c_yaw{cos(yaw)}, s_yaw{sin(yaw)};
+
+  return {{{c_pitch * c_yaw, c_pitch * s_yaw, -s_pitch},
+
+           {c_yaw * s_roll * s_pitch - s_yaw * c_roll,
+            s_roll * s_pitch * s_yaw + c_roll * c_yaw, s_roll * c_pitch},
+
+           {c_roll * s_pitch * c_yaw + s_roll * s_yaw,
+            c_roll * s_pitch * s_yaw - s_roll * c_yaw, c_roll * c_pitch}}};
+}
+
+template <typename Scalar>
+inline std::array<generic_scalar<Scalar>, 3>
+body_to_earth(const std::array<Scalar, 3> &body_coords, const Scalar &roll,
+              const Scalar &pitch, const Scalar &yaw) {
+  std::array<std::array<Scalar, 3>, 3> R{
+      euler_rotation_matrix(roll, pitch, yaw)};
+  const std::array<Scalar, 3> &v{body_coords};
+  return {R[0][0] * v[0] + R[1][0] * v[1] + R[2][0] * v[2],
+          R[0][1] * v[0] + R[1][1] * v[1] + R[2][1] * v[2],
+          R[0][2] * v[0] + R[1][2] * v[1] + R[2][2] * v[2]};
+}
+
+template <typename Scalar>
+inline std::array<generic_scalar<Scalar>, 3>
+earth_to_body(const std::array<Scalar, 3> &earth_coords, const Scalar &roll,
+              const Scalar &pitch, const Scalar &yaw) {
+  std::array<std::array<Scalar, 3>, 3> R{
+      euler_rotation_matrix(roll, pitch, yaw)};
+  const std::array<Scalar, 3> &v{earth_coords};
+  return {R[0][0] * v[0] + R[0][1] * v[1] + R[0][2] * v[2],
+          R[1][0] * v[0] + R[1][1] * v[1] + R[1][2] * v[2],
+          R[2][0] * v[0] + R[2][1] * v[1] + R[2][2] * v[2]};
+}
+
+template <typename Scalar>
+inline std::array<generic_scalar<Scalar>, 3>
+body_angular_vel(const Scalar &roll, const Scalar &pitch, const Scalar &yaw,
+                 const Scalar &roll_vel, const Scalar &pitch_vel,
+                 const Scalar &yaw_vel) {
+  using std::cos;
+  using std::sin;
+  (void)yaw;
+  Scalar c_roll{cos(roll)}, s_roll{sin(roll)};
+  Scalar c_pitch{cos(pitch)}, s_pitch{sin(pitch)};
+
+  return {roll_vel - yaw_vel * s_pitch,
+          pitch_vel * c_roll + yaw_vel * c_pitch * s_roll,
+          yaw_vel * c_roll * c_pitch - pitch_vel * s_roll};
+}
+
+// Structure-of-arrays view of many vectors: element c points to component c
+// of consecutive vectors
+using vector_arrays = std::array<double *, 3>;
+
+// the same view starting at vector begin, to hand chunks of a batch to
+// thread_pool::parallel_for
+inline vector_arrays offset(const vector_arrays &vectors, std::size_t begin) {
+  return {vectors[0] + begin, vectors[1] + begin, vectors[2] + begin};
+}
+
+// Batch rotations of count vectors from the body-fixed frame to the Earth,
+// each with its own attitude (roll, pitch and yaw arrays of size count)
+inline void body_to_earth_batch(std::size_t count, const double *roll,
+                                const double *pitch, const double *yaw,
+                                const vector_arrays &body_coords,
+                                const vector_arrays &earth_coords) {
+  // local copies of the pointers, so the loop does not reload them after
+  // every store
+  const vector_arrays b{body_coords};
+  const vector_arrays e{earth_coords};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double s_roll, c_roll, s_pitch, c_pitch, s_yaw, c_yaw;
+    batch_sincos(roll[i], s_roll, c_roll);
+    batch_sincos(pitch[i], s_pitch, c_pitch);
+    batch_sincos(yaw[i], s_yaw, c_yaw);
+    double x{b[0][i]}, y{b[1][i]}, z{b[2][i]};
+
+    // transpose of the earth to body matrix
+    e[0][i] = c_pitch * c_yaw * x +
+              (c_yaw * s_roll * s_pitch - s_yaw * c_roll) * y +
+              (c_roll * s_pitch * c_yaw + s_roll * s_yaw) * z;
+    e[1][i] = c_pitch * s_yaw * x +
+              (s_roll * s_pitch * s_yaw + c_roll * c_yaw) * y +
+              (c_roll * s_pitch * s_yaw - s_roll * c_yaw) * z;
+    e[2][i] = -s_pitch * x + s_roll * c_pitch * y + c_roll * c_pitch * z;
+  }
+}
+
+// Batch rotations of count vectors from the Earth frame to the body-fixed
+// frame, each with its own attitude
+inline void earth_to_body_batch(std::size_t count, const double *roll,
+                                const double *pitch, const double *yaw,
+                                const vector_arrays &earth_coords,
+                                const vector_arrays &body_coords) {
+  const vector_arrays e{earth_coords};
+  const vector_arrays b{body_coords};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double s_roll, c_roll, s_pitch, c_pitch, s_yaw, c_yaw;
+    batch_sincos(roll[i], s_roll, c_roll);
+    batch_sincos(pitch[i], s_pitch, c_pitch);
+    batch_sincos(yaw[i], s_yaw, c_yaw);
+    double x{e[0][i]}, y{e[1][i]}, z{e[2][i]};
+
+    b[0][i] = c_pitch * c_yaw * x + c_pitch * s_yaw * y - s_pitch * z;
+    b[1][i] = (c_yaw * s_roll * s_pitch - s_yaw * c_roll) * x +
+              (s_roll * s_pitch * s_yaw + c_roll * c_yaw) * y +
+              s_roll * c_pitch * z;
+    b[2][i] = (c_roll * s_pitch * c_yaw + s_roll * s_yaw) * x +
+              (c_roll * s_pitch * s_yaw - s_roll * c_yaw) * y +
+              c_roll * c_pitch * z;
+  }
+}
+
+// Batch rotations of count vectors from the body-fixed frame to the Earth,
+// all with the same attitude (e.g. a point cloud from one sensor frame)
+inline void body_to_earth_batch(std::size_t count,
+                                const direction_cosine_matrix &attitude,
+                                const vector_arrays &body_coords,
+                                const vector_arrays &earth_coords) {
+  const std::array<std::array<double, 3>, 3> R{attitude.matrix()};
+  const vector_arrays b{body_coords};
+  const vector_arrays e{earth_coords};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double x{b[0][i]}, y{b[1][i]}, z{b[2][i]};
+    e[0][i] = R[0][0] * x + R[1][0] * y + R[2][0] * z;
+    e[1][i] = R[0][1] * x + R[1][1] * y + R[2][1] * z;
+    e[2][i] = R[0][2] * x + R[1][2] * y + R[2][2] * z;
+  }
+}
+
+// Batch rotations of count vectors from the Earth frame to the body-fixed
+// frame, all with the same attitude
+inline void earth_to_body_batch(std::size_t count,
+                                const direction_cosine_matrix &attitude,
+                                const vector_arrays &earth_coords,
+                                const vector_arrays &body_coords) {
+  const std::array<std::array<double, 3>, 3> R{attitude.matrix()};
+  const vector_arrays e{earth_coords};
+  const vector_arrays b{body_coords};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double x{e[0][i]}, y{e[1][i]}, z{e[2][i]};
+    b[0][i] = R[0][0] * x + R[0][1] * y + R[0][2] * z;
+    b[1][i] = R[1][0] * x + R[1][1] * y + R[1][2] * z;
+    b[2][i] = R[2][0] * x + R[2][1] * y + R[2][2] * z;
+  }
+}
+
+// Batch version of body_angular_vel: body angular velocities of count
+// samples from their attitude and Euler angle rates (yaw does not enter)
+inline void body_angular_vel_batch(std::size_t count, const double *roll,
+                                   const double *pitch, const double *roll_vel,
+                                   const double *pitch_vel,
+                                   const double *yaw_vel,
+                                   const vector_arrays &body_angular_vel) {
+  const vector_arrays w{body_angular_vel};
+
+#pragma omp simd
+  for (std::size_t i = 0; i < count; ++i) {
+    double s_roll, c_roll, s_pitch, c_pitch;
+    batch_sincos(roll[i], s_roll, c_roll);
+    batch_sincos(pitch[i], s_pitch, c_pitch);
+
+    w[0][i] = roll_vel[i] - yaw_vel[i] * s_pitch;
+    w[1][i] = pitch_vel[i] * c_roll + yaw_vel[i] * c_pitch * s_roll;
+    w[2][i] = yaw_vel[i] * c_roll * c_pitch - pitch_vel[i] * s_roll;
+  }
+}
+
+#endif // !FRAMESNROTATIONS_HPP
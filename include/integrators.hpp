@@ -0,0 +1,321 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef INTEGRATORS_HPP
+#define INTEGRATORS_HPP
+
+// Runge-Kutta integrators for fixed-size states (std::array<double, N>), e.g.
+// aircraft_state with aircraft_dynamics from aircraftmotion.hpp.
+//
+// The system is any callable system(time_s, state, derivative) that writes
+// the derivative of state into derivative. Stage buffers are members of the
+// integrator objects, so stepping never allocates; keep one integrator per
+// thread and reuse it.
+//
+// A system may also have the step hooks begin_step(), accept_step() and
+// reject_step() (all three, see has_step_hooks). begin_step() is called once
+// the derivative at the start of a step has been evaluated, then
+// accept_step() or reject_step() tells whether the step was kept; e.g. the
+// caches of multirate.hpp roll back on rejection. accept_step() returns true
+// when the system changes at the end of the step, so the derivative there
+// has to be evaluated again (instead of reusing the last stage).
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+template <typename System, typename = void>
+struct has_step_hooks : std::false_type {};
+
+template <typename System>
+struct has_step_hooks<
+    System,
+    std::void_t<decltype(std::declval<System &>().begin_step()),
+                decltype(bool(std::declval<System &>().accept_step())),
+                decltype(std::declval<System &>().reject_step())>>
+    : std::true_type {};
+
+// classic fourth-order Runge-Kutta with a fixed step
+template <std::size_t N> class RK4_integrator {
+public:
+  using state_type = std::array<double, N>;
+
+  // advance state from time_s to time_s + step_s
+  template <typename System>
+  void step(System &system, double time_s, double step_s, state_type &state) {
+    double half_step_s{0.5 * step_s};
+
+    system(time_s, state, m_k1);
+    if constexpr (has_step_hooks<System>::value) {
+      system.begin_step();
+    }
+    for (std::size_t i = 0; i < N; ++i) {
+      m_stage[i] = state[i] + half_step_s * m_k1[i];
+    }
+    system(time_s + half_step_s, m_stage, m_k2);
+    for (std::size_t i = 0; i < N; ++i) {
+      m_stage[i] = state[i] + half_step_s * m_k2[i];
+    }
+    system(time_s + half_step_s, m_stage, m_k3);
+    for (std::size_t i = 0; i < N; ++i) {
+      m_stage[i] = state[i] + step_s * m_k3[i];
+    }
+    system(time_s + step_s, m_stage, m_k4);
+
+    for (std::size_t i = 0; i < N; ++i) {
+      state[i] += step_s / 6.0 *
+                  (m_k1[i] + 2.0 * m_k2[i] + 2.0 * m_k3[i] + m_k4[i]);
+    }
+    if constexpr (has_step_hooks<System>::value) {
+      system.accept_step();
+    }
+  }
+
+  // advance state from time_s to end_time_s with steps of (at most) step_s;
+  // time_s is updated
+  template <typename System>
+  void integrate(System &system, double &time_s, double end_time_s,
+                 double step_s, state_type &state) {
+    if (!(step_s > 0.0 && std::isfinite(step_s))) {
+      throw std::invalid_argument("RK4_integrator: step must be positive");
+    }
+    while (time_s < end_time_s) {
+      double h{std::min(step_s, end_time_s - time_s)};
+      step(system, time_s, h, state);
+      time_s += h;
+    }
+  }
+
+private:
+  state_type m_k1{}, m_k2{}, m_k3{}, m_k4{}, m_stage{};
+};
+
+// why an adaptive integration stopped before its end time
+enum integration_status : unsigned char {
+  INTEGRATION_OK = 0,
+  // the derivative at the start of a step is not finite
+  INTEGRATION_NON_FINITE = 1,
+  // the step shrank below the resolution of the time
+  INTEGRATION_STEP_TOO_SMALL = 2
+};
+
+// counters of an adaptive integration
+struct integration_stats {
+  std::size_t accepted_steps{0};
+  std::size_t rejected_steps{0};
+  std::size_t derivative_evaluations{0};
+  integration_status status{INTEGRATION_OK};
+};
+
+// Dormand-Prince 5(4) embedded pair with adaptive step size. The error of
+// each step is measured against absolute_tolerance + relative_tolerance *
+// |state| (RMS norm over the components) and the step is rejected when that
+// exceeds one. The last stage of an accepted step is reused as the first
+// stage of the next one (FSAL).
+template <std::size_t N> class DormandPrince54_integrator {
+public:
+  using state_type = std::array<double, N>;
+
+  DormandPrince54_integrator(double absolute_tolerance = 1e-8,
+                             double relative_tolerance = 1e-8)
+      : m_absolute_tolerance{absolute_tolerance},
+        m_relative_tolerance{relative_tolerance} {}
+
+  // forget the stored first stage; needed when the state or the system is
+  // changed between calls to try_step
+  void reset() { m_first_stage_valid = false; }
+
+  // attempt one step of size step_s. On success time_s and state are
+  // advanced and true is returned; otherwise they are left unchanged. In
+  // both cases step_s is replaced by the suggested size for the next try.
+  // A step whose error is not finite (e.g. a stage left the domain of the
+  // system) is rejected and shrunk; a derivative that is not finite at the
+  // start of the step sets the status of stats() to INTEGRATION_NON_FINITE.
+  template <typename System>
+  bool try_step(System &system, double &time_s, double &step_s,
+                state_type &state) {
+    // Butcher tableau
+    const double c2{1.0 / 5.0}, c3{3.0 / 10.0}, c4{4.0 / 5.0}, c5{8.0 / 9.0};
+    const double a21{1.0 / 5.0};
+    const double a31{3.0 / 40.0}, a32{9.0 / 40.0};
+    const double a41{44.0 / 45.0}, a42{-56.0 / 15.0}, a43{32.0 / 9.0};
+    const double a51{19372.0 / 6561.0}, a52{-25360.0 / 2187.0},
+        a53{64448.0 / 6561.0}, a54{-212.0 / 729.0};
+    const double a61{9017.0 / 3168.0}, a62{-355.0 / 33.0},
+        a63{46732.0 / 5247.0}, a64{49.0 / 176.0}, a65{-5103.0 / 18656.0};
+    const double b1{35.0 / 384.0}, b3{500.0 / 1113.0}, b4{125.0 / 192.0},
+        b5{-2187.0 / 6784.0}, b6{11.0 / 84.0};
+    // difference between the fifth- and fourth-order weights
+    const double e1{71.0 / 57600.0}, e3{-71.0 / 16695.0}, e4{71.0 / 1920.0},
+        e5{-17253.0 / 339200.0}, e6{22.0 / 525.0}, e7{-1.0 / 40.0};
+
+    double h{step_s};
+    if (!m_first_stage_valid) {
+      system(time_s, state, m_k1);
+      ++m_stats.derivative_evaluations;
+      m_first_stage_valid = true;
+    }
+    for (double derivative : m_k1) {
+      if (!std::isfinite(derivative)) {
+        m_stats.status = INTEGRATION_NON_FINITE;
+        return false;
+      }
+    }
+    if constexpr (has_step_hooks<System>::value) {
+      system.begin_step();
+    }
+
+    for (std::size_t i = 0; i < N; ++i) {
+      m_stage[i] = state[i] + h * a21 * m_k1[i];
+    }
+    system(time_s + c2 * h, m_stage, m_k2);
+    for (std::size_t i = 0; i < N; ++i) {
+      m_stage[i] = state[i] + h * (a31 * m_k1[i] + a32 * m_k2[i]);
+    }
+    system(time_s + c3 * h, m_stage, m_k3);
+    for (std::size_t i = 0; i < N; ++i) {
+      m_stage[i] =
+          state[i] + h * (a41 * m_k1[i] + a42 * m_k2[i] + a43 * m_k3[i]);
+    }
+    system(time_s + c4 * h, m_stage, m_k4);
+    for (std::size_t i = 0; i < N; ++i) {
+      m_stage[i] = state[i] + h * (a51 * m_k1[i] + a52 * m_k2[i] +
+                                   a53 * m_k3[i] + a54 * m_k4[i]);
+    }
+    system(time_s + c5 * h, m_stage, m_k5);
+    for (std::size_t i = 0; i < N; ++i) {
+      m_stage[i] =
+          state[i] + h * (a61 * m_k1[i] + a62 * m_k2[i] + a63 * m_k3[i] +
+                          a64 * m_k4[i] + a65 * m_k5[i]);
+    }
+    system(time_s + h, m_stage, m_k6);
+    for (std::size_t i = 0; i < N; ++i) {
+      m_candidate[i] =
+          state[i] + h * (b1 * m_k1[i] + b3 * m_k3[i] + b4 * m_k4[i] +
+                          b5 * m_k5[i] + b6 * m_k6[i]);
+    }
+    system(time_s + h, m_candidate, m_k7);
+    m_stats.derivative_evaluations += 6;
+
+    // scaled RMS norm of the local error estimate
+    double error_norm{0.0};
+    for (std::size_t i = 0; i < N; ++i) {
+      double error{h * (e1 * m_k1[i] + e3 * m_k3[i] + e4 * m_k4[i] +
+                        e5 * m_k5[i] + e6 * m_k6[i] + e7 * m_k7[i])};
+      double magnitude{
+          std::max(std::fabs(state[i]), std::fabs(m_candidate[i]))};
+      double scale{m_absolute_tolerance + m_relative_tolerance * magnitude};
+      error_norm += (error / scale) * (error / scale);
+    }
+    error_norm = std::sqrt(error_norm / static_cast<double>(N));
+
+    // step size controller, 0.9 safety factor and growth limited to [0.2, 5];
+    // an error that is not finite shrinks the step the most
+    double factor{0.2};
+    if (error_norm == 0.0) {
+      factor = 5.0;
+    } else if (std::isfinite(error_norm)) {
+      factor = std::min(5.0, std::max(0.2, 0.9 * std::pow(error_norm, -0.2)));
+    }
+
+    if (error_norm <= 1.0) {
+      time_s += h;
+      state = m_candidate;
+      // first same as last
+      m_k1 = m_k7;
+      step_s = h * factor;
+      ++m_stats.accepted_steps;
+      if constexpr (has_step_hooks<System>::value) {
+        if (system.accept_step()) {
+          m_first_stage_valid = false;
+        }
+      }
+      return true;
+    }
+
+    step_s = h * std::min(1.0, factor);
+    ++m_stats.rejected_steps;
+    if constexpr (has_step_hooks<System>::value) {
+      system.reject_step();
+    }
+    return false;
+  }
+
+  // advance state from time_s to end_time_s; step_s is the initial step and
+  // holds the last suggested step on return, time_s is updated. Stops early
+  // when the status of the returned stats is not INTEGRATION_OK.
+  template <typename System>
+  integration_stats integrate(System &system, double &time_s,
+                              double end_time_s, double &step_s,
+                              state_type &state) {
+    if (!(step_s > 0.0 && std::isfinite(step_s))) {
+      throw std::invalid_argument(
+          "DormandPrince54_integrator: step must be positive");
+    }
+    m_stats = integration_stats{};
+    reset();
+    while (time_s < end_time_s) {
+      double remaining_s{end_time_s - time_s};
+      // the last step lands on end_time_s, keeping the suggestion for later
+      bool last_step{step_s >= remaining_s};
+      double h{last_step ? remaining_s : step_s};
+      if (time_s + h == time_s) {
+        m_stats.status = INTEGRATION_STEP_TOO_SMALL;
+        break;
+      }
+      double suggested_s{h};
+      bool accepted{try_step(system, time_s, suggested_s, state)};
+      if (m_stats.status != INTEGRATION_OK) {
+        break;
+      }
+      if (accepted && last_step) {
+        time_s = end_time_s;
+        step_s = std::max(step_s, suggested_s);
+      } else {
+        step_s = suggested_s;
+      }
+    }
+    return m_stats;
+  }
+
+  const integration_stats &stats() const { return m_stats; }
+
+private:
+  double m_absolute_tolerance;
+  double m_relative_tolerance;
+  bool m_first_stage_valid{false};
+  integration_stats m_stats{};
+  state_type m_k1{}, m_k2{}, m_k3{}, m_k4{}, m_k5{}, m_k6{}, m_k7{};
+  state_type m_stage{}, m_candidate{};
+};
+
+#endif // !INTEGRATORS_HPP
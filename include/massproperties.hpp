@@ -0,0 +1,139 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef MASSPROPERTIES_HPP
+#define MASSPROPERTIES_HPP
+
+// Mass properties of an aircraft with the inverse inertia terms precomputed.
+//
+// The inertia tensor uses the convention of aircrafts_EOM: the off-diagonal
+// elements are the tensor entries (minus the products of inertia), e.g.
+// Ixz = -inertia_tensor[0][2]. The symmetry picks, at compile time, which
+// elements are used and how the angular accelerations are evaluated:
+//   diagonal  principal axes, only Ixx, Iyy, Izz
+//   xz_plane  symmetric about the xz plane (Ixz), as in aircrafts_EOM
+//   full      every element, through the inverse of the tensor
+// Scalar is the floating-point type of the computations (float halves the
+// memory traffic of large ensembles, double is the reference).
+
+#include <array>
+
+enum class inertia_symmetry { diagonal, xz_plane, full };
+
+template <typename Scalar = double,
+          inertia_symmetry SYMMETRY = inertia_symmetry::xz_plane>
+class mass_properties {
+public:
+  using scalar_type = Scalar;
+  using tensor_type = std::array<std::array<Scalar, 3>, 3>;
+  static constexpr inertia_symmetry symmetry{SYMMETRY};
+
+  mass_properties(Scalar mass, const tensor_type &inertia_tensor)
+      : m_mass{mass}, m_inverse_mass{Scalar(1) / mass},
+        m_inertia_tensor{inertia_tensor} {
+    const tensor_type &I{inertia_tensor};
+    if constexpr (SYMMETRY == inertia_symmetry::full) {
+      // inverse of the tensor by cofactors
+      Scalar c00{I[1][1] * I[2][2] - I[1][2] * I[2][1]};
+      Scalar c01{I[1][2] * I[2][0] - I[1][0] * I[2][2]};
+      Scalar c02{I[1][0] * I[2][1] - I[1][1] * I[2][0]};
+      Scalar inverse_determinant{
+          Scalar(1) / (I[0][0] * c00 + I[0][1] * c01 + I[0][2] * c02)};
+      m_coefficients = {
+          c00 * inverse_determinant,
+          (I[0][2] * I[2][1] - I[0][1] * I[2][2]) * inverse_determinant,
+          (I[0][1] * I[1][2] - I[0][2] * I[1][1]) * inverse_determinant,
+          c01 * inverse_determinant,
+          (I[0][0] * I[2][2] - I[0][2] * I[2][0]) * inverse_determinant,
+          (I[0][2] * I[1][0] - I[0][0] * I[1][2]) * inverse_determinant,
+          c02 * inverse_determinant,
+          (I[0][1] * I[2][0] - I[0][0] * I[2][1]) * inverse_determinant,
+          (I[0][0] * I[1][1] - I[0][1] * I[1][0]) * inverse_determinant};
+    } else {
+      Scalar Ixx{I[0][0]}, Iyy{I[1][1]}, Izz{I[2][2]};
+      Scalar Ixz{SYMMETRY == inertia_symmetry::xz_plane ? -I[0][2]
+                                                         : Scalar(0)};
+      Scalar inverse_gamma{Scalar(1) / (Ixx * Izz - Ixz * Ixz)};
+      // coefficients c1..c9 of the body-axes moment equations
+      m_coefficients = {((Iyy - Izz) * Izz - Ixz * Ixz) * inverse_gamma,
+                        (Ixx - Iyy + Izz) * Ixz * inverse_gamma,
+                        Izz * inverse_gamma,
+                        Ixz * inverse_gamma,
+                        (Izz - Ixx) / Iyy,
+                        Ixz / Iyy,
+                        Scalar(1) / Iyy,
+                        (Ixx * (Ixx - Iyy) + Ixz * Ixz) * inverse_gamma,
+                        Ixx * inverse_gamma};
+    }
+  }
+
+  Scalar mass() const { return m_mass; }
+  Scalar inverse_mass() const { return m_inverse_mass; }
+  const tensor_type &inertia_tensor() const { return m_inertia_tensor; }
+
+  // angular accelerations (forward, lateral, downward) for the body angular
+  // velocities p, q, r and the moment vector. T is Scalar, or a dual number
+  // (autodiff.hpp) when differentiating the EOM.
+  template <typename T>
+  std::array<T, 3>
+  angular_acceleration(const T &p, const T &q, const T &r,
+                       const std::array<T, 3> &moment_vector) const {
+    const std::array<Scalar, 9> &c{m_coefficients};
+    const T &L{moment_vector[0]}, &M{moment_vector[1]}, &N{moment_vector[2]};
+
+    if constexpr (SYMMETRY == inertia_symmetry::diagonal) {
+      return {c[0] * q * r + c[2] * L, c[4] * p * r + c[6] * M,
+              c[7] * p * q + c[8] * N};
+    } else if constexpr (SYMMETRY == inertia_symmetry::xz_plane) {
+      return {(c[0] * r + c[1] * p) * q + c[2] * L + c[3] * N,
+              c[4] * p * r - c[5] * (p * p - r * r) + c[6] * M,
+              (c[7] * p - c[1] * r) * q + c[3] * L + c[8] * N};
+    } else {
+      // J (moment - w x (I w))
+      const tensor_type &I{m_inertia_tensor};
+      T hx{I[0][0] * p + I[0][1] * q + I[0][2] * r};
+      T hy{I[1][0] * p + I[1][1] * q + I[1][2] * r};
+      T hz{I[2][0] * p + I[2][1] * q + I[2][2] * r};
+      T x{L - (q * hz - r * hy)};
+      T y{M - (r * hx - p * hz)};
+      T z{N - (p * hy - q * hx)};
+      return {c[0] * x + c[1] * y + c[2] * z, c[3] * x + c[4] * y + c[5] * z,
+              c[6] * x + c[7] * y + c[8] * z};
+    }
+  }
+
+private:
+  Scalar m_mass;
+  Scalar m_inverse_mass;
+  tensor_type m_inertia_tensor;
+  // c1..c9 for diagonal and xz_plane, the inverse tensor (row major) for
+  // full
+  std::array<Scalar, 9> m_coefficients{};
+};
+
+#endif // !MASSPROPERTIES_HPP
@@ -0,0 +1,292 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef MULTIRATE_HPP
+#define MULTIRATE_HPP
+
+// Cached evaluation of slowly varying subsystems (atmosphere, aerodynamic
+// tables, ...) during the integration of the EOM.
+//
+// A cached_subsystem computes its output from a key (e.g. the height) and
+// reuses it while every key component stays within its tolerance of the
+// key of the last refresh and less than update_period_s has passed since
+// then; otherwise it calls the function again. When the function is
+// templated on the scalar type and returns a std::array (like the generic
+// atmosphere functions), it is evaluated with dual numbers (autodiff.hpp)
+// and the reused output is the first-order expansion around the refresh
+// key: the error is quadratic in the key change and a refresh moves the
+// output by that much only. Other functions give a held (constant) output.
+// With a zero tolerance it refreshes whenever the key has changed (at step
+// boundaries during an integration, see below).
+//
+// Inside an integration step the expansion is not refreshed, as a jump
+// between two stages would look like truncation error to the error
+// estimate of an adaptive integrator and shrink the steps. multirate_system
+// wraps the system and its subsystems and follows the steps through the
+// hooks of integrators.hpp: the subsystems are checkpointed when a step
+// begins, rolled back when it is rejected (a retried step sees them as at
+// the first try) and committed when it is accepted, refreshing then the
+// ones that went out of tolerance. A held output that refreshes makes the
+// integrator evaluate the start of the next step again. The key may thus
+// drift beyond the tolerance by its change over one step; max_key_drift()
+// is the largest key change a cached output was used for in the accepted
+// steps.
+
+#include "atmosphere.hpp"
+#include "autodiff.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// update period of a cached_subsystem without a time limit
+const double MULTIRATE_NO_PERIOD_s{std::numeric_limits<double>::infinity()};
+// relative slack of the update period: the times are sums of steps, so a
+// period of a whole number of steps may elapse a few ulps short
+const double MULTIRATE_PERIOD_SLACK{1e-9};
+
+// gradient of the output of a first-order cached_subsystem (nothing for a
+// held output)
+template <typename Output, std::size_t KEYS, bool FIRST_ORDER>
+struct cached_gradient {};
+
+template <typename Output, std::size_t KEYS>
+struct cached_gradient<Output, KEYS, true> {
+  std::array<std::array<double, KEYS>, std::tuple_size_v<Output>> gradient{};
+};
+
+template <std::size_t KEYS, typename Function> class cached_subsystem {
+public:
+  using key_type = std::array<double, KEYS>;
+  using output_type =
+      std::decay_t<std::invoke_result_t<Function &, const key_type &>>;
+  static constexpr bool first_order{
+      std::is_invocable_v<Function &, const std::array<dual<KEYS>, KEYS> &>};
+
+  // tolerance is the allowed change of each key component and
+  // update_period_s the longest time between refreshes. Both are checked
+  // only outside integration steps (at their boundaries, see commit()):
+  // within a step the cached output is used however far the key moves, so
+  // a held output may be off by its change over a whole step.
+  cached_subsystem(Function function, const key_type &tolerance,
+                   double update_period_s = MULTIRATE_NO_PERIOD_s)
+      : m_function{std::move(function)}, m_tolerance{tolerance},
+        m_update_period_s{update_period_s},
+        m_expiry_s{update_period_s * (1.0 - MULTIRATE_PERIOD_SLACK)} {}
+
+  // output for the key at time_s, refreshed when the cached one is invalid
+  // (and no step is in progress)
+  const output_type &operator()(double time_s, const key_type &key) {
+    ++m_evaluations;
+    m_current.last_time_s = time_s;
+    m_current.last_key = key;
+    if (!m_current.valid || (!m_in_step && stale(time_s, key))) {
+      refresh(time_s, key);
+      return m_current.output;
+    }
+    key_type change;
+    for (std::size_t i = 0; i < KEYS; ++i) {
+      change[i] = key[i] - m_current.key[i];
+      m_max_key_drift[i] = std::fmax(m_max_key_drift[i], std::fabs(change[i]));
+    }
+    if constexpr (first_order) {
+      for (std::size_t j = 0; j < m_output.size(); ++j) {
+        m_output[j] = m_current.output[j];
+        for (std::size_t i = 0; i < KEYS; ++i) {
+          m_output[j] += m_current.gradient[j][i] * change[i];
+        }
+      }
+      return m_output;
+    } else {
+      return m_current.output;
+    }
+  }
+
+  // a step begins: restore point of rollback(), no refreshes until the step
+  // ends
+  void checkpoint() {
+    m_checkpoint = m_current;
+    m_checkpoint_drift = m_max_key_drift;
+    m_in_step = true;
+  }
+  // the step is accepted: refresh when the output is no longer valid at the
+  // last evaluation (the end of the step). Returns true when a held output
+  // changed, i.e. the derivative there has to be evaluated again.
+  bool commit() {
+    m_in_step = false;
+    if (m_current.valid &&
+        stale(m_current.last_time_s, m_current.last_key)) {
+      refresh(m_current.last_time_s, m_current.last_key);
+      return !first_order;
+    }
+    return false;
+  }
+  // the step is rejected: back to the checkpoint
+  void rollback() {
+    m_current = m_checkpoint;
+    m_max_key_drift = m_checkpoint_drift;
+    m_in_step = false;
+    ++m_rollbacks;
+  }
+  // force a refresh at the next evaluation, e.g. after the state jumps
+  void invalidate() {
+    m_current.valid = false;
+    m_checkpoint.valid = false;
+  }
+
+  std::uint64_t evaluations() const { return m_evaluations; }
+  std::uint64_t refreshes() const { return m_refreshes; }
+  std::uint64_t rollbacks() const { return m_rollbacks; }
+  const key_type &max_key_drift() const { return m_max_key_drift; }
+  const key_type &tolerance() const { return m_tolerance; }
+  double update_period_s() const { return m_update_period_s; }
+
+private:
+  struct cache_entry : cached_gradient<output_type, KEYS, first_order> {
+    bool valid{false};
+    // time and key of the last refresh and the output there
+    double time_s{0.0};
+    key_type key{};
+    output_type output{};
+    // time and key of the last evaluation
+    double last_time_s{0.0};
+    key_type last_key{};
+  };
+
+  bool stale(double time_s, const key_type &key) const {
+    bool expired{time_s < m_current.time_s ||
+                 time_s - m_current.time_s >= m_expiry_s};
+    for (std::size_t i = 0; i < KEYS; ++i) {
+      expired = expired || !(std::fabs(key[i] - m_current.key[i]) <=
+                             m_tolerance[i]);
+    }
+    return expired;
+  }
+
+  void refresh(double time_s, const key_type &key) {
+    if constexpr (first_order) {
+      std::array<dual<KEYS>, KEYS> variables;
+      for (std::size_t i = 0; i < KEYS; ++i) {
+        variables[i] = dual<KEYS>::variable(key[i], i);
+      }
+      auto output{m_function(variables)};
+      for (std::size_t j = 0; j < output.size(); ++j) {
+        m_current.output[j] = output[j].value;
+        m_current.gradient[j] = output[j].gradient;
+      }
+    } else {
+      m_current.output = m_function(key);
+    }
+    m_current.key = key;
+    m_current.time_s = time_s;
+    m_current.valid = true;
+    ++m_refreshes;
+  }
+
+  Function m_function;
+  key_type m_tolerance;
+  double m_update_period_s;
+  // elapsed time after which the output expires
+  double m_expiry_s;
+  cache_entry m_current;
+  cache_entry m_checkpoint;
+  // first-order output at the last evaluation
+  output_type m_output{};
+  bool m_in_step{false};
+  std::uint64_t m_evaluations{0};
+  std::uint64_t m_refreshes{0};
+  std::uint64_t m_rollbacks{0};
+  key_type m_max_key_drift{};
+  key_type m_checkpoint_drift{};
+};
+
+// Wraps an integrator system (e.g. aircraft_dynamics whose force model
+// uses the subsystems) and forwards the step hooks to the subsystems. Holds
+// references; the system and the subsystems must outlive it.
+template <typename System, typename... Subsystems> class multirate_system {
+public:
+  multirate_system(System &system, Subsystems &...subsystems)
+      : m_system{system}, m_subsystems{subsystems...} {}
+
+  template <typename State>
+  void operator()(double time_s, const State &state, State &derivative) {
+    m_system(time_s, state, derivative);
+  }
+
+  void begin_step() {
+    std::apply([](auto &...subsystem) { (subsystem.checkpoint(), ...); },
+               m_subsystems);
+  }
+  // true when a held output changed at the end of the step
+  bool accept_step() {
+    return std::apply(
+        [](auto &...subsystem) { return (0 | ... | subsystem.commit()) != 0; },
+        m_subsystems);
+  }
+  void reject_step() {
+    std::apply([](auto &...subsystem) { (subsystem.rollback(), ...); },
+               m_subsystems);
+  }
+
+private:
+  System &m_system;
+  std::tuple<Subsystems &...> m_subsystems;
+};
+
+// positions of the outputs of ISA_evaluation
+enum cached_ISA_index : std::size_t {
+  CACHED_ISA_TEMPERATURE,
+  CACHED_ISA_PRESSURE,
+  CACHED_ISA_DENSITY,
+  CACHED_ISA_SOUND_SPEED,
+  CACHED_ISA_SIZE
+};
+
+// ISA model as the function of a cached subsystem keyed by the height;
+// generic, so the cache is first order
+struct ISA_evaluation {
+  template <typename Scalar>
+  std::array<Scalar, CACHED_ISA_SIZE>
+  operator()(const std::array<Scalar, 1> &height_m) const {
+    Scalar temperature_K{ISA_temperature(height_m[0])};
+    Scalar pressure_Pa{ISA_airpressure(temperature_K, height_m[0])};
+    return {temperature_K, pressure_Pa, ISA_density(temperature_K, pressure_Pa),
+            ISA_soundspeed(temperature_K)};
+  }
+};
+
+// atmosphere refreshed when the height changes by more than the tolerance
+// (or after the update period):
+//   cached_atmosphere atmosphere{ISA_evaluation{}, {height_tolerance_m}};
+using cached_atmosphere = cached_subsystem<1, ISA_evaluation>;
+
+#endif // !MULTIRATE_HPP
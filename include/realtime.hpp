@@ -0,0 +1,416 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef REALTIME_HPP
+#define REALTIME_HPP
+
+// Fixed-rate real-time execution of the aircraft model (Linux).
+//
+// realtime_simulation advances the state by one RK4 step of the frame
+// period per frame. Frame k starts at the absolute time start + k period:
+// the loop sleeps with clock_nanosleep(TIMER_ABSTIME) until spin_s before
+// it and spins on the clock for the rest, so the wake-up does not depend on
+// the scheduler's timer slack. A frame that ends after the start of the
+// next one is a deadline miss; the schedule stays absolute, so the frames
+// behind start right away until the loop catches up.
+//
+// Controls come in and telemetry goes out through lock-free single-producer
+// single-consumer rings (spsc_ring), so the loop never blocks on the I/O
+// threads: each frame uses the newest controls in the ring and a telemetry
+// record that does not fit is dropped and counted. realtime_stats holds
+// the frame counters and the histograms of execution time and wake-up
+// jitter. loopback_io stands in for the external I/O of a rig.
+//
+// The aircraft model follows the convention of trim.hpp:
+//   model(state, controls, force_vector, moment_vector)
+
+#include "integrators.hpp"
+#include "massproperties.hpp"
+#include "trim.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+
+const std::size_t REALTIME_CACHE_LINE_SIZE{64};
+// time spun before the start of a frame instead of sleeping
+const double REALTIME_SPIN_s{100e-6};
+const std::int64_t REALTIME_HISTOGRAM_BIN_ns{1000};
+const std::size_t REALTIME_HISTOGRAM_BINS{1000};
+// sleep of loopback_io when it has nothing to read
+const double REALTIME_LOOPBACK_POLL_s{50e-6};
+
+// function to get the time of the monotonic clock in ns
+inline std::int64_t monotonic_time_ns() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<std::int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+// function to wait until the monotonic clock reaches deadline_ns: sleeps
+// until spin_ns before it and spins for the rest
+inline void sleep_until_ns(std::int64_t deadline_ns, std::int64_t spin_ns) {
+  std::int64_t wake_ns{deadline_ns - spin_ns};
+  if (monotonic_time_ns() < wake_ns) {
+    timespec wake{static_cast<time_t>(wake_ns / 1000000000),
+                  static_cast<long>(wake_ns % 1000000000)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr) ==
+           EINTR) {
+    }
+  }
+  while (monotonic_time_ns() < deadline_ns) {
+  }
+}
+
+// Function to give the calling thread a SCHED_FIFO priority, pin it to a
+// cpu (when cpu >= 0) and lock the process memory. Returns false when any
+// of it is not permitted; the thread then keeps running normally.
+inline bool request_realtime_scheduling(int priority, int cpu = -1) {
+  bool granted{true};
+  sched_param parameters{};
+  parameters.sched_priority = priority;
+  granted &= pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters) ==
+             0;
+  if (cpu >= 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    granted &=
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+  }
+  granted &= mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+  return granted;
+}
+
+// Lock-free ring buffer for one producer thread and one consumer thread.
+// CAPACITY is a power of two. The indices only grow; each side caches the
+// other side's index and reloads it only when the ring looks full (empty).
+template <typename T, std::size_t CAPACITY> class spsc_ring {
+  static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0,
+                "the capacity of spsc_ring is a power of two");
+  static_assert(std::is_trivially_copyable_v<T>,
+                "spsc_ring holds trivially copyable values");
+
+public:
+  static constexpr std::size_t capacity{CAPACITY};
+
+  // producer side; false when the ring is full
+  bool try_push(const T &value) {
+    std::size_t head{m_head.load(std::memory_order_relaxed)};
+    if (head - m_cached_tail == CAPACITY) {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (head - m_cached_tail == CAPACITY) {
+        return false;
+      }
+    }
+    m_slots[head & (CAPACITY - 1)] = value;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side; false when the ring is empty
+  bool try_pop(T &value) {
+    std::size_t tail{m_tail.load(std::memory_order_relaxed)};
+    if (tail == m_cached_head) {
+      m_cached_head = m_head.load(std::memory_order_acquire);
+      if (tail == m_cached_head) {
+        return false;
+      }
+    }
+    value = m_slots[tail & (CAPACITY - 1)];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side; pops everything and keeps the newest value
+  bool pop_latest(T &value) {
+    bool popped{false};
+    while (try_pop(value)) {
+      popped = true;
+    }
+    return popped;
+  }
+
+  // number of values in the ring (approximate while the other side works)
+  std::size_t size() const {
+    return m_head.load(std::memory_order_acquire) -
+           m_tail.load(std::memory_order_acquire);
+  }
+
+private:
+  // producer cache line
+  alignas(REALTIME_CACHE_LINE_SIZE) std::atomic<std::size_t> m_head{0};
+  std::size_t m_cached_tail{0};
+  // consumer cache line
+  alignas(REALTIME_CACHE_LINE_SIZE) std::atomic<std::size_t> m_tail{0};
+  std::size_t m_cached_head{0};
+  alignas(REALTIME_CACHE_LINE_SIZE) std::array<T, CAPACITY> m_slots{};
+};
+
+// Histogram of durations in bins of bin_width_ns; the last bin counts
+// everything longer than the others cover. Allocates only on construction.
+class frame_time_histogram {
+public:
+  explicit frame_time_histogram(
+      std::int64_t bin_width_ns = REALTIME_HISTOGRAM_BIN_ns,
+      std::size_t bins = REALTIME_HISTOGRAM_BINS)
+      : m_bin_width_ns{std::max<std::int64_t>(bin_width_ns, 1)},
+        m_counts(std::max<std::size_t>(bins, 1) + 1, 0) {}
+
+  void record(std::int64_t duration_ns) {
+    duration_ns = std::max<std::int64_t>(duration_ns, 0);
+    std::size_t bin{std::min(static_cast<std::size_t>(duration_ns /
+                                                      m_bin_width_ns),
+                             m_counts.size() - 1)};
+    ++m_counts[bin];
+    ++m_count;
+    m_total_ns += duration_ns;
+    m_max_ns = std::max(m_max_ns, duration_ns);
+  }
+
+  std::uint64_t count() const { return m_count; }
+  std::int64_t max_ns() const { return m_max_ns; }
+  double mean_ns() const {
+    return m_count == 0 ? 0.0 : static_cast<double>(m_total_ns) / m_count;
+  }
+  std::int64_t bin_width_ns() const { return m_bin_width_ns; }
+  // the last bin is the overflow bin
+  const std::vector<std::uint64_t> &counts() const { return m_counts; }
+
+  // upper edge of the bin holding the given fraction of the durations (the
+  // largest duration for the overflow bin)
+  std::int64_t percentile_ns(double fraction) const {
+    std::uint64_t target{static_cast<std::uint64_t>(
+        std::clamp(fraction, 0.0, 1.0) * static_cast<double>(m_count))};
+    std::uint64_t sum{0};
+    for (std::size_t bin = 0; bin + 1 < m_counts.size(); ++bin) {
+      sum += m_counts[bin];
+      if (sum >= target && sum > 0) {
+        return std::min(static_cast<std::int64_t>(bin + 1) * m_bin_width_ns,
+                        m_max_ns);
+      }
+    }
+    return m_max_ns;
+  }
+
+private:
+  std::int64_t m_bin_width_ns;
+  std::vector<std::uint64_t> m_counts;
+  std::uint64_t m_count{0};
+  std::int64_t m_total_ns{0};
+  std::int64_t m_max_ns{0};
+};
+
+// record sent to the telemetry ring every frame
+struct realtime_telemetry {
+  std::uint64_t frame;
+  // simulation time at the end of the frame
+  double time_s;
+  aircraft_state state;
+  aircraft_controls controls;
+  // wake-up delay after the frame start and time spent in the frame
+  std::int64_t jitter_ns;
+  std::int64_t execution_ns;
+};
+
+struct realtime_stats {
+  std::uint64_t frames{0};
+  std::uint64_t deadline_misses{0};
+  std::uint64_t telemetry_drops{0};
+  // frames that found new controls in the ring
+  std::uint64_t control_updates{0};
+  frame_time_histogram execution;
+  frame_time_histogram jitter;
+};
+
+template <typename AircraftModel,
+          inertia_symmetry SYMMETRY = inertia_symmetry::xz_plane,
+          std::size_t CONTROL_CAPACITY = 64,
+          std::size_t TELEMETRY_CAPACITY = 1024>
+class realtime_simulation {
+public:
+  using control_ring = spsc_ring<aircraft_controls, CONTROL_CAPACITY>;
+  using telemetry_ring = spsc_ring<realtime_telemetry, TELEMETRY_CAPACITY>;
+
+  realtime_simulation(AircraftModel model,
+                      const mass_properties<double, SYMMETRY> &mass_properties,
+                      const aircraft_state &initial_state,
+                      const aircraft_controls &initial_controls,
+                      double period_s, double spin_s = REALTIME_SPIN_s)
+      : m_model{std::move(model)}, m_mass_properties{mass_properties},
+        m_state{initial_state}, m_controls{initial_controls},
+        m_period_s{period_s},
+        m_period_ns{static_cast<std::int64_t>(period_s * 1e9 + 0.5)},
+        m_spin_ns{static_cast<std::int64_t>(spin_s * 1e9 + 0.5)} {}
+
+  // rings of the I/O threads: the producer of the controls and the consumer
+  // of the telemetry
+  control_ring &controls() { return m_control_ring; }
+  telemetry_ring &telemetry() { return m_telemetry_ring; }
+
+  // run frames on the calling thread until frame_count frames have run (0:
+  // until stop()); can be called again to continue
+  void run(std::uint64_t frame_count = 0) {
+    m_stop.store(false, std::memory_order_relaxed);
+    auto system = [this](double, const aircraft_state &state,
+                         aircraft_state &derivative) {
+      derivative = aircraft_model_derivative(m_model, m_mass_properties,
+                                             state, m_controls);
+    };
+    std::int64_t start_ns{monotonic_time_ns() + m_period_ns};
+    for (std::uint64_t k = 0; frame_count == 0 || k < frame_count; ++k) {
+      if (m_stop.load(std::memory_order_relaxed)) {
+        break;
+      }
+      std::int64_t frame_start_ns{start_ns + static_cast<std::int64_t>(k) *
+                                                 m_period_ns};
+      sleep_until_ns(frame_start_ns, m_spin_ns);
+      std::int64_t wake_ns{monotonic_time_ns()};
+
+      m_stats.control_updates += m_control_ring.pop_latest(m_controls);
+      double time_s{static_cast<double>(m_stats.frames) * m_period_s};
+      m_integrator.step(system, time_s, m_period_s, m_state);
+
+      realtime_telemetry record{m_stats.frames,
+                                time_s + m_period_s,
+                                m_state,
+                                m_controls,
+                                wake_ns - frame_start_ns,
+                                monotonic_time_ns() - wake_ns};
+      m_stats.telemetry_drops += !m_telemetry_ring.try_push(record);
+
+      std::int64_t end_ns{monotonic_time_ns()};
+      m_stats.execution.record(end_ns - wake_ns);
+      m_stats.jitter.record(record.jitter_ns);
+      m_stats.deadline_misses += end_ns > frame_start_ns + m_period_ns;
+      ++m_stats.frames;
+    }
+  }
+
+  // ask run() to return before its next frame; callable from any thread
+  void stop() { m_stop.store(true, std::memory_order_relaxed); }
+
+  // read these while run() is not running
+  const aircraft_state &state() const { return m_state; }
+  double time_s() const {
+    return static_cast<double>(m_stats.frames) * m_period_s;
+  }
+  const realtime_stats &stats() const { return m_stats; }
+
+  double period_s() const { return m_period_s; }
+
+private:
+  AircraftModel m_model;
+  mass_properties<double, SYMMETRY> m_mass_properties;
+  aircraft_state m_state;
+  aircraft_controls m_controls;
+  double m_period_s;
+  std::int64_t m_period_ns;
+  std::int64_t m_spin_ns;
+  RK4_integrator<AIRCRAFT_STATE_SIZE> m_integrator;
+  realtime_stats m_stats;
+  std::atomic<bool> m_stop{false};
+  control_ring m_control_ring;
+  telemetry_ring m_telemetry_ring;
+};
+
+// Local stand-in for the external I/O of a rig: a thread that reads the
+// telemetry of the simulation and answers every record with the controls
+// control_law(telemetry) returns.
+template <typename Simulation, typename ControlLaw> class loopback_io {
+public:
+  loopback_io(Simulation &simulation, ControlLaw control_law)
+      : m_simulation{simulation}, m_control_law{std::move(control_law)},
+        m_thread{[this] { loop(); }} {}
+
+  loopback_io(const loopback_io &) = delete;
+  loopback_io &operator=(const loopback_io &) = delete;
+
+  ~loopback_io() { stop(); }
+
+  // drain the telemetry left in the ring and join the thread
+  void stop() {
+    m_stop.store(true, std::memory_order_release);
+    if (m_thread.joinable()) {
+      m_thread.join();
+    }
+  }
+
+  // read these after stop()
+  std::uint64_t received() const { return m_received; }
+  std::uint64_t sent() const { return m_sent; }
+  // controls that did not fit in the ring
+  std::uint64_t rejected() const { return m_rejected; }
+  const realtime_telemetry &last() const { return m_last; }
+
+private:
+  void loop() {
+    timespec poll{0, static_cast<long>(REALTIME_LOOPBACK_POLL_s * 1e9)};
+    while (true) {
+      bool stopping{m_stop.load(std::memory_order_acquire)};
+      bool any{false};
+      while (m_simulation.telemetry().try_pop(m_last)) {
+        any = true;
+        ++m_received;
+        if (m_simulation.controls().try_push(m_control_law(m_last))) {
+          ++m_sent;
+        } else {
+          ++m_rejected;
+        }
+      }
+      if (stopping) {
+        break;
+      }
+      if (!any) {
+        nanosleep(&poll, nullptr);
+      }
+    }
+  }
+
+  Simulation &m_simulation;
+  ControlLaw m_control_law;
+  std::atomic<bool> m_stop{false};
+  std::uint64_t m_received{0};
+  std::uint64_t m_sent{0};
+  std::uint64_t m_rejected{0};
+  realtime_telemetry m_last{};
+  std::thread m_thread;
+};
+
+#endif // !REALTIME_HPP
@@ -0,0 +1,247 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+// Work-stealing thread pool for data-parallel loops.
+//
+// parallel_for splits [0, count) into fixed chunks of chunk_size elements
+// (the chunk boundaries depend only on count and chunk_size, never on the
+// number of threads, so per-chunk results are reproducible). Each thread
+// starts with a contiguous block of chunks and, when it runs out, steals
+// single chunks from the end of the other threads' blocks. The calling
+// thread takes part in the work. A parallel_for issued from inside a chunk
+// runs serially on the calling thread.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class thread_pool {
+public:
+  // thread_count includes the thread that calls parallel_for
+  explicit thread_pool(std::size_t thread_count = default_thread_count())
+      : m_queues(std::max<std::size_t>(thread_count, 1)) {
+    for (std::size_t i = 1; i < m_queues.size(); ++i) {
+      m_threads.emplace_back([this, i] { worker_loop(i); });
+    }
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock{m_wake_mutex};
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &thread : m_threads) {
+      thread.join();
+    }
+  }
+
+  std::size_t size() const { return m_queues.size(); }
+
+  static std::size_t default_thread_count() {
+    return std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  // call function(begin, end) for every chunk of [0, count); blocks until all
+  // chunks are done and rethrows the first exception thrown by function
+  template <typename Function>
+  void parallel_for(std::size_t count, std::size_t chunk_size,
+                    Function &&function) {
+    chunk_size = std::max<std::size_t>(chunk_size, 1);
+    std::size_t chunk_count{(count + chunk_size - 1) / chunk_size};
+    if (chunk_count == 0) {
+      return;
+    }
+    if (chunk_count == 1 || size() == 1 || inside_chunk()) {
+      for (std::size_t begin = 0; begin < count; begin += chunk_size) {
+        function(begin, std::min(begin + chunk_size, count));
+      }
+      return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock{m_submit_mutex};
+    job current_job;
+    current_job.count = count;
+    current_job.chunk_size = chunk_size;
+    current_job.function =
+        const_cast<void *>(static_cast<const void *>(&function));
+    current_job.run = [](void *f, std::size_t begin, std::size_t end) {
+      (*static_cast<std::remove_reference_t<Function> *>(f))(begin, end);
+    };
+    current_job.pending.store(chunk_count);
+
+    // contiguous blocks of chunks, one per thread
+    std::size_t thread_count{size()};
+    for (std::size_t i = 0; i < thread_count; ++i) {
+      std::lock_guard<std::mutex> lock{m_queues[i].mutex};
+      m_queues[i].begin = chunk_count * i / thread_count;
+      m_queues[i].end = chunk_count * (i + 1) / thread_count;
+    }
+    {
+      std::lock_guard<std::mutex> lock{m_wake_mutex};
+      m_job = &current_job;
+      ++m_generation;
+    }
+    m_wake.notify_all();
+
+    run_chunks(0, current_job);
+    while (current_job.pending.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{m_wake_mutex};
+      m_job = nullptr;
+    }
+    // workers still inside run_chunks hold no chunk and leave it without
+    // touching the job again
+    while (m_active_workers.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+    if (current_job.error) {
+      std::rethrow_exception(current_job.error);
+    }
+  }
+
+private:
+  struct job {
+    std::size_t count{0};
+    std::size_t chunk_size{1};
+    void *function{nullptr};
+    void (*run)(void *, std::size_t, std::size_t){nullptr};
+    std::atomic<std::size_t> pending{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+  };
+
+  // chunks [begin, end) still owned by one thread
+  struct chunk_queue {
+    std::mutex mutex;
+    std::size_t begin{0};
+    std::size_t end{0};
+  };
+
+  static bool &inside_chunk() {
+    static thread_local bool flag{false};
+    return flag;
+  }
+
+  // next chunk for thread index: the front of its own block, otherwise the
+  // back of another thread's block
+  bool take_chunk(std::size_t index, std::size_t &chunk) {
+    {
+      chunk_queue &own{m_queues[index]};
+      std::lock_guard<std::mutex> lock{own.mutex};
+      if (own.begin < own.end) {
+        chunk = own.begin++;
+        return true;
+      }
+    }
+    for (std::size_t k = 1; k < m_queues.size(); ++k) {
+      chunk_queue &victim{m_queues[(index + k) % m_queues.size()]};
+      std::lock_guard<std::mutex> lock{victim.mutex};
+      if (victim.begin < victim.end) {
+        chunk = --victim.end;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run_chunks(std::size_t index, job &current_job) {
+    std::size_t chunk{0};
+    inside_chunk() = true;
+    while (take_chunk(index, chunk)) {
+      std::size_t begin{chunk * current_job.chunk_size};
+      std::size_t end{std::min(begin + current_job.chunk_size,
+                               current_job.count)};
+      try {
+        current_job.run(current_job.function, begin, end);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{current_job.error_mutex};
+        if (!current_job.error) {
+          current_job.error = std::current_exception();
+        }
+      }
+      current_job.pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    inside_chunk() = false;
+  }
+
+  void worker_loop(std::size_t index) {
+    std::size_t seen_generation{0};
+    while (true) {
+      job *current_job{nullptr};
+      {
+        std::unique_lock<std::mutex> lock{m_wake_mutex};
+        m_wake.wait(lock, [&] {
+          return m_stop ||
+                 (m_job != nullptr && m_generation != seen_generation);
+        });
+        if (m_stop) {
+          return;
+        }
+        seen_generation = m_generation;
+        current_job = m_job;
+        m_active_workers.fetch_add(1, std::memory_order_acq_rel);
+      }
+      run_chunks(index, *current_job);
+      m_active_workers.fetch_sub(1, std::memory_order_acq_rel);
+    }
+  }
+
+  std::vector<chunk_queue> m_queues;
+  std::vector<std::thread> m_threads;
+  std::mutex m_submit_mutex;
+  std::mutex m_wake_mutex;
+  std::condition_variable m_wake;
+  job *m_job{nullptr};
+  std::size_t m_generation{0};
+  bool m_stop{false};
+  std::atomic<std::size_t> m_active_workers{0};
+};
+
+// pool shared by the whole program, one thread per core, built on first use
+inline thread_pool &default_thread_pool() {
+  static thread_pool pool;
+  return pool;
+}
+
+#endif // !THREADPOOL_HPP
@@ -0,0 +1,518 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef TRAJECTORYLOG_HPP
+#define TRAJECTORYLOG_HPP
+
+// Binary trajectory logging.
+//
+// File layout (native byte order, every section a multiple of 8 bytes):
+//   trajectory_file_header
+//   channel names, TRAJECTORY_NAME_SIZE bytes each
+//   blocks: row count (uint64), then the values of every channel in that
+//   block, one column after the other (row count doubles each)
+// Each block holds up to the block size of the writer. Columns inside a
+// block are contiguous, so a reader gets a channel as a few long runs
+// without parsing. Blocks are appended as they fill, so a run that stops
+// early keeps every complete block.
+//
+// trajectory_writer fills one block while a background thread writes the
+// other (double buffering); the simulation thread only copies values and
+// waits only when the disk falls a whole block behind (stall_count()).
+// trajectory_recorder builds the rows from the aircraft state (air data
+// included) and user channels, with decimation and event triggers.
+// trajectory_reader maps a file into memory. tools/traj2csv converts files
+// to CSV offline.
+
+#include "aircraftmotion.hpp"
+#include "airdata.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const std::size_t TRAJECTORY_BLOCK_ROWS{4096};
+const std::size_t TRAJECTORY_NAME_SIZE{32};
+const std::uint32_t TRAJECTORY_VERSION{1};
+const char TRAJECTORY_MAGIC[9]{"FMTRAJLG"};
+const std::uint32_t TRAJECTORY_BYTE_ORDER_MARK{0x01020304};
+
+struct trajectory_file_header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint64_t channel_count;
+  std::uint64_t block_rows;
+};
+
+// Writes rows of channel values to a trajectory file from a background
+// thread. Errors of the background thread are thrown by the next record()
+// or by close().
+class trajectory_writer {
+public:
+  trajectory_writer(const std::string &path,
+                    const std::vector<std::string> &channel_names,
+                    std::size_t block_rows = TRAJECTORY_BLOCK_ROWS)
+      : m_channel_count{channel_names.size()},
+        m_block_rows{std::max<std::size_t>(block_rows, 1)} {
+    if (m_channel_count == 0) {
+      throw std::invalid_argument("trajectory_writer: no channels");
+    }
+    m_file = std::fopen(path.c_str(), "wb");
+    if (m_file == nullptr) {
+      throw std::runtime_error("trajectory_writer: cannot create " + path);
+    }
+    // the destructor does not run when the constructor throws
+    try {
+      start(path, channel_names);
+    } catch (...) {
+      std::fclose(m_file);
+      m_file = nullptr;
+      throw;
+    }
+  }
+
+  trajectory_writer(const trajectory_writer &) = delete;
+  trajectory_writer &operator=(const trajectory_writer &) = delete;
+
+  ~trajectory_writer() {
+    try {
+      close();
+    } catch (...) {
+      // close() explicitly to see write errors
+    }
+  }
+
+  std::size_t channel_count() const { return m_channel_count; }
+  std::size_t row_count() const { return m_row_count; }
+  // times record() waited for the background thread
+  std::size_t stall_count() const { return m_stall_count; }
+
+  // append one row of channel_count() values
+  void record(const double *row) {
+    double *block{m_blocks[m_front].data() + m_fill};
+    for (std::size_t c = 0; c < m_channel_count; ++c) {
+      block[c * m_block_rows] = row[c];
+    }
+    ++m_row_count;
+    if (++m_fill == m_block_rows) {
+      submit();
+    }
+  }
+
+  // write the last rows and close the file; the thread is joined and the
+  // file closed even when a write failed, then the failure is thrown
+  void close() {
+    if (m_file == nullptr) {
+      return;
+    }
+    bool submitted{true};
+    if (m_fill > 0) {
+      try {
+        submit();
+      } catch (const std::runtime_error &) {
+        submitted = false;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+    bool closed{std::fclose(m_file) == 0};
+    m_file = nullptr;
+    if (!submitted || m_error || !closed) {
+      throw std::runtime_error("trajectory_writer: write failed");
+    }
+  }
+
+private:
+  // write the header and start the background thread
+  void start(const std::string &path,
+             const std::vector<std::string> &channel_names) {
+    trajectory_file_header header{};
+    std::memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.version = TRAJECTORY_VERSION;
+    header.byte_order = TRAJECTORY_BYTE_ORDER_MARK;
+    header.channel_count = m_channel_count;
+    header.block_rows = m_block_rows;
+    std::vector<char> names(m_channel_count * TRAJECTORY_NAME_SIZE, '\0');
+    for (std::size_t c = 0; c < m_channel_count; ++c) {
+      std::memcpy(names.data() + c * TRAJECTORY_NAME_SIZE,
+                  channel_names[c].data(),
+                  std::min(channel_names[c].size(), TRAJECTORY_NAME_SIZE - 1));
+    }
+    if (std::fwrite(&header, sizeof(header), 1, m_file) != 1 ||
+        std::fwrite(names.data(), 1, names.size(), m_file) != names.size()) {
+      throw std::runtime_error("trajectory_writer: cannot write " + path);
+    }
+
+    for (std::vector<double> &block : m_blocks) {
+      block.resize(m_channel_count * m_block_rows);
+    }
+    m_thread = std::thread([this] { writer_loop(); });
+  }
+
+  // hand the front block to the background thread and swap buffers
+  void submit() {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    if (m_pending) {
+      ++m_stall_count;
+      m_done.wait(lock, [this] { return !m_pending; });
+    }
+    if (m_error) {
+      throw std::runtime_error("trajectory_writer: write failed");
+    }
+    m_pending = true;
+    m_pending_block = m_front;
+    m_pending_rows = m_fill;
+    lock.unlock();
+    m_wake.notify_one();
+    m_front ^= 1;
+    m_fill = 0;
+  }
+
+  void writer_loop() {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (true) {
+      m_wake.wait(lock, [this] { return m_pending || m_stop; });
+      if (!m_pending) {
+        return;
+      }
+      const double *block{m_blocks[m_pending_block].data()};
+      std::uint64_t rows{m_pending_rows};
+      lock.unlock();
+
+      bool written{std::fwrite(&rows, sizeof(rows), 1, m_file) == 1};
+      for (std::size_t c = 0; c < m_channel_count && written; ++c) {
+        written = std::fwrite(block + c * m_block_rows, sizeof(double), rows,
+                              m_file) == rows;
+      }
+
+      lock.lock();
+      m_error = m_error || !written;
+      m_pending = false;
+      m_done.notify_one();
+    }
+  }
+
+  std::size_t m_channel_count;
+  std::size_t m_block_rows;
+  std::FILE *m_file{nullptr};
+  std::array<std::vector<double>, 2> m_blocks;
+  std::size_t m_front{0};
+  std::size_t m_fill{0};
+  std::size_t m_row_count{0};
+  std::size_t m_stall_count{0};
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  bool m_pending{false};
+  std::size_t m_pending_block{0};
+  std::size_t m_pending_rows{0};
+  bool m_stop{false};
+  bool m_error{false};
+  std::thread m_thread;
+};
+
+// channels written by trajectory_recorder before the user channels; the
+// state channels follow aircraft_state_index
+enum trajectory_channel_index : std::size_t {
+  TRAJECTORY_TIME,
+  TRAJECTORY_STATE,
+  TRAJECTORY_HEIGHT = TRAJECTORY_STATE + AIRCRAFT_STATE_SIZE,
+  TRAJECTORY_TRUE_AIRSPEED,
+  TRAJECTORY_MACH,
+  TRAJECTORY_CALIBRATED_AIRSPEED,
+  TRAJECTORY_DYNAMIC_PRESSURE,
+  TRAJECTORY_DENSITY,
+  TRAJECTORY_USER
+};
+
+// names of the channels of trajectory_recorder
+inline std::vector<std::string>
+trajectory_channel_names(const std::vector<std::string> &user_channel_names) {
+  std::vector<std::string> names{"time_s",
+                                 "earth_pos_x_m",
+                                 "earth_pos_y_m",
+                                 "earth_pos_z_m",
+                                 "roll_rad",
+                                 "pitch_rad",
+                                 "yaw_rad",
+                                 "forward_vel_mps",
+                                 "lateral_vel_mps",
+                                 "downward_vel_mps",
+                                 "forward_ang_vel_radps",
+                                 "lateral_ang_vel_radps",
+                                 "downward_ang_vel_radps",
+                                 "height_m",
+                                 "true_airspeed_mps",
+                                 "Mach_number",
+                                 "calibrated_airspeed_mps",
+                                 "dynamic_pressure_Pa",
+                                 "density_kgpm3"};
+  names.insert(names.end(), user_channel_names.begin(),
+               user_channel_names.end());
+  return names;
+}
+
+// Records the trajectory of an aircraft: time, state, air data (still air,
+// height = -earth_pos_z) and user channels. A sample is written when
+//   - it is one of every decimation samples (counting from the first), or
+//   - the caller flags it as an event, or
+//   - a channel with a deadband moved more than the deadband since the
+//     last written row.
+class trajectory_recorder {
+public:
+  trajectory_recorder(const std::string &path,
+                      const std::vector<std::string> &user_channel_names = {},
+                      std::size_t decimation = 1,
+                      std::size_t block_rows = TRAJECTORY_BLOCK_ROWS)
+      : m_writer{path, trajectory_channel_names(user_channel_names),
+                 block_rows},
+        m_decimation{std::max<std::size_t>(decimation, 1)},
+        m_row(m_writer.channel_count()),
+        m_last_row(m_writer.channel_count()),
+        m_deadbands(m_writer.channel_count(), 0.0) {}
+
+  // write a sample whenever channel moves more than delta (0 disables)
+  void set_deadband(std::size_t channel, double delta) {
+    m_deadbands[channel] = delta;
+    m_has_deadbands = std::any_of(m_deadbands.begin(), m_deadbands.end(),
+                                  [](double d) { return d > 0.0; });
+  }
+
+  // offer a sample; user_values holds one value per user channel. Returns
+  // whether the sample was written.
+  bool sample(double time_s, const aircraft_state &state,
+              const double *user_values = nullptr, bool event = false) {
+    bool decimated{m_sample_count++ % m_decimation == 0};
+    if (!decimated && !event && !m_has_deadbands) {
+      return false;
+    }
+    fill_row(time_s, state, user_values);
+    bool write{decimated || event || !m_written_any};
+    for (std::size_t c = 0; c < m_row.size() && !write; ++c) {
+      write = m_deadbands[c] > 0.0 &&
+              std::fabs(m_row[c] - m_last_row[c]) > m_deadbands[c];
+    }
+    if (write) {
+      m_writer.record(m_row.data());
+      m_last_row = m_row;
+      m_written_any = true;
+    }
+    return write;
+  }
+
+  void close() { m_writer.close(); }
+  const trajectory_writer &writer() const { return m_writer; }
+
+private:
+  void fill_row(double time_s, const aircraft_state &state,
+                const double *user_values) {
+    double *row{m_row.data()};
+    row[TRAJECTORY_TIME] = time_s;
+    std::copy(state.begin(), state.end(), row + TRAJECTORY_STATE);
+    double true_airspeed_mps{
+        std::sqrt(state[STATE_FORWARD_VEL] * state[STATE_FORWARD_VEL] +
+                  state[STATE_LATERAL_VEL] * state[STATE_LATERAL_VEL] +
+                  state[STATE_DOWNWARD_VEL] * state[STATE_DOWNWARD_VEL])};
+    double height_m{-state[STATE_EARTH_POS_Z]};
+    air_data data{compute_air_data(height_m, true_airspeed_mps)};
+    row[TRAJECTORY_HEIGHT] = height_m;
+    row[TRAJECTORY_TRUE_AIRSPEED] = true_airspeed_mps;
+    row[TRAJECTORY_MACH] = data.Mach_number;
+    row[TRAJECTORY_CALIBRATED_AIRSPEED] = data.calibrated_airspeed_mps;
+    row[TRAJECTORY_DYNAMIC_PRESSURE] = data.dynamic_pressure_Pa;
+    row[TRAJECTORY_DENSITY] = data.density_kgpm3;
+    if (user_values != nullptr) {
+      std::copy(user_values, user_values + (m_row.size() - TRAJECTORY_USER),
+                row + TRAJECTORY_USER);
+    }
+  }
+
+  trajectory_writer m_writer;
+  std::size_t m_decimation;
+  std::size_t m_sample_count{0};
+  std::vector<double> m_row;
+  std::vector<double> m_last_row;
+  std::vector<double> m_deadbands;
+  bool m_has_deadbands{false};
+  bool m_written_any{false};
+};
+
+// Read-only view of a trajectory file mapped into memory. An incomplete
+// last block (a run that stopped while writing) is ignored.
+class trajectory_reader {
+public:
+  explicit trajectory_reader(const std::string &path) {
+    int file{::open(path.c_str(), O_RDONLY)};
+    if (file < 0) {
+      throw std::runtime_error("trajectory_reader: cannot open " + path);
+    }
+    struct stat status;
+    if (::fstat(file, &status) != 0 ||
+        static_cast<std::size_t>(status.st_size) <
+            sizeof(trajectory_file_header)) {
+      ::close(file);
+      throw std::runtime_error("trajectory_reader: " + path +
+                               " is not a trajectory");
+    }
+    std::size_t size_bytes{static_cast<std::size_t>(status.st_size)};
+    void *address{
+        ::mmap(nullptr, size_bytes, PROT_READ, MAP_PRIVATE, file, 0)};
+    ::close(file);
+    if (address == MAP_FAILED) {
+      throw std::runtime_error("trajectory_reader: cannot map " + path);
+    }
+    m_image = std::shared_ptr<const void>(
+        address, [size_bytes](const void *p) {
+          ::munmap(const_cast<void *>(p), size_bytes);
+        });
+    const unsigned char *bytes{static_cast<const unsigned char *>(address)};
+
+    trajectory_file_header header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic)) !=
+            0 ||
+        header.version != TRAJECTORY_VERSION ||
+        header.byte_order != TRAJECTORY_BYTE_ORDER_MARK ||
+        header.channel_count == 0) {
+      throw std::runtime_error("trajectory_reader: " + path +
+                               " is not a trajectory of this machine");
+    }
+    // the counts come from the file: they are checked against its size by
+    // divisions, so that a corrupt count cannot wrap the offsets
+    if (header.channel_count >
+            (size_bytes - sizeof(header)) / TRAJECTORY_NAME_SIZE ||
+        header.block_rows == 0) {
+      throw std::runtime_error("trajectory_reader: " + path +
+                               " has an inconsistent header");
+    }
+    m_channel_count = header.channel_count;
+    std::size_t offset{sizeof(header) +
+                       m_channel_count * TRAJECTORY_NAME_SIZE};
+    m_names = reinterpret_cast<const char *>(bytes + sizeof(header));
+
+    // index of the complete blocks; a block cut by the end of the file ends
+    // the index
+    std::size_t row_bytes{m_channel_count * sizeof(double)};
+    while (offset + sizeof(std::uint64_t) <= size_bytes) {
+      std::uint64_t rows;
+      std::memcpy(&rows, bytes + offset, sizeof(rows));
+      if (rows == 0 || rows > header.block_rows) {
+        throw std::runtime_error("trajectory_reader: " + path +
+                                 " has a corrupt block");
+      }
+      if (rows > (size_bytes - offset - sizeof(rows)) / row_bytes) {
+        break;
+      }
+      std::size_t block_bytes{sizeof(rows) + rows * row_bytes};
+      m_blocks.push_back(reinterpret_cast<const double *>(bytes + offset +
+                                                          sizeof(rows)));
+      m_block_rows.push_back(rows);
+      m_block_first_row.push_back(m_row_count);
+      m_row_count += rows;
+      offset += block_bytes;
+    }
+  }
+
+  std::size_t channel_count() const { return m_channel_count; }
+  std::size_t row_count() const { return m_row_count; }
+  std::size_t block_count() const { return m_blocks.size(); }
+  std::size_t block_row_count(std::size_t block) const {
+    return m_block_rows[block];
+  }
+
+  std::string channel_name(std::size_t channel) const {
+    const char *text{m_names + channel * TRAJECTORY_NAME_SIZE};
+    return std::string(text, strnlen(text, TRAJECTORY_NAME_SIZE));
+  }
+
+  // index of the named channel, -1 if the file has none
+  int channel_index(const std::string &name) const {
+    for (std::size_t c = 0; c < m_channel_count; ++c) {
+      if (channel_name(c) == name) {
+        return static_cast<int>(c);
+      }
+    }
+    return -1;
+  }
+
+  // block_row_count(block) values of channel, in place in the file
+  const double *block_column(std::size_t block, std::size_t channel) const {
+    return m_blocks[block] + channel * m_block_rows[block];
+  }
+
+  // the whole channel
+  std::vector<double> column(std::size_t channel) const {
+    std::vector<double> values(m_row_count);
+    for (std::size_t b = 0; b < m_blocks.size(); ++b) {
+      const double *source{block_column(b, channel)};
+      std::copy(source, source + m_block_rows[b],
+                values.begin() + m_block_first_row[b]);
+    }
+    return values;
+  }
+
+  double value(std::size_t row, std::size_t channel) const {
+    std::size_t block{static_cast<std::size_t>(
+        std::upper_bound(m_block_first_row.begin(), m_block_first_row.end(),
+                         row) -
+        m_block_first_row.begin() - 1)};
+    return block_column(block, channel)[row - m_block_first_row[block]];
+  }
+
+private:
+  std::shared_ptr<const void> m_image;
+  std::size_t m_channel_count{0};
+  std::size_t m_row_count{0};
+  const char *m_names{nullptr};
+  std::vector<const double *> m_blocks;
+  std::vector<std::size_t> m_block_rows;
+  std::vector<std::size_t> m_block_first_row;
+};
+
+#endif // !TRAJECTORYLOG_HPP
@@ -0,0 +1,366 @@
+/*
+GNU General Public License with Academic Attribution
+Copyright (C) 2024 Rodolfo Batista Negri
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+!!!!!!!!!!!!!!~~~ Additional Terms for Academic Use: ~~!!!!!!!!!!!!!!!!!!
+
+If this software is used in academic papers or publications, the authors
+are required to mention the original authorship in the text of the paper
+or publication, followed by the repository's URL.
+
+Example, suppose Software X was used for data analysis:
+"The data analysis was performed using Software X, developed by
+Dr. Rodolfo B. Negri~\footnote{[URL]}."
+*/
+
+#ifndef TRIM_HPP
+#define TRIM_HPP
+
+// Trim and linearization of an aircraft model with exact Jacobians from
+// dual numbers (autodiff.hpp).
+//
+// The aircraft model is a callable templated on the scalar type:
+//   model(state, controls, force_vector, moment_vector)
+// with state a std::array<Scalar, 12> (aircraft_state_index), controls a
+// std::array<Scalar, AIRCRAFT_CONTROL_SIZE> and the outputs
+// std::array<Scalar, 3>. It fills the total body-axes force (gravity
+// included) and moment, as the force models of aircraft_dynamics do. Built
+// from the generic atmosphere and rotation functions, one call with dual
+// numbers gives the forces and all their derivatives. The model must be
+// callable on a const object from several threads (trim_envelope).
+
+#include "aircraftmotion.hpp"
+#include "autodiff.hpp"
+#include "massproperties.hpp"
+#include "threadpool.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// positions of the controls in the control vector
+enum aircraft_control_index : std::size_t {
+  CONTROL_THROTTLE,
+  CONTROL_ELEVATOR,
+  CONTROL_AILERON,
+  CONTROL_RUDDER,
+  AIRCRAFT_CONTROL_SIZE
+};
+
+using aircraft_controls = std::array<double, AIRCRAFT_CONTROL_SIZE>;
+
+const int TRIM_MAX_ITERATIONS{50};
+// largest acceleration left at a trim point [m/s^2 and rad/s^2]
+const double TRIM_TOLERANCE{1e-10};
+// envelope points per thread pool chunk
+const std::size_t TRIM_ENVELOPE_CHUNK_SIZE{8};
+
+// steady, straight, wings-level flight to trim for
+struct trim_condition {
+  double height_m;
+  double airspeed_mps;
+  double flight_path_angle_rad{0.0};
+  double heading_rad{0.0};
+};
+
+// starting point of the trim iterations
+struct trim_guess {
+  double angle_of_attack_rad{0.05};
+  double sideslip_rad{0.0};
+  aircraft_controls controls{0.5, 0.0, 0.0, 0.0};
+};
+
+enum trim_status : unsigned char {
+  TRIM_CONVERGED = 0,
+  TRIM_NOT_CONVERGED = 1, // TRIM_MAX_ITERATIONS reached
+  TRIM_SINGULAR = 2,      // singular Jacobian
+  TRIM_NO_DESCENT = 3     // no step along the Newton direction reduces the
+                          // residual
+};
+
+struct trim_result {
+  aircraft_state state;
+  aircraft_controls controls;
+  double angle_of_attack_rad;
+  double sideslip_rad;
+  // largest body acceleration left
+  double residual;
+  int iterations;
+  trim_status status;
+};
+
+// state-space model dx/dt = f(x0, u0) + A (x - x0) + B (u - u0)
+struct linear_model {
+  std::array<std::array<double, AIRCRAFT_STATE_SIZE>, AIRCRAFT_STATE_SIZE> A;
+  std::array<std::array<double, AIRCRAFT_CONTROL_SIZE>, AIRCRAFT_STATE_SIZE>
+      B;
+  aircraft_state state_derivative;
+};
+
+// one point of trim_envelope
+struct trim_point {
+  trim_condition condition;
+  trim_result trim;
+  linear_model linear;
+};
+
+// Calculate the state derivative of the aircraft model with its controls
+template <typename Scalar, typename AircraftModel, inertia_symmetry SYMMETRY>
+inline std::array<Scalar, AIRCRAFT_STATE_SIZE> aircraft_model_derivative(
+    const AircraftModel &model,
+    const mass_properties<double, SYMMETRY> &mass_properties,
+    const std::array<Scalar, AIRCRAFT_STATE_SIZE> &state,
+    const std::array<Scalar, AIRCRAFT_CONTROL_SIZE> &controls) {
+  std::array<Scalar, 3> force_vector, moment_vector;
+  model(state, controls, force_vector, moment_vector);
+  return aircrafts_EOM(state, mass_properties, force_vector, moment_vector);
+}
+
+// Function to build the state of a trim condition from the aerodynamic
+// angles; the flight path angle is exact for zero sideslip, which is where
+// symmetric aircraft trim
+template <typename Scalar>
+inline std::array<Scalar, AIRCRAFT_STATE_SIZE>
+trim_state(const trim_condition &condition, const Scalar &angle_of_attack_rad,
+           const Scalar &sideslip_rad) {
+  using std::cos;
+  using std::sin;
+  Scalar c_beta{cos(sideslip_rad)};
+  std::array<Scalar, AIRCRAFT_STATE_SIZE> state;
+  state.fill(Scalar(0.0));
+  state[STATE_EARTH_POS_Z] = -condition.height_m;
+  state[STATE_PITCH] = angle_of_attack_rad + condition.flight_path_angle_rad;
+  state[STATE_YAW] = condition.heading_rad;
+  state[STATE_FORWARD_VEL] =
+      condition.airspeed_mps * cos(angle_of_attack_rad) * c_beta;
+  state[STATE_LATERAL_VEL] = condition.airspeed_mps * sin(sideslip_rad);
+  state[STATE_DOWNWARD_VEL] =
+      condition.airspeed_mps * sin(angle_of_attack_rad) * c_beta;
+  return state;
+}
+
+// Solve A x = b by Gaussian elimination with partial pivoting; false when A
+// is singular
+template <std::size_t N>
+inline bool solve_linear_system(std::array<std::array<double, N>, N> A,
+                                std::array<double, N> b,
+                                std::array<double, N> &x) {
+  for (std::size_t column = 0; column < N; ++column) {
+    std::size_t pivot{column};
+    for (std::size_t row = column + 1; row < N; ++row) {
+      if (std::fabs(A[row][column]) > std::fabs(A[pivot][column])) {
+        pivot = row;
+      }
+    }
+    if (!(std::fabs(A[pivot][column]) > 1e-300)) {
+      return false;
+    }
+    std::swap(A[pivot], A[column]);
+    std::swap(b[pivot], b[column]);
+    for (std::size_t row = column + 1; row < N; ++row) {
+      double factor{A[row][column] / A[column][column]};
+      for (std::size_t k = column; k < N; ++k) {
+        A[row][k] -= factor * A[column][k];
+      }
+      b[row] -= factor * b[column];
+    }
+  }
+  for (std::size_t row = N; row-- > 0;) {
+    double sum{b[row]};
+    for (std::size_t k = row + 1; k < N; ++k) {
+      sum -= A[row][k] * x[k];
+    }
+    x[row] = sum / A[row][row];
+  }
+  return true;
+}
+
+// Trim the aircraft model for a condition: Newton iterations on the angle
+// of attack, sideslip and the four controls until the six body
+// accelerations vanish. The Jacobian comes from one evaluation with dual
+// numbers; steps that do not reduce the residual are halved.
+template <typename AircraftModel, inertia_symmetry SYMMETRY>
+inline trim_result
+trim(const AircraftModel &model,
+     const mass_properties<double, SYMMETRY> &mass_properties,
+     const trim_condition &condition, const trim_guess &guess = trim_guess{}) {
+  constexpr std::size_t UNKNOWNS{2 + AIRCRAFT_CONTROL_SIZE};
+  using dual_type = dual<UNKNOWNS>;
+
+  // unknowns: angle of attack, sideslip, controls
+  std::array<double, UNKNOWNS> x{guess.angle_of_attack_rad,
+                                 guess.sideslip_rad};
+  for (std::size_t c = 0; c < AIRCRAFT_CONTROL_SIZE; ++c) {
+    x[2 + c] = guess.controls[c];
+  }
+  auto residual_norm = [&](const std::array<double, UNKNOWNS> &unknowns) {
+    aircraft_controls controls;
+    std::copy(unknowns.begin() + 2, unknowns.end(), controls.begin());
+    aircraft_state derivative{aircraft_model_derivative(
+        model, mass_properties,
+        trim_state(condition, unknowns[0], unknowns[1]), controls)};
+    // std::fmax drops NaN: a NaN acceleration makes the norm infinite
+    double norm{0.0};
+    for (std::size_t i = STATE_FORWARD_VEL; i < AIRCRAFT_STATE_SIZE; ++i) {
+      norm = std::isnan(derivative[i])
+                 ? std::numeric_limits<double>::infinity()
+                 : std::fmax(norm, std::fabs(derivative[i]));
+    }
+    return norm;
+  };
+
+  trim_result result{};
+  result.status = TRIM_NOT_CONVERGED;
+  double norm{residual_norm(x)};
+  for (int iteration = 0; iteration <= TRIM_MAX_ITERATIONS; ++iteration) {
+    result.iterations = iteration;
+    if (norm < TRIM_TOLERANCE) {
+      result.status = TRIM_CONVERGED;
+      break;
+    }
+    if (iteration == TRIM_MAX_ITERATIONS) {
+      break;
+    }
+
+    // residual and Jacobian in one pass
+    std::array<dual_type, UNKNOWNS> unknowns;
+    for (std::size_t i = 0; i < UNKNOWNS; ++i) {
+      unknowns[i] = dual_type::variable(x[i], i);
+    }
+    std::array<dual_type, AIRCRAFT_CONTROL_SIZE> controls;
+    std::copy(unknowns.begin() + 2, unknowns.end(), controls.begin());
+    std::array<dual_type, AIRCRAFT_STATE_SIZE> derivative{
+        aircraft_model_derivative(
+            model, mass_properties,
+            trim_state(condition, unknowns[0], unknowns[1]), controls)};
+    std::array<std::array<double, UNKNOWNS>, UNKNOWNS> jacobian;
+    std::array<double, UNKNOWNS> minus_residual, step;
+    for (std::size_t i = 0; i < UNKNOWNS; ++i) {
+      jacobian[i] = derivative[STATE_FORWARD_VEL + i].gradient;
+      minus_residual[i] = -derivative[STATE_FORWARD_VEL + i].value;
+    }
+    if (!solve_linear_system(jacobian, minus_residual, step)) {
+      result.status = TRIM_SINGULAR;
+      break;
+    }
+
+    // halve the step until the residual decreases; if it never does, the
+    // current point is kept
+    double scale{1.0};
+    std::array<double, UNKNOWNS> next;
+    double next_norm{norm};
+    bool reduced{false};
+    for (int halving = 0; halving < 20 && !reduced; ++halving, scale *= 0.5) {
+      for (std::size_t i = 0; i < UNKNOWNS; ++i) {
+        next[i] = x[i] + scale * step[i];
+      }
+      next_norm = residual_norm(next);
+      reduced = next_norm < norm;
+    }
+    if (!reduced) {
+      result.status = TRIM_NO_DESCENT;
+      break;
+    }
+    x = next;
+    norm = next_norm;
+  }
+
+  result.angle_of_attack_rad = x[0];
+  result.sideslip_rad = x[1];
+  std::copy(x.begin() + 2, x.end(), result.controls.begin());
+  result.state = trim_state(condition, x[0], x[1]);
+  result.residual = norm;
+  return result;
+}
+
+// Linearize the aircraft model about a state and controls: A = df/dx and
+// B = df/du from one evaluation with dual numbers
+template <typename AircraftModel, inertia_symmetry SYMMETRY>
+inline linear_model
+linearize(const AircraftModel &model,
+          const mass_properties<double, SYMMETRY> &mass_properties,
+          const aircraft_state &state, const aircraft_controls &controls) {
+  constexpr std::size_t VARIABLES{AIRCRAFT_STATE_SIZE + AIRCRAFT_CONTROL_SIZE};
+  using dual_type = dual<VARIABLES>;
+
+  std::array<dual_type, AIRCRAFT_STATE_SIZE> dual_state;
+  for (std::size_t i = 0; i < AIRCRAFT_STATE_SIZE; ++i) {
+    dual_state[i] = dual_type::variable(state[i], i);
+  }
+  std::array<dual_type, AIRCRAFT_CONTROL_SIZE> dual_controls;
+  for (std::size_t c = 0; c < AIRCRAFT_CONTROL_SIZE; ++c) {
+    dual_controls[c] =
+        dual_type::variable(controls[c], AIRCRAFT_STATE_SIZE + c);
+  }
+  std::array<dual_type, AIRCRAFT_STATE_SIZE> derivative{
+      aircraft_model_derivative(model, mass_properties, dual_state,
+                                dual_controls)};
+
+  linear_model linear;
+  for (std::size_t i = 0; i < AIRCRAFT_STATE_SIZE; ++i) {
+    linear.state_derivative[i] = derivative[i].value;
+    std::copy(derivative[i].gradient.begin(),
+              derivative[i].gradient.begin() + AIRCRAFT_STATE_SIZE,
+              linear.A[i].begin());
+    std::copy(derivative[i].gradient.begin() + AIRCRAFT_STATE_SIZE,
+              derivative[i].gradient.end(), linear.B[i].begin());
+  }
+  return linear;
+}
+
+// Trim and linearize over a grid of heights and airspeeds on a thread pool.
+// Points are ordered height-major (heights_m[i], airspeeds_mps[j]) at
+// i * airspeeds_mps.size() + j. Inside a chunk of TRIM_ENVELOPE_CHUNK_SIZE
+// points each trim starts from the previous converged point of the same
+// height, so the results do not depend on the number of threads.
+template <typename AircraftModel, inertia_symmetry SYMMETRY>
+inline std::vector<trim_point>
+trim_envelope(const AircraftModel &model,
+              const mass_properties<double, SYMMETRY> &mass_properties,
+              const std::vector<double> &heights_m,
+              const std::vector<double> &airspeeds_mps,
+              thread_pool &pool = default_thread_pool(),
+              const trim_guess &guess = trim_guess{}) {
+  std::size_t airspeed_count{airspeeds_mps.size()};
+  std::vector<trim_point> points(heights_m.size() * airspeed_count);
+  pool.parallel_for(
+      points.size(), TRIM_ENVELOPE_CHUNK_SIZE,
+      [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+          trim_point &point{points[i]};
+          point.condition = {heights_m[i / airspeed_count],
+                             airspeeds_mps[i % airspeed_count]};
+          trim_guess start{guess};
+          const trim_point *previous{i > begin ? &points[i - 1] : nullptr};
+          if (previous != nullptr &&
+              previous->condition.height_m == point.condition.height_m &&
+              previous->trim.status == TRIM_CONVERGED) {
+            start.angle_of_attack_rad = previous->trim.angle_of_attack_rad;
+            start.sideslip_rad = previous->trim.sideslip_rad;
+            start.controls = previous->trim.controls;
+          }
+          point.trim = trim(model, mass_properties, point.condition, start);
+          point.linear = linearize(model, mass_properties, point.trim.state,
+                                   point.trim.controls);
+        }
+      });
+  return points;
+}
+
+#endif // !TRIM_HPP
@@ -1 +1,92 @@
-int main(void) { return 0; }
+// Batch air data of flight-test logs:
+//   main [options] [input [output]]
+// reads rows of height [m] and true airspeed [m/s] from input (standard
+// input when missing or "-") and writes the air data of every row to output
+// (standard output when missing or "-"); see airdatabatch.hpp for the
+// formats. Options:
+//   --input-format csv|binary    default csv
+//   --output-format csv|binary   default csv
+//   --no-header                  no header line in CSV output
+//   --threads N                  threads of the computation (default: all)
+
+#include "../include/airdatabatch.hpp"
+#include "../include/threadpool.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+bool parse_format(const std::string &name, air_data_format &format) {
+  if (name == "csv") {
+    format = AIR_DATA_CSV;
+  } else if (name == "binary") {
+    format = AIR_DATA_BINARY;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int usage() {
+  std::cerr << "usage: main [--input-format csv|binary] [--output-format "
+               "csv|binary] [--no-header] [--threads N] [input [output]]\n";
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  air_data_batch_options options;
+  std::size_t thread_count{thread_pool::default_thread_count()};
+  std::string input_path{"-"}, output_path{"-"};
+  int paths{0};
+  for (int i = 1; i < argc; ++i) {
+    std::string argument{argv[i]};
+    bool has_value{i + 1 < argc};
+    if (argument == "--input-format" && has_value) {
+      if (!parse_format(argv[++i], options.input_format)) {
+        return usage();
+      }
+    } else if (argument == "--output-format" && has_value) {
+      if (!parse_format(argv[++i], options.output_format)) {
+        return usage();
+      }
+    } else if (argument == "--no-header") {
+      options.header = false;
+    } else if (argument == "--threads" && has_value) {
+      thread_count = std::strtoul(argv[++i], nullptr, 10);
+    } else if (argument.size() > 1 && argument[0] == '-' && argument != "-") {
+      return usage();
+    } else if (paths < 2) {
+      (paths++ == 0 ? input_path : output_path) = argument;
+    } else {
+      return usage();
+    }
+  }
+
+  std::FILE *input{input_path == "-" ? stdin
+                                     : std::fopen(input_path.c_str(), "rb")};
+  if (input == nullptr) {
+    std::cerr << "main: cannot open " << input_path << "\n";
+    return 1;
+  }
+  std::FILE *output{output_path == "-"
+                        ? stdout
+                        : std::fopen(output_path.c_str(), "wb")};
+  if (output == nullptr) {
+    std::cerr << "main: cannot create " << output_path << "\n";
+    return 1;
+  }
+
+  try {
+    thread_pool pool{thread_count};
+    convert_air_data(input, output, options, pool);
+  } catch (const std::exception &error) {
+    std::cerr << "main: " << error.what() << "\n";
+    return 1;
+  }
+  if (output != stdout && std::fclose(output) != 0) {
+    std::cerr << "main: cannot write " << output_path << "\n";
+    return 1;
+  }
+  return 0;
+}
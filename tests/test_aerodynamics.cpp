@@ -0,0 +1,168 @@
+#include "../include/aerodynamics.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// multilinear in every coordinate, so the interpolation reproduces it
+double lift(double alpha, double beta, double Mach, double elevator) {
+  return 0.1 + 5.0 * alpha * (1.0 + 0.2 * Mach) - 0.3 * beta * elevator +
+         0.4 * elevator;
+}
+
+double pitching(double alpha, double beta, double Mach, double elevator) {
+  return 0.05 - 0.8 * alpha - 1.2 * elevator * (1.0 - 0.1 * Mach) +
+         0.01 * alpha * beta * Mach * elevator;
+}
+
+int main(void) {
+  int failures{0};
+  std::vector<std::vector<double>> breakpoints{
+      {-0.2, -0.1, 0.0, 0.05, 0.1, 0.15, 0.2, 0.3},
+      {-0.1, 0.0, 0.1},
+      {0.1, 0.4, 0.6, 0.8, 0.9},
+      {-0.4, -0.2, 0.0, 0.2, 0.4}};
+  std::vector<double> values;
+  for (double alpha : breakpoints[0]) {
+    for (double beta : breakpoints[1]) {
+      for (double Mach : breakpoints[2]) {
+        for (double elevator : breakpoints[3]) {
+          values.push_back(lift(alpha, beta, Mach, elevator));
+          values.push_back(pitching(alpha, beta, Mach, elevator));
+        }
+      }
+    }
+  }
+  aero_table table{{"alpha", "beta", "Mach", "elevator"},
+                   breakpoints,
+                   {"CL", "Cm"},
+                   values};
+  int CL{table.coefficient_index("CL")}, Cm{table.coefficient_index("Cm")};
+  failures += CL != 0 || Cm != 1 || table.axis_index("Mach") != 2 ||
+              table.axis_index("flap") != -1;
+
+  // TEST: interpolation inside the table, one point at a time and in batch
+  std::mt19937_64 generator{2024};
+  std::uniform_real_distribution<double> unit{0.0, 1.0};
+  const std::size_t count{100000};
+  std::vector<std::vector<double>> inputs(4, std::vector<double>(count));
+  for (std::size_t i = 0; i < count; ++i) {
+    for (std::size_t d = 0; d < 4; ++d) {
+      double low{breakpoints[d].front()}, high{breakpoints[d].back()};
+      inputs[d][i] = low + (high - low) * unit(generator);
+    }
+  }
+  const double *input_arrays[4]{inputs[0].data(), inputs[1].data(),
+                                inputs[2].data(), inputs[3].data()};
+  std::vector<double> CL_values(count), Cm_values(count);
+  double *output_arrays[2]{CL_values.data(), Cm_values.data()};
+  table.evaluate(count, input_arrays, output_arrays);
+
+  double error{0.0}, batch_difference{0.0};
+  for (std::size_t i = 0; i < count; ++i) {
+    double point[4]{inputs[0][i], inputs[1][i], inputs[2][i], inputs[3][i]};
+    double coefficients[2];
+    table.evaluate(point, coefficients);
+    double CL_exact{lift(point[0], point[1], point[2], point[3])};
+    double Cm_exact{pitching(point[0], point[1], point[2], point[3])};
+    error = std::fmax(error, std::fabs(coefficients[CL] - CL_exact));
+    error = std::fmax(error, std::fabs(coefficients[Cm] - Cm_exact));
+    batch_difference = std::fmax(
+        batch_difference, std::fabs(coefficients[CL] - CL_values[i]) +
+                              std::fabs(coefficients[Cm] - Cm_values[i]));
+  }
+  std::cout << "Interpolation error: " << error
+            << ", batch vs single point: " << batch_difference << "\n";
+  failures += error > 1e-13;
+  failures += batch_difference != 0.0;
+
+  // TEST: values are held at the edges of the table
+  double outside[4]{0.5, -0.3, 0.0, 1.0};
+  double edge[4]{0.3, -0.1, 0.1, 0.4};
+  double outside_coefficients[2], edge_coefficients[2];
+  table.evaluate(outside, outside_coefficients);
+  table.evaluate(edge, edge_coefficients);
+  failures += outside_coefficients[0] != edge_coefficients[0] ||
+              outside_coefficients[1] != edge_coefficients[1];
+
+  // TEST: save and load give the same table
+  const std::string path{"test_aerodynamics.table"};
+  table.save(path);
+  aero_table loaded{aero_table::load(path)};
+  std::vector<double> CL_loaded(count), Cm_loaded(count);
+  double *loaded_arrays[2]{CL_loaded.data(), Cm_loaded.data()};
+  loaded.evaluate(count, input_arrays, loaded_arrays);
+  bool identical{
+      std::memcmp(CL_loaded.data(), CL_values.data(),
+                  count * sizeof(double)) == 0 &&
+      std::memcmp(Cm_loaded.data(), Cm_values.data(),
+                  count * sizeof(double)) == 0 &&
+      loaded.axis_name(3) == "elevator" && loaded.coefficient_name(1) == "Cm"};
+  std::cout << "Loaded table identical: " << identical << "\n";
+  failures += !identical;
+
+  // TEST: a truncated file is rejected
+  std::FILE *file{std::fopen(path.c_str(), "r+b")};
+  std::vector<char> head(200);
+  std::size_t read{std::fread(head.data(), 1, head.size(), file)};
+  std::fclose(file);
+  file = std::fopen(path.c_str(), "wb");
+  std::fwrite(head.data(), 1, read, file);
+  std::fclose(file);
+  bool rejected{false};
+  try {
+    aero_table::load(path);
+  } catch (const std::runtime_error &) {
+    rejected = true;
+  }
+  std::remove(path.c_str());
+  std::cout << "Truncated table rejected: " << rejected << "\n";
+  failures += !rejected;
+
+  // TEST: lift at zero angle of attack and sideslip points up (-z body)
+  std::array<double, 3> force, moment;
+  aerodynamic_loads({0.02, 0.0, 0.5, 0.0, -0.1, 0.0}, {16.0, 10.0, 1.6},
+                    1000.0, 0.0, 0.0, force, moment);
+  failures += std::fabs(force[0] + 320.0) > 1e-9 ||
+              std::fabs(force[2] + 8000.0) > 1e-9 ||
+              std::fabs(moment[1] + 2560.0) > 1e-9;
+  // and tilts forward with the angle of attack
+  aerodynamic_loads({0.0, 0.0, 0.5, 0.0, 0.0, 0.0}, {16.0, 10.0, 1.6}, 1000.0,
+                    0.1, 0.0, force, moment);
+  failures += std::fabs(force[0] - 8000.0 * std::sin(0.1)) > 1e-9;
+
+  // points per second, sweeping along a trajectory and at random
+  for (std::size_t i = 0; i < count; ++i) {
+    double s{static_cast<double>(i) / count};
+    inputs[0][i] = -0.2 + 0.5 * s;
+    inputs[1][i] = 0.05 * std::sin(20.0 * s);
+    inputs[2][i] = 0.2 + 0.6 * s;
+    inputs[3][i] = 0.3 * std::cos(10.0 * s);
+  }
+  auto start{std::chrono::steady_clock::now()};
+  table.evaluate(count, input_arrays, output_arrays);
+  std::chrono::duration<double> sweep{std::chrono::steady_clock::now() -
+                                      start};
+  double checksum{CL_values[count / 2]};
+  for (std::size_t d = 0; d < 4; ++d) {
+    std::shuffle(inputs[d].begin(), inputs[d].end(), generator);
+  }
+  start = std::chrono::steady_clock::now();
+  table.evaluate(count, input_arrays, output_arrays);
+  std::chrono::duration<double> random{std::chrono::steady_clock::now() -
+                                       start};
+  checksum += CL_values[count / 2];
+  std::cout << "Table points per second, trajectory: " << count / sweep.count()
+            << ", random: " << count / random.count() << " (" << checksum
+            << ")\n";
+
+  return failures == 0 ? 0 : 1;
+}
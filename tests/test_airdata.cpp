@@ -0,0 +1,158 @@
+#include "../include/airdata.hpp"
+#include "test_helpers.hpp"
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <vector>
+
+int main(void) {
+  const double tolerance{1e-12};
+  int failures{0};
+
+  std::mt19937_64 generator{2024};
+  std::uniform_real_distribution<double> height_distribution{0.0, 20000.0};
+  std::uniform_real_distribution<double> speed_distribution{10.0, 280.0};
+  std::size_t count{20000};
+  std::vector<double> height_m(count), TAS_mps(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    height_m[i] = height_distribution(generator);
+    TAS_mps[i] = speed_distribution(generator);
+  }
+
+  // TEST: fused air data against the separate functions
+  double max_error{0.0};
+  for (std::size_t i = 0; i < count; ++i) {
+    air_data data{compute_air_data(height_m[i], TAS_mps[i])};
+    double T{ISA_temperature(height_m[i])};
+    double p{ISA_airpressure(T, height_m[i])};
+    double rho{ISA_density(T, p)};
+    double a{ISA_soundspeed(T)};
+    double error{std::fmax(
+        std::fmax(relative_error(data.pressure_Pa, p),
+                  relative_error(data.density_kgpm3, rho)),
+        std::fmax(relative_error(data.Mach_number, TAS_mps[i] / a),
+                  relative_error(data.calibrated_airspeed_mps,
+                                 calibrated_airspeed(TAS_mps[i],
+                                                     height_m[i]))))};
+    error = std::fmax(
+        error, relative_error(data.dynamic_pressure_Pa,
+                              0.5 * rho * TAS_mps[i] * TAS_mps[i]));
+    max_error = std::fmax(max_error, error);
+  }
+  std::cout << "Fused air data, max relative error: " << max_error << "\n";
+  failures += max_error > tolerance;
+
+  // TEST: inverse conversions recover the inputs
+  max_error = 0.0;
+  for (std::size_t i = 0; i < count; ++i) {
+    air_data data{compute_air_data(height_m[i], TAS_mps[i])};
+    double TAS{true_airspeed_from_calibrated(data.calibrated_airspeed_mps,
+                                             height_m[i])};
+    double CAS{calibrated_airspeed_from_Mach(data.Mach_number, height_m[i])};
+    double height{pressure_altitude(data.pressure_Pa)};
+    max_error = std::fmax(max_error, relative_error(TAS, TAS_mps[i]));
+    max_error = std::fmax(max_error,
+                          relative_error(CAS, data.calibrated_airspeed_mps));
+    max_error = std::fmax(max_error,
+                          std::fabs(height - height_m[i]) / 1000.0);
+  }
+  std::cout << "Inverse conversions, max relative error: " << max_error
+            << "\n";
+  failures += max_error > 1e-10;
+
+  // TEST: pressure altitude over the whole model and its status
+  max_error = 0.0;
+  for (double h = 0.0; h <= ISA_MAX_HEIGHT_m; h += 37.0) {
+    double p{ISA_airpressure(ISA_temperature(h), h)};
+    ISA_status status{ISA_ABOVE_MODEL};
+    max_error = std::fmax(max_error,
+                          std::fabs(pressure_altitude(p, status) - h));
+    failures += status != ISA_VALID;
+  }
+  std::cout << "Pressure altitude, max error [m]: " << max_error << "\n";
+  failures += max_error > 1e-6;
+  ISA_status status{ISA_VALID};
+  failures += pressure_altitude(PRESSURE_SEALEVEL_Pa * 1.01, status) >= 0.0;
+  failures += status != ISA_BELOW_MODEL;
+
+  // TEST: EAS equals TAS at sea level, in the scalar and batch versions
+  const double sealevel_m[]{0.0};
+  const double sealevel_TAS_mps[]{100.0};
+  double sealevel_values[9];
+  ISA_status sealevel_status{ISA_ABOVE_MODEL};
+  double *sealevel_out{sealevel_values};
+  compute_air_data(sealevel_m, sealevel_TAS_mps, 1,
+                   {sealevel_out, sealevel_out + 1, sealevel_out + 2,
+                    sealevel_out + 3, sealevel_out + 4, sealevel_out + 5,
+                    sealevel_out + 6, sealevel_out + 7, sealevel_out + 8,
+                    &sealevel_status});
+  double EAS_error{
+      std::fmax(relative_error(compute_air_data(0.0, 100.0)
+                                   .equivalent_airspeed_mps,
+                               100.0),
+                relative_error(sealevel_values[8], 100.0))};
+  std::cout << "EAS at sea level, relative error: " << EAS_error << "\n";
+  failures += EAS_error > 1e-12 || sealevel_status != ISA_VALID;
+
+  // TEST: pressures that are not positive or NaN are rejected
+  const double invalid_pressures_Pa[]{0.0, -1.0, std::nan("")};
+  std::vector<double> invalid_heights_m(3);
+  std::vector<ISA_status> invalid_status(3, ISA_VALID);
+  pressure_altitude(invalid_pressures_Pa, 3, invalid_heights_m.data(),
+                    invalid_status.data());
+  int rejected{0};
+  for (std::size_t i = 0; i < 3; ++i) {
+    status = ISA_VALID;
+    double scalar_height_m{pressure_altitude(invalid_pressures_Pa[i], status)};
+    rejected += std::isnan(scalar_height_m) && status == ISA_INVALID_INPUT;
+    rejected += std::isnan(invalid_heights_m[i]) &&
+                invalid_status[i] == ISA_INVALID_INPUT;
+  }
+  std::cout << "Invalid pressures rejected: " << rejected << "\n";
+  failures += rejected != 6;
+
+  // TEST: batch versions against the scalar ones
+  std::vector<double> T(count), p(count), rho(count), a(count), Mach(count),
+      q(count), qc(count), CAS(count), EAS(count), TAS(count), CAS_Mach(count),
+      height(count);
+  std::vector<ISA_status> batch_status(count);
+  compute_air_data(height_m.data(), TAS_mps.data(), count,
+                   {T.data(), p.data(), rho.data(), a.data(), Mach.data(),
+                    q.data(), qc.data(), CAS.data(), EAS.data(),
+                    batch_status.data()});
+  true_airspeed_from_calibrated(CAS.data(), height_m.data(), count,
+                                TAS.data());
+  calibrated_airspeed_from_Mach(Mach.data(), height_m.data(), count,
+                                CAS_Mach.data());
+  pressure_altitude(p.data(), count, height.data());
+
+  max_error = 0.0;
+  for (std::size_t i = 0; i < count; ++i) {
+    air_data data{compute_air_data(height_m[i], TAS_mps[i])};
+    const double batch[]{T[i], p[i],  rho[i], a[i],  Mach[i],
+                         q[i], qc[i], CAS[i], EAS[i]};
+    const double scalar[]{data.temperature_K,
+                          data.pressure_Pa,
+                          data.density_kgpm3,
+                          data.sound_speed_mps,
+                          data.Mach_number,
+                          data.dynamic_pressure_Pa,
+                          data.impact_pressure_Pa,
+                          data.calibrated_airspeed_mps,
+                          data.equivalent_airspeed_mps};
+    for (std::size_t j = 0; j < 9; ++j) {
+      max_error = std::fmax(max_error, relative_error(batch[j], scalar[j]));
+    }
+    max_error = std::fmax(max_error, relative_error(TAS[i], TAS_mps[i]));
+    max_error = std::fmax(
+        max_error, relative_error(CAS_Mach[i], data.calibrated_airspeed_mps));
+    max_error =
+        std::fmax(max_error, std::fabs(height[i] - height_m[i]) / 1000.0);
+    failures += batch_status[i] != data.status;
+  }
+  std::cout << "Batch air data, max relative error: " << max_error << "\n";
+  failures += max_error > 1e-10;
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+#include "../include/airdatabatch.hpp"
+#include "../include/threadpool.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// temporary file holding text
+std::FILE *temporary_file(const std::string &text) {
+  std::FILE *file{std::tmpfile()};
+  std::fwrite(text.data(), 1, text.size(), file);
+  std::rewind(file);
+  return file;
+}
+
+std::string file_contents(std::FILE *file) {
+  std::rewind(file);
+  std::string text;
+  char buffer[65536];
+  std::size_t got;
+  while ((got = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    text.append(buffer, got);
+  }
+  return text;
+}
+
+// convert text and return the output
+std::string convert(const std::string &input,
+                    const air_data_batch_options &options, thread_pool &pool,
+                    std::uint64_t &rows) {
+  std::FILE *in{temporary_file(input)};
+  std::FILE *out{std::tmpfile()};
+  rows = convert_air_data(in, out, options, pool);
+  std::string output{file_contents(out)};
+  std::fclose(in);
+  std::fclose(out);
+  return output;
+}
+
+int main(void) {
+  int failures{0};
+
+  // TEST: header, CRLF, blank lines, separators and a missing last newline
+  std::vector<double> height, airspeed;
+  std::string text{"height,tas\r\n0,100\r\n\n  1000 ; 150\n"
+                   "11000\t+250\n-50,60"};
+  const char *first_row{text.c_str() + text.find('\n') + 1};
+  parse_air_data_csv(first_row, text.c_str() + text.size(), height, airspeed);
+  bool parsed{height == std::vector<double>{0, 1000, 11000, -50} &&
+              airspeed == std::vector<double>{100, 150, 250, 60}};
+  std::cout << "CSV rows parsed: " << parsed << "\n";
+  failures += !parsed;
+
+  // TEST: rows that are not two numbers are rejected
+  int rejected{0};
+  for (const char *row : {"1,x\n", "1\n", "1,2,3\n", "1,,2\n"}) {
+    try {
+      parse_air_data_csv(row, row + std::strlen(row), height, airspeed);
+    } catch (const std::invalid_argument &) {
+      ++rejected;
+    }
+  }
+  std::cout << "Invalid rows rejected: " << rejected << " of 4\n";
+  failures += rejected != 4;
+
+  // random log, as CSV and binary input
+  const std::size_t count{200000};
+  std::mt19937_64 generator{2024};
+  std::uniform_real_distribution<double> height_m{-100.0, 21000.0};
+  std::uniform_real_distribution<double> tas_mps{20.0, 300.0};
+  std::vector<double> h(count), tas(count);
+  std::string csv{"height_m,true_airspeed_mps\n"};
+  std::string binary(count * AIR_DATA_BINARY_ROW_SIZE, '\0');
+  char number[32];
+  for (std::size_t i = 0; i < count; ++i) {
+    h[i] = height_m(generator);
+    tas[i] = tas_mps(generator);
+    csv.append(number, std::to_chars(number, number + 32, h[i]).ptr);
+    csv += ',';
+    csv.append(number, std::to_chars(number, number + 32, tas[i]).ptr);
+    csv += '\n';
+    std::memcpy(&binary[i * AIR_DATA_BINARY_ROW_SIZE], &h[i], sizeof(double));
+    std::memcpy(&binary[i * AIR_DATA_BINARY_ROW_SIZE + sizeof(double)],
+                &tas[i], sizeof(double));
+  }
+
+  // reference: the batch air data of the whole log
+  air_data_piece reference;
+  reference.height_m = h;
+  reference.true_airspeed_mps = tas;
+  compute_air_data(reference);
+
+  // TEST: rows outside the model keep only the temperature, sound speed and
+  // Mach number
+  std::size_t outside_rows{0}, outside_errors{0};
+  for (std::size_t i = 0; i < count; ++i) {
+    if (reference.status[i] == ISA_VALID) {
+      continue;
+    }
+    ++outside_rows;
+    for (std::size_t c = AIR_DATA_CALIBRATED_AIRSPEED; c < AIR_DATA_STATUS;
+         ++c) {
+      bool meaningful{c == AIR_DATA_TEMPERATURE || c == AIR_DATA_SOUND_SPEED ||
+                      c == AIR_DATA_MACH};
+      outside_errors +=
+          std::isnan(air_data_value(reference, c, i)) == meaningful;
+    }
+  }
+  std::cout << "Rows outside the model " << outside_rows
+            << ", columns not as expected " << outside_errors << "\n";
+  failures += outside_rows == 0 || outside_errors != 0;
+
+  // TEST: binary output of the CSV log with small blocks and pieces (rows
+  // cut across blocks) equals the reference
+  thread_pool pool{4};
+  air_data_batch_options options;
+  options.output_format = AIR_DATA_BINARY;
+  options.read_size = 100000;
+  options.piece_size = 4099;
+  std::uint64_t rows{0};
+  auto start{std::chrono::steady_clock::now()};
+  std::string from_csv{convert(csv, options, pool, rows)};
+  std::chrono::duration<double> csv_time{std::chrono::steady_clock::now() -
+                                         start};
+  std::size_t mismatches{0};
+  for (std::size_t i = 0; i < count; ++i) {
+    for (std::size_t c = 0; c < AIR_DATA_OUTPUT_COLUMNS; ++c) {
+      double expected{air_data_value(reference, c, i)};
+      double value;
+      std::memcpy(&value,
+                  &from_csv[(i * AIR_DATA_OUTPUT_COLUMNS + c) * sizeof(double)],
+                  sizeof(double));
+      mismatches += std::memcmp(&value, &expected, sizeof(double)) != 0;
+    }
+  }
+  std::cout << "CSV to binary, rows " << rows << ", size "
+            << from_csv.size() << ", mismatches " << mismatches << "\n";
+  failures += rows != count || mismatches != 0 ||
+              from_csv.size() != count * AIR_DATA_OUTPUT_COLUMNS * 8;
+
+  // TEST: binary input gives the same output, with any thread count
+  options.input_format = AIR_DATA_BINARY;
+  thread_pool serial_pool{1};
+  std::string from_binary{convert(binary, options, serial_pool, rows)};
+  std::cout << "Binary input on 1 thread equals CSV input on 4: "
+            << (from_binary == from_csv) << "\n";
+  failures += from_binary != from_csv || rows != count;
+
+  // TEST: CSV output reads back to the same values
+  options.output_format = AIR_DATA_CSV;
+  std::string csv_output{convert(binary, options, pool, rows)};
+  std::size_t header_end{csv_output.find('\n')};
+  bool header_ok{csv_output.substr(0, header_end + 1) ==
+                 air_data_csv_header()};
+  std::size_t read_back_errors{0}, line{0};
+  const char *p{csv_output.c_str() + header_end + 1};
+  const char *end{csv_output.c_str() + csv_output.size()};
+  while (p < end && line < count) {
+    for (std::size_t c = 0; c < AIR_DATA_OUTPUT_COLUMNS; ++c) {
+      double value{0.0};
+      p = std::from_chars(p, end, value).ptr + 1;
+      double expected{air_data_value(reference, c, line)};
+      read_back_errors +=
+          !(value == expected || (std::isnan(value) && std::isnan(expected)));
+    }
+    ++line;
+  }
+  std::cout << "CSV output header " << header_ok << ", rows " << line
+            << ", values not read back " << read_back_errors << "\n";
+  failures += !header_ok || line != count || read_back_errors != 0;
+
+  // TEST: NaN and infinite heights give the invalid input status and NaN in
+  // every computed column
+  air_data_batch_options csv_options;
+  std::string invalid_output{
+      convert("height_m,tas\nnan,100\ninf,100\n", csv_options, pool, rows)};
+  std::string invalid_row{"nan,100"};
+  for (std::size_t c = AIR_DATA_CALIBRATED_AIRSPEED; c < AIR_DATA_STATUS;
+       ++c) {
+    invalid_row += ",nan";
+  }
+  invalid_row += ",3\n";
+  std::string expected_invalid{air_data_csv_header() + invalid_row +
+                               "inf" + invalid_row.substr(3)};
+  std::cout << "Rows with invalid heights flagged: "
+            << (invalid_output == expected_invalid) << "\n";
+  failures += invalid_output != expected_invalid || rows != 2;
+
+  // TEST: a binary input ending inside a row and an invalid CSV row throw
+  int errors{0};
+  try {
+    convert(binary.substr(0, binary.size() - 3), options, pool, rows);
+  } catch (const std::runtime_error &) {
+    ++errors;
+  }
+  options.input_format = AIR_DATA_CSV;
+  try {
+    convert(csv + "12,abc\n", options, pool, rows);
+  } catch (const std::invalid_argument &) {
+    ++errors;
+  }
+  std::cout << "Truncated and invalid input rejected: " << errors
+            << " of 2\n";
+  failures += errors != 2;
+
+  std::cout << "CSV to binary rows per second: " << count / csv_time.count()
+            << "\n";
+
+  return failures == 0 ? 0 : 1;
+}
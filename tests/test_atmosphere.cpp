@@ -1,6 +1,5 @@
-#include "../include/atmosphere.hpp"
+#include "../include/airdata.hpp"
 // #include "src/framesnrotations.hpp"
-// #include <gsl/gslodeiv2.h>
 #include <iostream>
 
 int main(void) {
@@ -14,19 +13,23 @@ int main(void) {
   std::cout << "Enter TAS (True Airspeed) in meters per second: ";
   std::cin >> TAS_mps;
 
-  double calibrated_airspeed_mps = calibrated_airspeed(TAS_mps, height_m);
-  double temperature = ISA_temperature(height_m);
-  double sound_speed = ISA_soundspeed(temperature);
-  double pressure = ISA_airpressure(temperature, height_m);
-  double density = ISA_density(temperature, pressure);
+  // one evaluation of the atmosphere for all the derived quantities
+  air_data data{compute_air_data(height_m, TAS_mps)};
 
-  std::cout << "Speed of sound [m/s]: " << sound_speed << "\n";
-  std::cout << "Temperature [K]: " << temperature << "\n";
-  std::cout << "Pressure [Pa]: " << pressure << "\n";
-  std::cout << "Density [kg/m³]: " << density << "\n";
-  std::cout << "Mach number : " << TAS_mps / sound_speed << "\n";
-  std::cout << "Calibrated air speed [m/s]: " << calibrated_airspeed_mps
+  if (data.status != ISA_VALID) {
+    std::cerr << "Error: Invalid height (not implemented).\n";
+  }
+
+  std::cout << "Speed of sound [m/s]: " << data.sound_speed_mps << "\n";
+  std::cout << "Temperature [K]: " << data.temperature_K << "\n";
+  std::cout << "Pressure [Pa]: " << data.pressure_Pa << "\n";
+  std::cout << "Density [kg/m³]: " << data.density_kgpm3 << "\n";
+  std::cout << "Mach number : " << data.Mach_number << "\n";
+  std::cout << "Calibrated air speed [m/s]: " << data.calibrated_airspeed_mps
+            << "\n";
+  std::cout << "Equivalent air speed [m/s]: " << data.equivalent_airspeed_mps
             << "\n";
+  std::cout << "Dynamic pressure [Pa]: " << data.dynamic_pressure_Pa << "\n";
 
   return 0;
 }
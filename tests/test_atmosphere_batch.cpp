@@ -0,0 +1,75 @@
+#include "../include/atmosphere.hpp"
+#include "test_helpers.hpp"
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <vector>
+
+int main(void) {
+  // TEST: ISA_batch against the scalar ISA functions
+  std::vector<double> height_m{0.0,     1.0,     10999.999, 11000.0,
+                               11000.001, 20000.0, 32000.0,   47000.0,
+                               51000.0, 71000.0, 84852.0};
+  std::mt19937_64 generator{2024};
+  std::uniform_real_distribution<double> distribution{0.0, ISA_MAX_HEIGHT_m};
+  for (int i = 0; i < 100000; ++i) {
+    height_m.push_back(distribution(generator));
+  }
+  // outside the implemented range
+  height_m.push_back(-10.0);
+  height_m.push_back(90000.0);
+
+  std::size_t count{height_m.size()};
+  std::vector<double> temperature(count), pressure(count), density(count),
+      sound_speed(count);
+  std::vector<ISA_status> status(count);
+  ISA_batch(height_m.data(), count, temperature.data(), pressure.data(),
+            density.data(), sound_speed.data(), status.data());
+
+  const double tolerance{1e-13};
+  double max_error{0.0};
+  int failures{0};
+  for (std::size_t i = 0; i < count; ++i) {
+    double T{ISA_temperature(height_m[i])};
+    ISA_status scalar_status{ISA_VALID};
+    double p{ISA_airpressure(T, height_m[i], scalar_status)};
+    double rho{ISA_density(T, p)};
+    double a{ISA_soundspeed(T)};
+
+    double error{std::fmax(
+        std::fmax(relative_error(temperature[i], T),
+                  relative_error(pressure[i], p)),
+        std::fmax(relative_error(density[i], rho),
+                  relative_error(sound_speed[i], a)))};
+    max_error = std::fmax(max_error, error);
+    if (error > tolerance || status[i] != scalar_status) {
+      std::cout << "Mismatch at height " << height_m[i] << " m\n";
+      ++failures;
+    }
+  }
+
+  // TEST: vectorizable exp/log kernels against libm (used by ISA_batch on
+  // AVX2/AVX-512 targets)
+  double max_kernel_error{0.0};
+  std::uniform_real_distribution<double> exponent_distribution{-700.0, 700.0};
+  for (int i = 0; i < 100000; ++i) {
+    double x{exponent_distribution(generator)};
+    double y{std::exp(exponent_distribution(generator))};
+    max_kernel_error =
+        std::fmax(max_kernel_error, relative_error(fast_exp(x), std::exp(x)));
+    max_kernel_error =
+        std::fmax(max_kernel_error, relative_error(fast_log(y), std::log(y)));
+  }
+  if (max_kernel_error > 1e-15) {
+    std::cout << "fast_exp/fast_log above tolerance\n";
+    ++failures;
+  }
+
+  std::cout << "Samples: " << count << "\n";
+  std::cout << "Max relative error: " << max_error << "\n";
+  std::cout << "Max relative error of exp/log kernels: " << max_kernel_error
+            << "\n";
+
+  return failures == 0 ? 0 : 1;
+}
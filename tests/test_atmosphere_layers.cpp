@@ -0,0 +1,84 @@
+#include "../include/atmosphere.hpp"
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+
+int main(void) {
+  // TEST: layer model against the 1976 U.S. Standard Atmosphere tables
+  // (geopotential height [m], temperature [K], pressure [Pa])
+  const double reference[][3]{{0.0, 288.15, 101325.0},
+                              {11000.0, 216.65, 22632.06},
+                              {20000.0, 216.65, 5474.889},
+                              {32000.0, 228.65, 868.0187},
+                              {47000.0, 270.65, 110.9063},
+                              {51000.0, 270.65, 66.93887},
+                              {71000.0, 214.65, 3.956420},
+                              {84852.0, 186.946, 0.3733836}};
+
+  int failures{0};
+  for (const auto &row : reference) {
+    double temperature{ISA_temperature(row[0])};
+    double pressure{ISA_airpressure(temperature, row[0])};
+    std::cout << "Height [m]: " << row[0] << "  T [K]: " << temperature
+              << "  p [Pa]: " << pressure << "\n";
+    // R = 287 instead of 287.053 shifts the pressures by up to ~0.3%
+    if (std::fabs(temperature - row[1]) > 1e-3 ||
+        std::fabs(pressure / row[2] - 1.0) > 5e-3) {
+      std::cout << "Mismatch with the reference at " << row[0] << " m\n";
+      ++failures;
+    }
+  }
+
+  // TEST: continuity of the pressure at the layer bases
+  for (std::size_t i = 1; i < ISA_LAYER_BASE_HEIGHTS_m.size(); ++i) {
+    double base{ISA_LAYER_BASE_HEIGHTS_m[i]};
+    double below{ISA_airpressure(ISA_temperature(base - 1e-6), base - 1e-6)};
+    double above{ISA_airpressure(ISA_temperature(base + 1e-6), base + 1e-6)};
+    if (std::fabs(above / below - 1.0) > 1e-9) {
+      std::cout << "Pressure discontinuity at " << base << " m\n";
+      ++failures;
+    }
+  }
+
+  // TEST: out-of-range heights are reported through the status
+  ISA_status status{ISA_VALID};
+  double pressure{ISA_airpressure(ISA_temperature(-1.0), -1.0, status)};
+  if (pressure != -1 || status != ISA_BELOW_MODEL) {
+    ++failures;
+  }
+  pressure = ISA_airpressure(ISA_temperature(90000.0), 90000.0, status);
+  if (pressure != -1 || status != ISA_ABOVE_MODEL) {
+    ++failures;
+  }
+  pressure = ISA_airpressure(ISA_temperature(30000.0), 30000.0, status);
+  if (pressure <= 0 || status != ISA_VALID) {
+    ++failures;
+  }
+
+  // TEST: NaN and infinite heights are invalid input, in the scalar and
+  // batch functions
+  const double invalid_heights_m[]{std::nan(""),
+                                   std::numeric_limits<double>::infinity(),
+                                   -std::numeric_limits<double>::infinity()};
+  double temperature[3], batch_pressure[3], density[3], sound_speed[3];
+  ISA_status batch_status[3];
+  ISA_batch(invalid_heights_m, 3, temperature, batch_pressure, density,
+            sound_speed, batch_status);
+  for (std::size_t i = 0; i < 3; ++i) {
+    double h{invalid_heights_m[i]};
+    pressure = ISA_airpressure(ISA_temperature(h), h, status);
+    if (pressure != -1 || status != ISA_INVALID_INPUT ||
+        batch_pressure[i] != -1 || batch_status[i] != ISA_INVALID_INPUT) {
+      std::cout << "Height " << h << " m not reported as invalid\n";
+      ++failures;
+    }
+  }
+
+  // TEST: 86 km geometric is the top of the model
+  if (std::fabs(geopotential_height(86000.0) - ISA_MAX_HEIGHT_m) > 1.0) {
+    ++failures;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
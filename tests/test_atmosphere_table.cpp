@@ -0,0 +1,87 @@
+#include "../include/atmospheretable.hpp"
+#include "test_helpers.hpp"
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+int main(void) {
+  // TEST: ISA_table against the closed-form ISA functions
+  const ISA_table &table{ISA_default_table()};
+
+  std::vector<double> height_m{0.0,       25.0,    10999.999, 11000.0,
+                               11000.001, 11025.0, 20000.0,   47010.0,
+                               71000.0,   84851.9, 84852.0};
+  std::mt19937_64 generator{2024};
+  std::uniform_real_distribution<double> distribution{0.0, ISA_MAX_HEIGHT_m};
+  for (int i = 0; i < 200000; ++i) {
+    height_m.push_back(distribution(generator));
+  }
+
+  std::size_t count{height_m.size()};
+  std::vector<double> temperature(count), pressure(count), density(count),
+      sound_speed(count);
+  table.evaluate(height_m.data(), count, temperature.data(), pressure.data(),
+                 density.data(), sound_speed.data());
+
+  double max_error{0.0};
+  int failures{0};
+  for (std::size_t i = 0; i < count; ++i) {
+    double T{ISA_temperature(height_m[i])};
+    double p{ISA_airpressure(T, height_m[i])};
+    double rho{ISA_density(T, p)};
+    double a{ISA_soundspeed(T)};
+
+    double error{std::fmax(
+        std::fmax(relative_error(temperature[i], T),
+                  relative_error(pressure[i], p)),
+        std::fmax(relative_error(density[i], rho),
+                  relative_error(sound_speed[i], a)))};
+    max_error = std::fmax(max_error, error);
+    if (error > ISA_TABLE_MAX_RELATIVE_ERROR) {
+      std::cout << "Error above the documented bound at height "
+                << height_m[i] << " m\n";
+      ++failures;
+    }
+  }
+
+  // outside the model the table flags the samples as the closed-form model
+  // does
+  if (table.evaluate(-10.0).pressure_Pa != -1.0 ||
+      table.evaluate(-10.0).status != ISA_BELOW_MODEL ||
+      table.evaluate(84853.0).pressure_Pa != -1.0 ||
+      table.evaluate(84853.0).status != ISA_ABOVE_MODEL) {
+    std::cout << "Out-of-range heights not flagged\n";
+    ++failures;
+  }
+
+  // NaN and infinite heights give NaN properties and ISA_INVALID_INPUT, in
+  // the scalar and batch evaluations
+  const double invalid_heights_m[]{std::nan(""),
+                                   std::numeric_limits<double>::infinity(),
+                                   -std::numeric_limits<double>::infinity()};
+  double T[3], p[3], rho[3], a[3];
+  ISA_status status[3];
+  table.evaluate(invalid_heights_m, 3, T, p, rho, a, status);
+  for (std::size_t i = 0; i < 3; ++i) {
+    ISA_properties properties{table.evaluate(invalid_heights_m[i])};
+    if (!std::isnan(properties.temperature_K) ||
+        !std::isnan(properties.pressure_Pa) ||
+        !std::isnan(properties.density_kgpm3) ||
+        !std::isnan(properties.sound_speed_mps) ||
+        properties.status != ISA_INVALID_INPUT || !std::isnan(T[i]) ||
+        !std::isnan(p[i]) || !std::isnan(rho[i]) || !std::isnan(a[i]) ||
+        status[i] != ISA_INVALID_INPUT) {
+      std::cout << "Height " << invalid_heights_m[i]
+                << " m not flagged as invalid\n";
+      ++failures;
+    }
+  }
+
+  std::cout << "Samples: " << count << "\n";
+  std::cout << "Max relative error: " << max_error << "\n";
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+#include "../include/ensemble.hpp"
+#include "../include/integrators.hpp"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// gravity plus a member-dependent thrust and a damping moment
+struct ensemble_test_model {
+  void operator()(double time_s, const ensemble_chunk &chunk) const {
+    for (std::size_t i = 0; i < chunk.count; ++i) {
+      double mass{chunk.mass_properties.mass[i]};
+      double roll{chunk.state[STATE_ROLL][i]};
+      double pitch{chunk.state[STATE_PITCH][i]};
+      double thrust{2.0 * mass + 0.001 * static_cast<double>(chunk.begin + i)};
+      chunk.force[0][i] = thrust - mass * 9.80665 * std::sin(pitch);
+      chunk.force[1][i] = mass * 9.80665 * std::cos(pitch) * std::sin(roll);
+      chunk.force[2][i] = mass * 9.80665 * std::cos(pitch) * std::cos(roll) -
+                          0.5 * mass * std::cos(0.3 * time_s);
+      for (std::size_t c = 0; c < 3; ++c) {
+        chunk.moment[c][i] =
+            -500.0 * chunk.state[STATE_FORWARD_ANG_VEL + c][i];
+      }
+    }
+  }
+};
+
+// same model for one aircraft, for the scalar integrator
+struct single_test_model {
+  std::size_t member;
+  double mass;
+  void operator()(double time_s, const aircraft_state &state,
+                  std::array<double, 3> &force, std::array<double, 3> &moment) {
+    double thrust{2.0 * mass + 0.001 * static_cast<double>(member)};
+    force[0] = thrust - mass * 9.80665 * std::sin(state[STATE_PITCH]);
+    force[1] = mass * 9.80665 * std::cos(state[STATE_PITCH]) *
+               std::sin(state[STATE_ROLL]);
+    force[2] = mass * 9.80665 * std::cos(state[STATE_PITCH]) *
+                   std::cos(state[STATE_ROLL]) -
+               0.5 * mass * std::cos(0.3 * time_s);
+    for (std::size_t c = 0; c < 3; ++c) {
+      moment[c] = -500.0 * state[STATE_FORWARD_ANG_VEL + c];
+    }
+  }
+};
+
+ensemble_dispersion test_dispersion() {
+  ensemble_dispersion dispersion;
+  dispersion.nominal_state[STATE_EARTH_POS_Z] = -1000.0;
+  dispersion.nominal_state[STATE_FORWARD_VEL] = 60.0;
+  dispersion.nominal_state[STATE_PITCH] = 0.05;
+  dispersion.state_sigma = {10.0, 10.0, 10.0, 0.05, 0.05, 0.1,
+                            2.0,  1.0,  1.0,  0.02, 0.02, 0.02};
+  dispersion.nominal_mass = 1200.0;
+  dispersion.mass_sigma = 50.0;
+  dispersion.nominal_inertia_tensor = {
+      {{1300.0, 0.0, -60.0}, {0.0, 1800.0, 0.0}, {-60.0, 0.0, 2600.0}}};
+  dispersion.inertia_relative_sigma = 0.05;
+  return dispersion;
+}
+
+// final states of a dispersed ensemble after 2 s, using a given pool
+std::vector<double> run_ensemble(std::size_t size, thread_pool &pool) {
+  aircraft_ensemble ensemble{size};
+  ensemble.disperse(test_dispersion(), 7, pool);
+  ensemble_integrator<ensemble_test_model> integrator{
+      ensemble, ensemble_test_model{}, pool};
+  double time_s{0.0};
+  integrator.integrate(time_s, 2.0, 0.01);
+  std::vector<double> states;
+  for (std::size_t i = 0; i < size; ++i) {
+    aircraft_state state{ensemble.member_state(i)};
+    states.insert(states.end(), state.begin(), state.end());
+  }
+  return states;
+}
+
+int main(void) {
+  int failures{0};
+
+  // TEST: vectorizable sine and cosine against libm
+  double max_error{0.0};
+  for (double x = -100.0; x < 100.0; x += 0.000713) {
+    double sine, cosine;
+    fast_sincos(x, sine, cosine);
+    max_error = std::fmax(max_error, std::fabs(sine - std::sin(x)));
+    max_error = std::fmax(max_error, std::fabs(cosine - std::cos(x)));
+  }
+  std::cout << "fast_sincos max error: " << max_error << "\n";
+  failures += max_error > 1e-15;
+
+  // TEST: batch equations of motion against aircrafts_EOM
+  std::size_t size{1000};
+  thread_pool serial_pool{1};
+  aircraft_ensemble ensemble{size};
+  ensemble.disperse(test_dispersion(), 7, serial_pool);
+  std::vector<double> derivative_data(AIRCRAFT_STATE_SIZE * size);
+  std::vector<double> load_data(6 * size);
+  aircraft_state_arrays derivative;
+  vector_arrays force, moment;
+  for (std::size_t c = 0; c < AIRCRAFT_STATE_SIZE; ++c) {
+    derivative[c] = derivative_data.data() + c * size;
+  }
+  for (std::size_t c = 0; c < 3; ++c) {
+    force[c] = load_data.data() + c * size;
+    moment[c] = load_data.data() + (c + 3) * size;
+  }
+  for (std::size_t i = 0; i < size; ++i) {
+    for (std::size_t c = 0; c < 3; ++c) {
+      force[c][i] = 100.0 * std::sin(0.1 * static_cast<double>(i + c));
+      moment[c][i] = 10.0 * std::cos(0.2 * static_cast<double>(i + c));
+    }
+  }
+  aircraft_mass_arrays mass{ensemble.mass_arrays()};
+  aircrafts_EOM_batch(size, ensemble.state_arrays(), mass, force, moment,
+                      derivative);
+  max_error = 0.0;
+  for (std::size_t i = 0; i < size; ++i) {
+    std::array<std::array<double, 3>, 3> inertia_tensor{
+        {{mass.inertia_xx[i], 0.0, mass.inertia_xz[i]},
+         {0.0, mass.inertia_yy[i], 0.0},
+         {mass.inertia_xz[i], 0.0, mass.inertia_zz[i]}}};
+    std::array<double, 12> reference{aircrafts_EOM(
+        ensemble.member_state(i), mass.mass[i],
+        {force[0][i], force[1][i], force[2][i]},
+        {moment[0][i], moment[1][i], moment[2][i]}, inertia_tensor)};
+    for (std::size_t c = 0; c < AIRCRAFT_STATE_SIZE; ++c) {
+      max_error = std::fmax(max_error,
+                            std::fabs(derivative[c][i] - reference[c]) /
+                                std::fmax(std::fabs(reference[c]), 1.0));
+    }
+  }
+  std::cout << "Batch EOM max relative error: " << max_error << "\n";
+  failures += max_error > 1e-12;
+
+  // TEST: ensemble RK4 against the scalar RK4 for each member
+  std::vector<double> serial_states{run_ensemble(size, serial_pool)};
+  aircraft_ensemble initial{size};
+  initial.disperse(test_dispersion(), 7, serial_pool);
+  max_error = 0.0;
+  for (std::size_t i = 0; i < size; i += 37) {
+    aircraft_state state{initial.member_state(i)};
+    aircraft_mass_arrays m{initial.mass_arrays()};
+    std::array<std::array<double, 3>, 3> inertia_tensor{
+        {{m.inertia_xx[i], 0.0, m.inertia_xz[i]},
+         {0.0, m.inertia_yy[i], 0.0},
+         {m.inertia_xz[i], 0.0, m.inertia_zz[i]}}};
+    aircraft_dynamics<single_test_model> dynamics{
+        m.mass[i], inertia_tensor, single_test_model{i, m.mass[i]}};
+    RK4_integrator<AIRCRAFT_STATE_SIZE> rk4;
+    double time_s{0.0};
+    rk4.integrate(dynamics, time_s, 2.0, 0.01, state);
+    for (std::size_t c = 0; c < AIRCRAFT_STATE_SIZE; ++c) {
+      double value{serial_states[i * AIRCRAFT_STATE_SIZE + c]};
+      max_error = std::fmax(max_error, std::fabs(value - state[c]) /
+                                           std::fmax(std::fabs(state[c]), 1.0));
+    }
+  }
+  std::cout << "Ensemble vs scalar RK4 max relative error: " << max_error
+            << "\n";
+  failures += max_error > 1e-10;
+
+  // TEST: bit-identical results for any number of threads
+  for (std::size_t threads : {2, 3, 8}) {
+    thread_pool pool{threads};
+    std::vector<double> states{run_ensemble(size, pool)};
+    bool identical{std::memcmp(states.data(), serial_states.data(),
+                               states.size() * sizeof(double)) == 0};
+    std::cout << threads << " threads reproduce 1 thread: " << identical
+              << "\n";
+    failures += !identical;
+  }
+
+  // TEST: a member's dispersion does not depend on the ensemble size
+  aircraft_ensemble small{10};
+  small.disperse(test_dispersion(), 7, serial_pool);
+  failures += small.member_state(9) != initial.member_state(9);
+
+  // throughput of the default pool
+  aircraft_ensemble large{20000};
+  large.disperse(test_dispersion(), 11);
+  ensemble_integrator<ensemble_test_model> integrator{large,
+                                                      ensemble_test_model{}};
+  auto start{std::chrono::steady_clock::now()};
+  double time_s{0.0};
+  integrator.integrate(time_s, 0.5, 0.01);
+  std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() -
+                                        start};
+  std::cout << "Ensemble member-steps per second ("
+            << default_thread_pool().size() << " threads): "
+            << 20000.0 * 50.0 / elapsed.count() << "\n";
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+#ifndef TEST_HELPERS_HPP
+#define TEST_HELPERS_HPP
+
+// helpers shared by the tests
+
+#include <cmath>
+
+// relative difference, guarded for values close to zero
+inline double relative_error(double value, double reference) {
+  return std::fabs(value - reference) /
+         std::fmax(std::fabs(reference), 1e-300);
+}
+
+#endif // !TEST_HELPERS_HPP
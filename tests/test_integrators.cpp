@@ -0,0 +1,178 @@
+#include "../include/aircraftmotion.hpp"
+#include "../include/integrators.hpp"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+// count heap allocations, to check that stepping does not allocate
+static std::size_t allocation_count{0};
+
+void *operator new(std::size_t size) {
+  ++allocation_count;
+  if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+// x'' = -x, solution x = cos(t)
+struct harmonic_oscillator {
+  void operator()(double, const std::array<double, 2> &state,
+                  std::array<double, 2> &derivative) {
+    derivative[0] = state[1];
+    derivative[1] = -state[0];
+  }
+};
+
+// y' = -1/sqrt(y) reaches y = 0 at t = 2/3 and leaves its domain after
+struct finite_time_blowup {
+  void operator()(double, const std::array<double, 1> &state,
+                  std::array<double, 1> &derivative) {
+    derivative[0] = -1.0 / std::sqrt(state[0]);
+  }
+};
+
+// constant body force, no moment
+struct constant_force {
+  double force_N;
+  void operator()(double, const aircraft_state &, std::array<double, 3> &force,
+                  std::array<double, 3> &moment) {
+    force = {force_N, 0.0, 0.0};
+    moment = {0.0, 0.0, 0.0};
+  }
+};
+
+int main(void) {
+  int failures{0};
+
+  // TEST: RK4 error decreases with the fourth power of the step
+  harmonic_oscillator oscillator;
+  RK4_integrator<2> rk4;
+  double errors[2];
+  double steps_s[2]{0.01, 0.005};
+  for (int k = 0; k < 2; ++k) {
+    std::array<double, 2> state{1.0, 0.0};
+    double time_s{0.0};
+    rk4.integrate(oscillator, time_s, 10.0, steps_s[k], state);
+    errors[k] = std::fabs(state[0] - std::cos(10.0));
+  }
+  double order{std::log2(errors[0] / errors[1])};
+  std::cout << "RK4 error " << errors[0] << ", observed order " << order
+            << "\n";
+  failures += std::fabs(order - 4.0) > 0.2;
+
+  // TEST: Dormand-Prince meets its tolerance
+  DormandPrince54_integrator<2> dp54{1e-10, 1e-10};
+  std::array<double, 2> state{1.0, 0.0};
+  double time_s{0.0};
+  double step_s{0.1};
+  integration_stats stats{dp54.integrate(oscillator, time_s, 10.0, step_s,
+                                         state)};
+  double error{std::fabs(state[0] - std::cos(10.0))};
+  std::cout << "DP54 error " << error << ", " << stats.accepted_steps
+            << " accepted, " << stats.rejected_steps << " rejected, "
+            << stats.derivative_evaluations << " evaluations\n";
+  failures += error > 1e-8;
+  failures += time_s != 10.0;
+
+  // TEST: aircraft under a constant forward force, x = a t^2 / 2
+  double mass{1000.0};
+  std::array<std::array<double, 3>, 3> inertia_tensor{
+      {{1000.0, 0.0, 0.0}, {0.0, 2000.0, 0.0}, {0.0, 0.0, 3000.0}}};
+  aircraft_dynamics<constant_force> dynamics{mass, inertia_tensor,
+                                             constant_force{500.0}};
+  RK4_integrator<AIRCRAFT_STATE_SIZE> aircraft_rk4;
+  DormandPrince54_integrator<AIRCRAFT_STATE_SIZE> aircraft_dp54;
+  aircraft_state aircraft{0.0};
+  aircraft[STATE_YAW] = 0.3;
+
+  std::size_t allocations_before{allocation_count};
+  time_s = 0.0;
+  aircraft_rk4.integrate(dynamics, time_s, 10.0, 0.01, aircraft);
+  aircraft_state adaptive{0.0};
+  adaptive[STATE_YAW] = 0.3;
+  time_s = 0.0;
+  step_s = 0.01;
+  aircraft_dp54.integrate(dynamics, time_s, 10.0, step_s, adaptive);
+  std::size_t allocations{allocation_count - allocations_before};
+
+  double distance_m{0.5 * 500.0 / mass * 100.0};
+  double position_error{
+      std::fabs(aircraft[STATE_EARTH_POS_X] - distance_m * std::cos(0.3)) +
+      std::fabs(aircraft[STATE_EARTH_POS_Y] - distance_m * std::sin(0.3)) +
+      std::fabs(adaptive[STATE_EARTH_POS_X] - distance_m * std::cos(0.3)) +
+      std::fabs(adaptive[STATE_EARTH_POS_Y] - distance_m * std::sin(0.3))};
+  std::cout << "Constant force position error [m]: " << position_error
+            << "\n";
+  failures += position_error > 1e-9;
+
+  // TEST: no heap allocations while stepping
+  std::cout << "Allocations while stepping: " << allocations << "\n";
+  failures += allocations != 0;
+
+  // TEST: the adaptive integration stops when the system leaves its domain
+  finite_time_blowup blowup;
+  DormandPrince54_integrator<1> blowup_dp54;
+  std::array<double, 1> blowup_state{1.0};
+  double blowup_time_s{0.0};
+  double blowup_step_s{0.01};
+  integration_stats blowup_stats{blowup_dp54.integrate(
+      blowup, blowup_time_s, 2.0, blowup_step_s, blowup_state)};
+  std::cout << "Domain exit stopped at t = " << blowup_time_s
+            << " s, status " << static_cast<int>(blowup_stats.status)
+            << "\n";
+  failures += blowup_stats.status == INTEGRATION_OK;
+  failures += std::fabs(blowup_time_s - 2.0 / 3.0) > 1e-6;
+  blowup_state = {-1.0};
+  blowup_time_s = 0.0;
+  blowup_stats = blowup_dp54.integrate(blowup, blowup_time_s, 2.0,
+                                       blowup_step_s, blowup_state);
+  failures += blowup_stats.status != INTEGRATION_NON_FINITE;
+  failures += blowup_time_s != 0.0;
+
+  // TEST: steps that are not positive are rejected
+  int invalid_steps{0};
+  double invalid_steps_s[3]{0.0, -1.0, std::nan("")};
+  for (double invalid_step_s : invalid_steps_s) {
+    std::array<double, 2> state{1.0, 0.0};
+    double start_s{0.0};
+    try {
+      rk4.integrate(oscillator, start_s, 1.0, invalid_step_s, state);
+    } catch (const std::invalid_argument &) {
+      ++invalid_steps;
+    }
+    try {
+      dp54.integrate(oscillator, start_s, 1.0, invalid_step_s, state);
+    } catch (const std::invalid_argument &) {
+      ++invalid_steps;
+    }
+  }
+  std::cout << "Invalid steps rejected: " << invalid_steps << "\n";
+  failures += invalid_steps != 6;
+
+  // steps per second on this core
+  std::size_t step_count{200000};
+  auto start{std::chrono::steady_clock::now()};
+  time_s = 0.0;
+  for (std::size_t i = 0; i < step_count; ++i) {
+    aircraft_rk4.step(dynamics, time_s, 1e-4, aircraft);
+    time_s += 1e-4;
+  }
+  std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() -
+                                        start};
+  std::cout << "RK4 aircraft steps per second: "
+            << static_cast<double>(step_count) / elapsed.count() << "\n";
+  failures += !std::isfinite(aircraft[STATE_EARTH_POS_X]);
+
+  return failures == 0 ? 0 : 1;
+}
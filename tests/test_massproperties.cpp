@@ -0,0 +1,229 @@
+#include "../include/aircraftmotion.hpp"
+#include "../include/massproperties.hpp"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using tensor = std::array<std::array<double, 3>, 3>;
+
+double relative_difference(const std::array<double, 12> &value,
+                           const std::array<double, 12> &reference) {
+  double difference{0.0};
+  for (std::size_t i = 0; i < 12; ++i) {
+    difference = std::fmax(difference,
+                           std::fabs(value[i] - reference[i]) /
+                               std::fmax(std::fabs(reference[i]), 1.0));
+  }
+  return difference;
+}
+
+// time per call of evaluate(i), which returns a derivative, over the
+// samples, in ns
+template <typename Function>
+double time_per_call(std::size_t count, Function evaluate) {
+  double checksum{0.0};
+  auto start{std::chrono::steady_clock::now()};
+  for (int repeat = 0; repeat < 20; ++repeat) {
+    for (std::size_t i = 0; i < count; ++i) {
+      // every entry is used, so that none of the work can be left out
+      for (auto value : evaluate(i)) {
+        checksum += static_cast<double>(value);
+      }
+    }
+  }
+  std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() -
+                                        start};
+  // keep the results alive
+  if (checksum == 0.123456789) {
+    std::cout << checksum;
+  }
+  return elapsed.count() / (20.0 * count) * 1e9;
+}
+
+int main(void) {
+  int failures{0};
+  std::mt19937_64 generator{2024};
+  std::uniform_real_distribution<double> angle{-1.4, 1.4};
+  std::uniform_real_distribution<double> value{-1.0, 1.0};
+
+  const std::size_t count{20000};
+  std::vector<aircraft_state> states(count);
+  std::vector<std::array<double, 3>> forces(count), moments(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    states[i] = {0.0,
+                 0.0,
+                 -1000.0,
+                 angle(generator),
+                 angle(generator),
+                 2.0 * angle(generator),
+                 60.0 + 10.0 * value(generator),
+                 5.0 * value(generator),
+                 5.0 * value(generator),
+                 value(generator),
+                 value(generator),
+                 value(generator)};
+    forces[i] = {1000.0 * value(generator), 1000.0 * value(generator),
+                 1000.0 * value(generator)};
+    moments[i] = {500.0 * value(generator), 500.0 * value(generator),
+                  500.0 * value(generator)};
+  }
+  const double mass{1200.0};
+  const tensor xz_inertia{
+      {{1300.0, 0.0, -60.0}, {0.0, 1800.0, 0.0}, {-60.0, 0.0, 2600.0}}};
+  const tensor diagonal_inertia{
+      {{1300.0, 0.0, 0.0}, {0.0, 1800.0, 0.0}, {0.0, 0.0, 2600.0}}};
+  const tensor full_inertia{
+      {{1300.0, -25.0, -60.0}, {-25.0, 1800.0, 15.0}, {-60.0, 15.0, 2600.0}}};
+
+  mass_properties<double> xz_properties{mass, xz_inertia};
+  mass_properties<double, inertia_symmetry::diagonal> diagonal_properties{
+      mass, diagonal_inertia};
+  mass_properties<double, inertia_symmetry::full> full_xz_properties{
+      mass, xz_inertia};
+  mass_properties<double, inertia_symmetry::full> full_properties{
+      mass, full_inertia};
+
+  std::vector<direction_cosine_matrix> attitudes;
+  attitudes.reserve(count);
+  for (const aircraft_state &x : states) {
+    attitudes.emplace_back(x[STATE_ROLL], x[STATE_PITCH], x[STATE_YAW]);
+  }
+
+  double xz_error{0.0}, diagonal_error{0.0}, full_error{0.0};
+  double attitude_error{0.0};
+  double residual{0.0};
+  for (std::size_t i = 0; i < count; ++i) {
+    const aircraft_state &x{states[i]};
+    // TEST: the default (xz-plane) specialization against aircrafts_EOM
+    std::array<double, 12> reference{
+        aircrafts_EOM(x, mass, forces[i], moments[i], xz_inertia)};
+    xz_error = std::fmax(
+        xz_error, relative_difference(
+                      aircrafts_EOM(x, xz_properties, forces[i], moments[i]),
+                      reference));
+    // TEST: the same with a precomputed direction cosine matrix
+    attitude_error = std::fmax(
+        attitude_error,
+        relative_difference(aircrafts_EOM(x, attitudes[i], xz_properties,
+                                          forces[i], moments[i]),
+                            reference));
+    // TEST: the full inverse reproduces the xz-plane equations
+    full_error = std::fmax(
+        full_error,
+        relative_difference(
+            aircrafts_EOM(x, full_xz_properties, forces[i], moments[i]),
+            reference));
+    // TEST: the diagonal specialization
+    diagonal_error = std::fmax(
+        diagonal_error,
+        relative_difference(
+            aircrafts_EOM(x, diagonal_properties, forces[i], moments[i]),
+            aircrafts_EOM(x, mass, forces[i], moments[i], diagonal_inertia)));
+
+    // TEST: with a full tensor, I dw/dt + w x (I w) = moment
+    std::array<double, 12> derivative{
+        aircrafts_EOM(x, full_properties, forces[i], moments[i])};
+    std::array<double, 3> w{x[STATE_FORWARD_ANG_VEL],
+                            x[STATE_LATERAL_ANG_VEL],
+                            x[STATE_DOWNWARD_ANG_VEL]};
+    std::array<double, 3> dw{derivative[9], derivative[10], derivative[11]};
+    std::array<double, 3> h{}, Idw{};
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col) {
+        h[row] += full_inertia[row][col] * w[col];
+        Idw[row] += full_inertia[row][col] * dw[col];
+      }
+    }
+    std::array<double, 3> balance{
+        Idw[0] + w[1] * h[2] - w[2] * h[1] - moments[i][0],
+        Idw[1] + w[2] * h[0] - w[0] * h[2] - moments[i][1],
+        Idw[2] + w[0] * h[1] - w[1] * h[0] - moments[i][2]};
+    for (double b : balance) {
+      residual = std::fmax(residual, std::fabs(b));
+    }
+  }
+  std::cout << "xz-plane vs aircrafts_EOM: " << xz_error
+            << ", with a direction cosine matrix: " << attitude_error
+            << ", diagonal: " << diagonal_error
+            << ", full with xz tensor: " << full_error
+            << ", full tensor moment residual [Nm]: " << residual << "\n";
+  failures += xz_error > 1e-13;
+  failures += attitude_error > 1e-13;
+  failures += diagonal_error > 1e-13;
+  failures += full_error > 1e-13;
+  failures += residual > 1e-9;
+
+  // TEST: float specialization against the double one
+  std::array<std::array<float, 3>, 3> xz_inertia_float;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) {
+      xz_inertia_float[row][col] = static_cast<float>(xz_inertia[row][col]);
+    }
+  }
+  mass_properties<float> float_properties{static_cast<float>(mass),
+                                          xz_inertia_float};
+  std::vector<std::array<float, 12>> float_states(count);
+  std::vector<std::array<float, 3>> float_forces(count), float_moments(count);
+  double float_error{0.0};
+  for (std::size_t i = 0; i < count; ++i) {
+    for (std::size_t c = 0; c < 12; ++c) {
+      float_states[i][c] = static_cast<float>(states[i][c]);
+    }
+    for (std::size_t c = 0; c < 3; ++c) {
+      float_forces[i][c] = static_cast<float>(forces[i][c]);
+      float_moments[i][c] = static_cast<float>(moments[i][c]);
+    }
+    std::array<float, 12> derivative{aircrafts_EOM(
+        float_states[i], float_properties, float_forces[i], float_moments[i])};
+    std::array<double, 12> as_double;
+    for (std::size_t c = 0; c < 12; ++c) {
+      as_double[c] = derivative[c];
+    }
+    float_error = std::fmax(
+        float_error,
+        relative_difference(as_double,
+                            aircrafts_EOM(states[i], xz_properties, forces[i],
+                                          moments[i])) *
+            std::cos(states[i][STATE_PITCH]));
+  }
+  std::cout << "float vs double: " << float_error << "\n";
+  failures += float_error > 1e-4;
+
+  // cost of one derivative evaluation
+  double legacy_ns{time_per_call(count, [&](std::size_t i) {
+    return aircrafts_EOM(states[i], mass, forces[i], moments[i], xz_inertia);
+  })};
+  double xz_ns{time_per_call(count, [&](std::size_t i) {
+    return aircrafts_EOM(states[i], xz_properties, forces[i], moments[i]);
+  })};
+  double diagonal_ns{time_per_call(count, [&](std::size_t i) {
+    return aircrafts_EOM(states[i], diagonal_properties, forces[i],
+                         moments[i]);
+  })};
+  double float_ns{time_per_call(count, [&](std::size_t i) {
+    return aircrafts_EOM(float_states[i], float_properties, float_forces[i],
+                         float_moments[i]);
+  })};
+  std::cout << "EOM evaluation [ns]: inertia tensor " << legacy_ns
+            << ", xz-plane " << xz_ns << ", diagonal " << diagonal_ns
+            << ", float xz-plane " << float_ns << "\n";
+  // the same with the attitude already turned into direction cosine
+  // matrices: the sines and cosines take most of the time above
+  double legacy_attitude_ns{time_per_call(count, [&](std::size_t i) {
+    return aircrafts_EOM(states[i], attitudes[i], mass, forces[i], moments[i],
+                         xz_inertia);
+  })};
+  double xz_attitude_ns{time_per_call(count, [&](std::size_t i) {
+    return aircrafts_EOM(states[i], attitudes[i], xz_properties, forces[i],
+                         moments[i]);
+  })};
+  std::cout << "EOM evaluation with a direction cosine matrix [ns]: inertia "
+               "tensor "
+            << legacy_attitude_ns << ", xz-plane " << xz_attitude_ns << "\n";
+
+  return failures == 0 ? 0 : 1;
+}
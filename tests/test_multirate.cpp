@@ -0,0 +1,231 @@
+#include "../include/aircraftmotion.hpp"
+#include "../include/integrators.hpp"
+#include "../include/multirate.hpp"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+const double CLIMB_MASS_kg{1200.0};
+const std::array<std::array<double, 3>, 3> CLIMB_INERTIA{
+    {{1300.0, 0.0, -60.0}, {0.0, 1800.0, 0.0}, {-60.0, 0.0, 2600.0}}};
+
+// atmosphere evaluated at every call
+struct direct_atmosphere {
+  std::array<double, CACHED_ISA_SIZE>
+  operator()(double, const std::array<double, 1> &height_m) {
+    return ISA_evaluation{}(height_m);
+  }
+};
+
+// climbing aircraft with thrust, lift and drag from the air density
+template <typename Atmosphere> struct climb_model {
+  Atmosphere *atmosphere;
+  void operator()(double time_s, const aircraft_state &state,
+                  const direction_cosine_matrix &attitude,
+                  std::array<double, 3> &force_vector,
+                  std::array<double, 3> &moment_vector) {
+    const std::array<double, CACHED_ISA_SIZE> &air{
+        (*atmosphere)(time_s, {-state[STATE_EARTH_POS_Z]})};
+    double u{state[STATE_FORWARD_VEL]}, w{state[STATE_DOWNWARD_VEL]};
+    double dynamic_pressure{0.5 * air[CACHED_ISA_DENSITY] * (u * u + w * w) *
+                            16.0};
+    force_vector = attitude.earth_to_body(
+        {0.0, 0.0, CLIMB_MASS_kg * GRAVITY_SEALEVEL_mps2});
+    force_vector[0] += 3500.0 - 0.03 * dynamic_pressure;
+    force_vector[2] -= (0.45 + 4.0 * w / u) * dynamic_pressure;
+    moment_vector = {0.0, 0.0, 0.0};
+  }
+};
+
+const aircraft_state CLIMB_START{0.0, 0.0, -500.0, 0.0, 0.12, 0.0,
+                                 55.0, 0.0, 0.0,   0.0, 0.0, 0.0};
+
+bool same_state(const aircraft_state &a, const aircraft_state &b) {
+  return std::memcmp(a.data(), b.data(), sizeof(a)) == 0;
+}
+
+double position_difference(const aircraft_state &a, const aircraft_state &b) {
+  double difference{0.0};
+  for (std::size_t i = STATE_EARTH_POS_X; i <= STATE_EARTH_POS_Z; ++i) {
+    difference = std::fmax(difference, std::fabs(a[i] - b[i]));
+  }
+  return difference;
+}
+
+// integrate 120 s with the atmosphere, through multirate_system when
+// step_hooks; returns the final state
+template <typename Atmosphere>
+aircraft_state climb(Atmosphere &atmosphere, bool step_hooks, double &seconds,
+                     integration_stats &stats) {
+  aircraft_dynamics<climb_model<Atmosphere>> dynamics{
+      CLIMB_MASS_kg, CLIMB_INERTIA, climb_model<Atmosphere>{&atmosphere}};
+  DormandPrince54_integrator<AIRCRAFT_STATE_SIZE> integrator{1e-9, 1e-9};
+  aircraft_state state{CLIMB_START};
+  double time_s{0.0}, step_s{0.1};
+  auto start{std::chrono::steady_clock::now()};
+  if constexpr (std::is_same_v<Atmosphere, direct_atmosphere>) {
+    stats = integrator.integrate(dynamics, time_s, 120.0, step_s, state);
+  } else if (step_hooks) {
+    multirate_system system{dynamics, atmosphere};
+    stats = integrator.integrate(system, time_s, 120.0, step_s, state);
+  } else {
+    stats = integrator.integrate(dynamics, time_s, 120.0, step_s, state);
+  }
+  std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() -
+                                        start};
+  seconds = elapsed.count();
+  return state;
+}
+
+int main(void) {
+  int failures{0};
+
+  // TEST: refresh rules and rollback of one cache
+  int calls{0};
+  auto square = [&calls](const std::array<double, 1> &key) {
+    ++calls;
+    return key[0] * key[0];
+  };
+  cached_subsystem<1, decltype(square)> cache{square, {1.0}, 1.0};
+  bool rules{true};
+  rules &= cache(0.0, {0.0}) == 0.0 && calls == 1;
+  // within the tolerance: the cached output
+  rules &= cache(0.1, {0.5}) == 0.0 && calls == 1;
+  // key beyond the tolerance
+  rules &= cache(0.2, {1.5}) == 2.25 && calls == 2;
+  // update period elapsed
+  rules &= cache(1.3, {1.5}) == 2.25 && calls == 3;
+  // time going backwards
+  rules &= cache(1.0, {1.5}) == 2.25 && calls == 4;
+  // held during a step; the commit reports the refresh that is due
+  cache.checkpoint();
+  rules &= cache(1.2, {5.0}) == 2.25 && calls == 4;
+  rules &= cache.commit();
+  rules &= cache(1.2, {5.0}) == 25.0 && calls == 5;
+  // a rejected step leaves the cache as at its start
+  cache.checkpoint();
+  rules &= cache(1.4, {9.0}) == 25.0 && calls == 5;
+  cache.rollback();
+  cache.checkpoint();
+  rules &= !cache.commit();
+  rules &= cache.evaluations() == 8 && cache.refreshes() == 5 &&
+           cache.rollbacks() == 1;
+  rules &= cache.max_key_drift()[0] == 3.5;
+  cache.invalidate();
+  rules &= cache(1.4, {5.2}) == 5.2 * 5.2 && calls == 6;
+  std::cout << "Cache refresh rules and rollback: " << rules << "\n";
+  failures += !rules;
+
+  // TEST: a generic function gives the first-order expansion
+  auto exponential = [&calls](const auto &key) {
+    using std::exp;
+    ++calls;
+    return std::array{exp(key[0])};
+  };
+  cached_subsystem<1, decltype(exponential)> expansion{exponential, {0.1}};
+  calls = 0;
+  bool first_order{expansion.first_order};
+  first_order &= expansion(0.0, {1.0})[0] == std::exp(1.0);
+  first_order &= std::fabs(expansion(0.1, {1.05})[0] -
+                           1.05 * std::exp(1.0)) < 1e-15;
+  first_order &= std::fabs(expansion(0.2, {1.2})[0] - std::exp(1.2)) < 1e-15;
+  first_order &= calls == 2;
+  std::cout << "First-order expansion: " << first_order << "\n";
+  failures += !first_order;
+
+  // reference: the atmosphere at every derivative evaluation
+  direct_atmosphere direct;
+  double direct_s{0.0};
+  integration_stats direct_stats{};
+  aircraft_state reference{climb(direct, false, direct_s, direct_stats)};
+  std::cout << "Climb from " << -CLIMB_START[STATE_EARTH_POS_Z] << " to "
+            << -reference[STATE_EARTH_POS_Z] << " m, "
+            << direct_stats.accepted_steps << " steps ("
+            << direct_stats.rejected_steps << " rejected)\n";
+
+  // TEST: without the step hooks, a zero tolerance gives exactly the
+  // uncached trajectory
+  cached_atmosphere exact{ISA_evaluation{}, {0.0}};
+  double exact_s{0.0};
+  integration_stats exact_stats{};
+  aircraft_state exact_state{climb(exact, false, exact_s, exact_stats)};
+  std::cout << "Zero tolerance equals uncached: "
+            << same_state(exact_state, reference) << "\n";
+  failures += !same_state(exact_state, reference);
+
+  // TEST: a 0.5 m height tolerance refreshes the atmosphere a fraction of
+  // the time and stays close to the reference
+  cached_atmosphere coarse{ISA_evaluation{}, {0.5}};
+  double coarse_s{0.0};
+  integration_stats coarse_stats{};
+  aircraft_state coarse_state{climb(coarse, true, coarse_s, coarse_stats)};
+  double error_m{position_difference(coarse_state, reference)};
+  std::cout << "0.5 m tolerance: " << coarse.refreshes() << " refreshes of "
+            << coarse.evaluations() << " evaluations, "
+            << coarse_stats.accepted_steps << " steps ("
+            << coarse_stats.rejected_steps << " rejected), largest drift "
+            << coarse.max_key_drift()[0] << " m, position error " << error_m
+            << " m\n  time [ms] uncached " << direct_s * 1e3 << ", cached "
+            << coarse_s * 1e3 << "\n";
+  // the height changes by less than 25 m in one step
+  failures += coarse.max_key_drift()[0] > 25.0;
+  failures += coarse.refreshes() * 4 > coarse.evaluations();
+  failures += coarse_stats.accepted_steps > direct_stats.accepted_steps * 5 / 4;
+  failures += error_m > 1e-3;
+
+  // TEST: a rejected step leaves no trace: reject then retry gives the same
+  // state as trying the smaller step directly
+  cached_atmosphere atmosphere{ISA_evaluation{}, {0.5}};
+  aircraft_dynamics<climb_model<cached_atmosphere>> dynamics{
+      CLIMB_MASS_kg, CLIMB_INERTIA,
+      climb_model<cached_atmosphere>{&atmosphere}};
+  DormandPrince54_integrator<AIRCRAFT_STATE_SIZE> integrator{1e-9, 1e-9};
+  multirate_system system{dynamics, atmosphere};
+  aircraft_state state{CLIMB_START};
+  double time_s{0.0}, step_s{0.05};
+  integrator.try_step(system, time_s, step_s, state);
+
+  cached_atmosphere atmosphere_copy{atmosphere};
+  aircraft_dynamics<climb_model<cached_atmosphere>> dynamics_copy{
+      CLIMB_MASS_kg, CLIMB_INERTIA,
+      climb_model<cached_atmosphere>{&atmosphere_copy}};
+  DormandPrince54_integrator<AIRCRAFT_STATE_SIZE> integrator_copy{integrator};
+  multirate_system system_copy{dynamics_copy, atmosphere_copy};
+  aircraft_state state_copy{state};
+  double time_copy_s{time_s};
+
+  double large_s{30.0}, small_s{0.05}, small_copy_s{0.05};
+  bool rejected{!integrator.try_step(system, time_s, large_s, state)};
+  bool retried{integrator.try_step(system, time_s, small_s, state)};
+  bool direct_step{integrator_copy.try_step(system_copy, time_copy_s,
+                                            small_copy_s, state_copy)};
+  bool identical{rejected && retried && direct_step &&
+                 same_state(state, state_copy) && small_s == small_copy_s};
+  std::cout << "Retried step after a rejection equals the direct step: "
+            << identical << "\n";
+  failures += !identical;
+
+  // TEST: fixed-rate refresh with RK4 (update period of 5 steps)
+  cached_subsystem<1, ISA_evaluation> sampled{
+      ISA_evaluation{}, {std::numeric_limits<double>::infinity()}, 0.05};
+  aircraft_dynamics<climb_model<cached_atmosphere>> sampled_dynamics{
+      CLIMB_MASS_kg, CLIMB_INERTIA,
+      climb_model<cached_atmosphere>{&sampled}};
+  multirate_system sampled_system{sampled_dynamics, sampled};
+  RK4_integrator<AIRCRAFT_STATE_SIZE> rk4;
+  aircraft_state sampled_state{CLIMB_START};
+  double sampled_time_s{0.0};
+  rk4.integrate(sampled_system, sampled_time_s, 120.0, 0.01, sampled_state);
+  double sampled_error_m{position_difference(sampled_state, reference)};
+  std::cout << "20 Hz atmosphere with 100 Hz RK4: " << sampled.refreshes()
+            << " refreshes of " << sampled.evaluations()
+            << " evaluations, position error " << sampled_error_m << " m\n";
+  // the first evaluation and the end of every fifth step
+  failures += sampled.refreshes() != 1 + 2400;
+  failures += sampled_error_m > 1e-3;
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+#include "../include/aircraftmotion.hpp"
+#include "../include/framesnrotations.hpp"
+#include "../include/integrators.hpp"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <random>
+
+// no forces or moments: torque-free rotation
+struct no_loads {
+  template <typename State>
+  void operator()(double, const State &, std::array<double, 3> &force,
+                  std::array<double, 3> &moment) {
+    force = {0.0, 0.0, 0.0};
+    moment = {0.0, 0.0, 0.0};
+  }
+};
+
+// Hamilton product
+quaternion multiply(const quaternion &a, const quaternion &b) {
+  return {a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+          a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+          a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+          a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w};
+}
+
+double matrix_difference(const direction_cosine_matrix &a,
+                         const direction_cosine_matrix &b) {
+  double difference{0.0};
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      difference = std::fmax(difference,
+                             std::fabs(a.matrix()[i][j] - b.matrix()[i][j]));
+    }
+  }
+  return difference;
+}
+
+int main(void) {
+  int failures{0};
+  std::mt19937_64 generator{2024};
+  std::uniform_real_distribution<double> angle{-1.5, 1.5};
+  std::uniform_real_distribution<double> rate{-1.0, 1.0};
+  const std::array<std::array<double, 3>, 3> inertia_tensor{
+      {{1000.0, 0.0, -80.0}, {0.0, 2500.0, 0.0}, {-80.0, 0.0, 3000.0}}};
+
+  double conversion_error{0.0};
+  double matrix_error{0.0};
+  double trig_error{0.0};
+  double rate_error{0.0};
+  for (int n = 0; n < 10000; ++n) {
+    double roll{2.0 * angle(generator)}, pitch{angle(generator)};
+    double yaw{2.0 * angle(generator)};
+
+    // TEST: Euler -> quaternion -> Euler
+    std::array<double, 3> euler{
+        quaternion_to_euler(euler_to_quaternion(roll, pitch, yaw))};
+    conversion_error = std::fmax(conversion_error,
+                                 std::fabs(euler[0] - roll) +
+                                     std::fabs(euler[1] - pitch) +
+                                     std::fabs(euler[2] - yaw));
+
+    // TEST: the DCM of the quaternion is the DCM of the angles
+    direction_cosine_matrix from_angles{roll, pitch, yaw};
+    direction_cosine_matrix from_quaternion{
+        euler_to_quaternion(roll, pitch, yaw)};
+    matrix_error = std::fmax(matrix_error,
+                             matrix_difference(from_angles, from_quaternion));
+    trig_error = std::fmax(
+        trig_error,
+        std::fabs(from_angles.sin_roll() - from_quaternion.sin_roll()) +
+            std::fabs(from_angles.cos_pitch() - from_quaternion.cos_pitch()) +
+            std::fabs(from_angles.sin_yaw() - from_quaternion.sin_yaw()));
+
+    // TEST: quaternion rates are the derivative of the quaternion of the
+    // Euler angles moving at the Euler EOM rates
+    aircraft_state state{0.0,  0.0,  0.0,  roll, pitch, yaw, 50.0,
+                         1.0, -2.0, rate(generator), rate(generator),
+                         rate(generator)};
+    std::array<double, 12> euler_derivative{
+        aircrafts_EOM(state, 1000.0, {100.0, 0.0, 0.0}, {10.0, 20.0, 30.0},
+                      inertia_tensor)};
+    std::array<double, 13> quaternion_derivative{aircrafts_quaternion_EOM(
+        to_quaternion_state(state), 1000.0, {100.0, 0.0, 0.0},
+        {10.0, 20.0, 30.0}, inertia_tensor)};
+    const double h{1e-6};
+    quaternion ahead{euler_to_quaternion(
+        roll + h * euler_derivative[STATE_ROLL],
+        pitch + h * euler_derivative[STATE_PITCH],
+        yaw + h * euler_derivative[STATE_YAW])};
+    quaternion behind{euler_to_quaternion(
+        roll - h * euler_derivative[STATE_ROLL],
+        pitch - h * euler_derivative[STATE_PITCH],
+        yaw - h * euler_derivative[STATE_YAW])};
+    double error{std::fabs((ahead.w - behind.w) / (2 * h) -
+                           quaternion_derivative[QUAT_STATE_W]) +
+                 std::fabs((ahead.x - behind.x) / (2 * h) -
+                           quaternion_derivative[QUAT_STATE_X]) +
+                 std::fabs((ahead.y - behind.y) / (2 * h) -
+                           quaternion_derivative[QUAT_STATE_Y]) +
+                 std::fabs((ahead.z - behind.z) / (2 * h) -
+                           quaternion_derivative[QUAT_STATE_Z])};
+    for (std::size_t i = 0; i < 3; ++i) {
+      error += std::fabs(euler_derivative[i] - quaternion_derivative[i]);
+    }
+    for (std::size_t i = 0; i < 6; ++i) {
+      error += std::fabs(euler_derivative[STATE_FORWARD_VEL + i] -
+                         quaternion_derivative[QUAT_STATE_FORWARD_VEL + i]);
+    }
+    // Euler rates grow as 1/cos(pitch), so does the finite difference error
+    rate_error = std::fmax(rate_error, error * std::cos(pitch));
+  }
+  std::cout << "Euler/quaternion round trip error: " << conversion_error
+            << "\n";
+  std::cout << "DCM from quaternion error: " << matrix_error
+            << ", trig error: " << trig_error << "\n";
+  std::cout << "Quaternion EOM vs Euler EOM error: " << rate_error << "\n";
+  failures += conversion_error > 1e-12;
+  failures += matrix_error > 1e-14;
+  failures += trig_error > 1e-14;
+  failures += rate_error > 1e-6;
+
+  // TEST: gimbal lock is handled by the conversions
+  direction_cosine_matrix vertical{euler_to_quaternion(0.0, M_PI / 2, 0.7)};
+  direction_cosine_matrix vertical_angles{0.0, M_PI / 2, 0.7};
+  double vertical_error{matrix_difference(vertical, vertical_angles)};
+  std::cout << "DCM at pitch 90 deg error: " << vertical_error << "\n";
+  failures += vertical_error > 1e-12;
+
+  // TEST: a pull-up through (almost) vertical flight with constant body
+  // pitch rate; the exact attitude is q0 (cos(q t / 2), 0, sin(q t / 2), 0)
+  const double roll0{0.001}, yaw0{0.4}, pitch_rate{0.5}, end_time_s{8.0};
+  aircraft_state euler_state{0.0, 0.0, 0.0, roll0, 0.0, yaw0,
+                             0.0, 0.0, 0.0, 0.0,   pitch_rate, 0.0};
+  aircraft_quaternion_state quaternion_state{to_quaternion_state(euler_state)};
+  std::array<std::array<double, 3>, 3> diagonal_inertia{
+      {{1000.0, 0.0, 0.0}, {0.0, 2500.0, 0.0}, {0.0, 0.0, 3000.0}}};
+
+  aircraft_dynamics<no_loads> euler_dynamics{1000.0, diagonal_inertia,
+                                             no_loads{}};
+  aircraft_quaternion_dynamics<no_loads> quaternion_dynamics{
+      1000.0, diagonal_inertia, no_loads{}};
+  DormandPrince54_integrator<AIRCRAFT_STATE_SIZE> euler_integrator{1e-9,
+                                                                   1e-9};
+  DormandPrince54_integrator<AIRCRAFT_QUATERNION_STATE_SIZE>
+      quaternion_integrator{1e-9, 1e-9};
+  double time_s{0.0}, step_s{0.1};
+  integration_stats euler_stats{euler_integrator.integrate(
+      euler_dynamics, time_s, end_time_s, step_s, euler_state)};
+  time_s = 0.0;
+  step_s = 0.1;
+  integration_stats quaternion_stats{quaternion_integrator.integrate(
+      quaternion_dynamics, time_s, end_time_s, step_s, quaternion_state)};
+
+  quaternion exact{
+      multiply(euler_to_quaternion(roll0, 0.0, yaw0),
+               {std::cos(0.5 * pitch_rate * end_time_s), 0.0,
+                std::sin(0.5 * pitch_rate * end_time_s), 0.0})};
+  direction_cosine_matrix exact_attitude{exact};
+  double quaternion_attitude_error{matrix_difference(
+      direction_cosine_matrix{state_quaternion(quaternion_state)},
+      exact_attitude)};
+  double euler_attitude_error{matrix_difference(
+      direction_cosine_matrix{euler_state[STATE_ROLL],
+                              euler_state[STATE_PITCH],
+                              euler_state[STATE_YAW]},
+      exact_attitude)};
+  std::cout << "Pull-up, Euler angles: " << euler_stats.accepted_steps
+            << " steps, attitude error " << euler_attitude_error << "\n";
+  std::cout << "Pull-up, quaternion: " << quaternion_stats.accepted_steps
+            << " steps, attitude error " << quaternion_attitude_error << "\n";
+  failures += quaternion_attitude_error > 1e-7;
+  failures += quaternion_stats.accepted_steps >= euler_stats.accepted_steps;
+
+  // TEST: the dynamics with precomputed mass properties match the EOM with
+  // the raw inertia tensor
+  std::array<std::array<double, 3>, 3> xz_inertia{
+      {{1200.0, 0.0, -150.0}, {0.0, 2500.0, 0.0}, {-150.0, 0.0, 3100.0}}};
+  aircraft_quaternion_state rolling{to_quaternion_state(
+      {10.0, 20.0, -300.0, 0.2, 0.3, 0.4, 80.0, 2.0, 5.0, 0.3, 0.5, 0.7})};
+  std::array<double, 3> force{200.0, -50.0, 900.0};
+  std::array<double, 3> moment{30.0, -40.0, 10.0};
+  auto constant_loads = [&](double, const aircraft_quaternion_state &,
+                            std::array<double, 3> &f,
+                            std::array<double, 3> &m) {
+    f = force;
+    m = moment;
+  };
+  aircraft_quaternion_dynamics<decltype(constant_loads)> xz_dynamics{
+      1000.0, xz_inertia, constant_loads};
+  aircraft_quaternion_dynamics<decltype(constant_loads),
+                               mass_properties<double, inertia_symmetry::full>>
+      full_dynamics{{1000.0, xz_inertia}, constant_loads};
+  aircraft_quaternion_state raw_derivative{aircrafts_quaternion_EOM(
+      rolling, 1000.0, force, moment, xz_inertia)};
+  aircraft_quaternion_state xz_derivative, full_derivative;
+  xz_dynamics(0.0, rolling, xz_derivative);
+  full_dynamics(0.0, rolling, full_derivative);
+  double mass_properties_error{0.0};
+  for (std::size_t i = 0; i < AIRCRAFT_QUATERNION_STATE_SIZE; ++i) {
+    double scale{std::fmax(1.0, std::fabs(raw_derivative[i]))};
+    mass_properties_error = std::fmax(
+        mass_properties_error,
+        std::fmax(std::fabs(xz_derivative[i] - raw_derivative[i]),
+                  std::fabs(full_derivative[i] - raw_derivative[i])) /
+            scale);
+  }
+  std::cout << "Quaternion EOM with mass properties, max error: "
+            << mass_properties_error << "\n";
+  failures += mass_properties_error > 1e-12;
+
+  // TEST: the norm correction keeps the drift of |q| bounded over a long
+  // tumbling run, while without it the drift keeps growing
+  aircraft_quaternion_state tumbling{
+      to_quaternion_state({0.0, 0.0, 0.0, 0.2, 0.3, 0.4, 0.0, 0.0, 0.0, 0.3,
+                           0.5, 0.7})};
+  aircraft_quaternion_state uncorrected{tumbling};
+  aircraft_quaternion_dynamics<no_loads> uncorrected_dynamics{
+      1000.0, diagonal_inertia, no_loads{}, 0.0};
+  RK4_integrator<AIRCRAFT_QUATERNION_STATE_SIZE> rk4;
+  auto norm_error = [](const aircraft_quaternion_state &state) {
+    quaternion q{state_quaternion(state)};
+    return std::fabs(
+        std::sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z) - 1.0);
+  };
+  double time_corrected_s{0.0}, time_uncorrected_s{0.0};
+  rk4.integrate(quaternion_dynamics, time_corrected_s, 1000.0, 0.05,
+                tumbling);
+  double early_error{norm_error(tumbling)};
+  rk4.integrate(quaternion_dynamics, time_corrected_s, 5000.0, 0.05,
+                tumbling);
+  rk4.integrate(uncorrected_dynamics, time_uncorrected_s, 5000.0, 0.05,
+                uncorrected);
+  std::cout << "Quaternion norm error after 1000 s: " << early_error
+            << ", after 5000 s: " << norm_error(tumbling)
+            << " (without correction " << norm_error(uncorrected) << ")\n";
+  failures += norm_error(tumbling) > 1.5 * early_error;
+  failures += norm_error(tumbling) > norm_error(uncorrected);
+
+  // to_euler_state normalizes before converting
+  normalize_quaternion(tumbling);
+  aircraft_state back{to_euler_state(tumbling)};
+  failures += std::fabs(back[STATE_LATERAL_ANG_VEL] -
+                        tumbling[QUAT_STATE_LATERAL_ANG_VEL]) != 0.0;
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+#include "../include/atmosphere.hpp"
+#include "../include/realtime.hpp"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+const double RIG_MASS_kg{1200.0};
+
+// thrust, drag and damping, driven by the controls
+struct rig_model {
+  void operator()(const aircraft_state &state,
+                  const aircraft_controls &controls,
+                  std::array<double, 3> &force_vector,
+                  std::array<double, 3> &moment_vector) const {
+    double weight{RIG_MASS_kg * GRAVITY_SEALEVEL_mps2};
+    double roll{state[STATE_ROLL]}, pitch{state[STATE_PITCH]};
+    force_vector = {3000.0 * controls[CONTROL_THROTTLE] -
+                        5.0 * state[STATE_FORWARD_VEL] -
+                        weight * std::sin(pitch),
+                    weight * std::cos(pitch) * std::sin(roll) -
+                        50.0 * state[STATE_LATERAL_VEL],
+                    weight * std::cos(pitch) * std::cos(roll) - weight -
+                        200.0 * state[STATE_DOWNWARD_VEL]};
+    moment_vector = {
+        -800.0 * state[STATE_FORWARD_ANG_VEL] +
+            500.0 * controls[CONTROL_AILERON],
+        -900.0 * state[STATE_LATERAL_ANG_VEL] -
+            2000.0 * controls[CONTROL_ELEVATOR],
+        -700.0 * state[STATE_DOWNWARD_ANG_VEL] +
+            300.0 * controls[CONTROL_RUDDER]};
+  }
+};
+
+void print_stats(const realtime_stats &stats) {
+  std::cout << "  frames " << stats.frames << ", deadline misses "
+            << stats.deadline_misses << ", telemetry drops "
+            << stats.telemetry_drops << ", control updates "
+            << stats.control_updates << "\n  execution [us]: mean "
+            << stats.execution.mean_ns() * 1e-3 << ", p99 "
+            << stats.execution.percentile_ns(0.99) * 1e-3 << ", max "
+            << stats.execution.max_ns() * 1e-3 << "\n  jitter [us]: mean "
+            << stats.jitter.mean_ns() * 1e-3 << ", p99 "
+            << stats.jitter.percentile_ns(0.99) * 1e-3 << ", max "
+            << stats.jitter.max_ns() * 1e-3 << "\n";
+}
+
+int main(void) {
+  int failures{0};
+
+  // TEST: a full ring refuses values and keeps the order
+  spsc_ring<int, 8> small;
+  bool accepted{true};
+  for (int i = 0; i < 8; ++i) {
+    accepted &= small.try_push(i);
+  }
+  bool full{!small.try_push(8)};
+  int value{-1};
+  bool in_order{true};
+  for (int i = 0; i < 8; ++i) {
+    in_order &= small.try_pop(value) && value == i;
+  }
+  bool empty{!small.try_pop(value)};
+  std::cout << "Ring of 8: accepts 8 " << accepted << ", refuses the 9th "
+            << full << ", in order " << in_order << ", empty " << empty
+            << "\n";
+  failures += !(accepted && full && in_order && empty);
+
+  // TEST: a producer and a consumer thread pass every value once, in order
+  const std::uint64_t count{1000000};
+  spsc_ring<std::uint64_t, 256> ring;
+  std::thread producer{[&] {
+    for (std::uint64_t i = 0; i < count; ++i) {
+      while (!ring.try_push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  }};
+  std::uint64_t expected{0}, out_of_order{0}, received{0};
+  while (expected < count) {
+    if (ring.try_pop(received)) {
+      out_of_order += received != expected;
+      ++expected;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  std::cout << "Threaded ring, " << count
+            << " values, out of order: " << out_of_order << "\n";
+  failures += out_of_order != 0;
+
+  // TEST: histogram bins, overflow and percentiles
+  frame_time_histogram histogram{1000, 10};
+  for (int i = 0; i < 90; ++i) {
+    histogram.record(2500);
+  }
+  for (int i = 0; i < 10; ++i) {
+    histogram.record(50000);
+  }
+  bool bins_ok{histogram.count() == 100 && histogram.counts()[2] == 90 &&
+               histogram.counts()[10] == 10 &&
+               histogram.percentile_ns(0.5) == 3000 &&
+               histogram.percentile_ns(0.99) == 50000 &&
+               histogram.max_ns() == 50000 &&
+               std::fabs(histogram.mean_ns() - 7250.0) < 1e-9};
+  std::cout << "Histogram bins and percentiles: " << bins_ok << "\n";
+  failures += !bins_ok;
+
+  // TEST: 200 frames at 500 Hz give the offline RK4 solution and one
+  // telemetry record per frame
+  const std::array<std::array<double, 3>, 3> inertia_tensor{
+      {{1300.0, 0.0, -60.0}, {0.0, 1800.0, 0.0}, {-60.0, 0.0, 2600.0}}};
+  mass_properties<double> properties{RIG_MASS_kg, inertia_tensor};
+  aircraft_state initial{0.0, 0.0, -1000.0, 0.1, 0.05, 0.0,
+                         60.0, 1.0, 2.0,   0.1, -0.1, 0.05};
+  aircraft_controls controls{0.4, 0.01, -0.02, 0.0};
+  const double period_s{0.002};
+  const std::uint64_t frames{200};
+
+  realtime_simulation<rig_model> simulation{rig_model{}, properties, initial,
+                                            controls, period_s};
+  std::int64_t start_ns{monotonic_time_ns()};
+  simulation.run(frames);
+  double elapsed_s{(monotonic_time_ns() - start_ns) * 1e-9};
+
+  aircraft_state reference{initial};
+  RK4_integrator<AIRCRAFT_STATE_SIZE> rk4;
+  auto system = [&](double, const aircraft_state &state,
+                    aircraft_state &derivative) {
+    derivative = aircraft_model_derivative(rig_model{}, properties, state,
+                                           controls);
+  };
+  for (std::uint64_t k = 0; k < frames; ++k) {
+    rk4.step(system, static_cast<double>(k) * period_s, period_s, reference);
+  }
+  bool same_state{std::memcmp(simulation.state().data(), reference.data(),
+                              sizeof(reference)) == 0};
+  realtime_telemetry record;
+  std::uint64_t records{0}, sequence_errors{0};
+  while (simulation.telemetry().try_pop(record)) {
+    sequence_errors += record.frame != records;
+    ++records;
+  }
+  const realtime_stats &stats{simulation.stats()};
+  std::cout << "500 Hz run: " << elapsed_s << " s, same state as offline "
+            << same_state << ", telemetry records " << records << "\n";
+  print_stats(stats);
+  failures += !same_state;
+  failures += stats.frames != frames || records != frames ||
+              sequence_errors != 0;
+  failures += stats.execution.count() != frames;
+  failures += std::fabs(simulation.time_s() - frames * period_s) > 1e-12;
+  // the last frame starts (frames) periods after run() is called
+  failures += elapsed_s < (frames - 1) * period_s;
+
+  // TEST: closed loop through the loopback I/O; the controls the loop used
+  // come back with the telemetry
+  realtime_simulation<rig_model> closed_loop{rig_model{}, properties, initial,
+                                             controls, period_s};
+  auto pitch_damper = [](const realtime_telemetry &telemetry) {
+    aircraft_controls command{telemetry.controls};
+    command[CONTROL_ELEVATOR] =
+        0.2 * telemetry.state[STATE_LATERAL_ANG_VEL];
+    return command;
+  };
+  loopback_io<decltype(closed_loop), decltype(pitch_damper)> io{closed_loop,
+                                                                 pitch_damper};
+  closed_loop.run(frames);
+  io.stop();
+  const realtime_stats &loop_stats{closed_loop.stats()};
+  std::cout << "Loopback run: received " << io.received() << ", sent "
+            << io.sent() << ", rejected " << io.rejected() << "\n";
+  print_stats(loop_stats);
+  failures += io.received() + loop_stats.telemetry_drops != frames;
+  failures += io.sent() + io.rejected() != io.received();
+  failures += loop_stats.control_updates == 0;
+  failures += io.last().frame + 1 != frames;
+
+  return failures == 0 ? 0 : 1;
+}
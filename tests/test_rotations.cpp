@@ -0,0 +1,164 @@
+#include "../include/aircraftmotion.hpp"
+#include "../include/framesnrotations.hpp"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <random>
+
+// gravity in body axes, using the cached attitude
+struct gravity_model {
+  double mass;
+  void operator()(double, const aircraft_state &,
+                  const direction_cosine_matrix &attitude,
+                  std::array<double, 3> &force, std::array<double, 3> &moment) {
+    force = attitude.earth_to_body({0.0, 0.0, mass * 9.80665});
+    moment = {0.0, 0.0, 0.0};
+  }
+};
+
+// same model computing the rotation from the angles
+struct gravity_model_angles {
+  double mass;
+  void operator()(double, const aircraft_state &state,
+                  std::array<double, 3> &force, std::array<double, 3> &moment) {
+    force = earth_to_body({0.0, 0.0, mass * 9.80665}, state[STATE_ROLL],
+                          state[STATE_PITCH], state[STATE_YAW]);
+    moment = {0.0, 0.0, 0.0};
+  }
+};
+
+int main(void) {
+  int failures{0};
+  std::mt19937_64 generator{2024};
+  std::uniform_real_distribution<double> angle{-1.5, 1.5};
+  std::uniform_real_distribution<double> value{-50.0, 50.0};
+
+  double orthogonality_error{0.0};
+  double round_trip_error{0.0};
+  double reference_error{0.0};
+  double kinematics_error{0.0};
+  for (int n = 0; n < 10000; ++n) {
+    double roll{angle(generator)}, pitch{angle(generator)};
+    double yaw{2.0 * angle(generator)};
+    direction_cosine_matrix attitude{roll, pitch, yaw};
+    const std::array<std::array<double, 3>, 3> &R{attitude.matrix()};
+
+    // TEST: the matrix is orthonormal
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        double dot{R[i][0] * R[j][0] + R[i][1] * R[j][1] + R[i][2] * R[j][2]};
+        orthogonality_error =
+            std::fmax(orthogonality_error, std::fabs(dot - (i == j)));
+      }
+    }
+
+    // TEST: earth_to_body inverts body_to_earth, and both match the
+    // elementary rotations yaw, pitch, roll applied in sequence
+    std::array<double, 3> v{value(generator), value(generator),
+                            value(generator)};
+    std::array<double, 3> back{
+        earth_to_body(body_to_earth(v, attitude), attitude)};
+    std::array<double, 3> yawed{std::cos(yaw) * v[0] + std::sin(yaw) * v[1],
+                                -std::sin(yaw) * v[0] + std::cos(yaw) * v[1],
+                                v[2]};
+    std::array<double, 3> pitched{
+        std::cos(pitch) * yawed[0] - std::sin(pitch) * yawed[2], yawed[1],
+        std::sin(pitch) * yawed[0] + std::cos(pitch) * yawed[2]};
+    std::array<double, 3> rolled{
+        pitched[0], std::cos(roll) * pitched[1] + std::sin(roll) * pitched[2],
+        -std::sin(roll) * pitched[1] + std::cos(roll) * pitched[2]};
+    std::array<double, 3> body{earth_to_body(v, roll, pitch, yaw)};
+    for (int i = 0; i < 3; ++i) {
+      round_trip_error = std::fmax(round_trip_error, std::fabs(back[i] - v[i]));
+      reference_error =
+          std::fmax(reference_error, std::fabs(body[i] - rolled[i]));
+    }
+
+    // TEST: the Euler angle rates of the EOM map back to the body rates
+    aircraft_state state{0.0,  0.0,  0.0,  roll, pitch, yaw,
+                         v[0], v[1], v[2], 0.1 * v[1], 0.1 * v[2], 0.1 * v[0]};
+    std::array<double, 12> derivative{aircrafts_EOM(
+        state, attitude, 1000.0, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0},
+        {{{1000.0, 0.0, 0.0}, {0.0, 1000.0, 0.0}, {0.0, 0.0, 1000.0}}})};
+    std::array<double, 3> rates{
+        body_angular_vel(attitude, derivative[STATE_ROLL],
+                         derivative[STATE_PITCH], derivative[STATE_YAW])};
+    std::array<double, 3> earth_vel{body_to_earth(v, roll, pitch, yaw)};
+    for (int i = 0; i < 3; ++i) {
+      kinematics_error = std::fmax(
+          kinematics_error,
+          std::fabs(rates[i] - state[STATE_FORWARD_ANG_VEL + i]) /
+              std::fmax(std::fabs(state[STATE_FORWARD_ANG_VEL + i]), 1.0));
+      kinematics_error = std::fmax(
+          kinematics_error,
+          std::fabs(derivative[STATE_EARTH_POS_X + i] - earth_vel[i]) / 50.0);
+    }
+  }
+  std::cout << "DCM orthogonality error: " << orthogonality_error << "\n";
+  std::cout << "Rotation round trip error: " << round_trip_error << "\n";
+  std::cout << "Rotation vs elementary rotations error: " << reference_error
+            << "\n";
+  std::cout << "EOM kinematics error: " << kinematics_error << "\n";
+  failures += orthogonality_error > 1e-14;
+  failures += round_trip_error > 1e-12;
+  failures += reference_error > 1e-12;
+  failures += kinematics_error > 1e-12;
+
+  // TEST: a force model taking the attitude gives the same derivative
+  std::array<std::array<double, 3>, 3> inertia_tensor{
+      {{1000.0, 0.0, -50.0}, {0.0, 2000.0, 0.0}, {-50.0, 0.0, 3000.0}}};
+  aircraft_dynamics<gravity_model> dynamics{1000.0, inertia_tensor,
+                                            gravity_model{1000.0}};
+  aircraft_dynamics<gravity_model_angles> dynamics_angles{
+      1000.0, inertia_tensor, gravity_model_angles{1000.0}};
+  aircraft_state state{0.0, 0.0,  -1000.0, 0.2, 0.1, 0.5,
+                       60.0, 1.0, 2.0,     0.01, 0.02, 0.03};
+  aircraft_state derivative, derivative_angles;
+  dynamics(0.0, state, derivative);
+  dynamics_angles(0.0, state, derivative_angles);
+  double model_error{0.0};
+  for (std::size_t c = 0; c < AIRCRAFT_STATE_SIZE; ++c) {
+    model_error =
+        std::fmax(model_error, std::fabs(derivative[c] - derivative_angles[c]));
+  }
+  std::cout << "Attitude-aware force model difference: " << model_error
+            << "\n";
+  failures += model_error > 1e-12;
+
+  // time per derivative with the shared attitude and with the angles. Both
+  // models are inlined here, so the compiler merges the repeated sines and
+  // cosines and the two timings are about equal: passing the attitude
+  // saves the trigonometric functions only where the compiler cannot see
+  // them twice (e.g. a force model compiled in another translation unit).
+  std::size_t evaluations{1000000};
+  double shared_checksum{0.0}, angles_checksum{0.0};
+  auto start{std::chrono::steady_clock::now()};
+  for (std::size_t i = 0; i < evaluations; ++i) {
+    state[STATE_YAW] = 1e-6 * static_cast<double>(i);
+    dynamics(0.0, state, derivative);
+    for (double rate : derivative) {
+      shared_checksum += rate;
+    }
+  }
+  std::chrono::duration<double> shared{std::chrono::steady_clock::now() -
+                                       start};
+  start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < evaluations; ++i) {
+    state[STATE_YAW] = 1e-6 * static_cast<double>(i);
+    dynamics_angles(0.0, state, derivative);
+    for (double rate : derivative) {
+      angles_checksum += rate;
+    }
+  }
+  std::chrono::duration<double> angles{std::chrono::steady_clock::now() -
+                                       start};
+  std::cout << "Derivative with the attitude passed to the force model: "
+            << shared.count() / evaluations * 1e9
+            << " ns, with the model using the angles: "
+            << angles.count() / evaluations * 1e9 << " ns\n";
+  failures += shared_checksum != angles_checksum;
+
+  return failures == 0 ? 0 : 1;
+}
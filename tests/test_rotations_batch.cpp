@@ -0,0 +1,138 @@
+#include "../include/framesnrotations.hpp"
+#include "../include/threadpool.hpp"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// three component arrays of size count in one buffer
+struct vector_buffer {
+  explicit vector_buffer(std::size_t count) : data(3 * count), size{count} {}
+  vector_arrays arrays() {
+    return {data.data(), data.data() + size, data.data() + 2 * size};
+  }
+  std::vector<double> data;
+  std::size_t size;
+};
+
+double max_difference(vector_buffer &a, vector_buffer &b) {
+  double difference{0.0};
+  for (std::size_t i = 0; i < a.data.size(); ++i) {
+    difference = std::fmax(difference, std::fabs(a.data[i] - b.data[i]));
+  }
+  return difference;
+}
+
+int main(void) {
+  int failures{0};
+  const std::size_t count{100000};
+  std::mt19937_64 generator{2024};
+  std::uniform_real_distribution<double> angle{-3.0, 3.0};
+  std::uniform_real_distribution<double> value{-100.0, 100.0};
+
+  std::vector<double> roll(count), pitch(count), yaw(count);
+  vector_buffer input{count};
+  for (std::size_t i = 0; i < count; ++i) {
+    roll[i] = angle(generator);
+    pitch[i] = 0.5 * angle(generator);
+    yaw[i] = angle(generator);
+  }
+  for (double &x : input.data) {
+    x = value(generator);
+  }
+  vector_arrays in{input.arrays()};
+
+  // TEST: per-sample attitudes against the scalar rotations
+  vector_buffer earth{count}, body{count}, earth_ref{count}, body_ref{count};
+  vector_arrays e{earth.arrays()}, b{body.arrays()};
+  vector_arrays e_ref{earth_ref.arrays()}, b_ref{body_ref.arrays()};
+  body_to_earth_batch(count, roll.data(), pitch.data(), yaw.data(), in, e);
+  earth_to_body_batch(count, roll.data(), pitch.data(), yaw.data(), in, b);
+  for (std::size_t i = 0; i < count; ++i) {
+    std::array<double, 3> v{in[0][i], in[1][i], in[2][i]};
+    std::array<double, 3> to_earth{body_to_earth(v, roll[i], pitch[i], yaw[i])};
+    std::array<double, 3> to_body{earth_to_body(v, roll[i], pitch[i], yaw[i])};
+    for (std::size_t c = 0; c < 3; ++c) {
+      e_ref[c][i] = to_earth[c];
+      b_ref[c][i] = to_body[c];
+    }
+  }
+  double error{std::fmax(max_difference(earth, earth_ref),
+                         max_difference(body, body_ref))};
+  std::cout << "Per-sample batch rotations, max error: " << error << "\n";
+  failures += error > 1e-12;
+
+  // TEST: shared attitude against the scalar rotations
+  direction_cosine_matrix attitude{0.3, -0.2, 1.1};
+  body_to_earth_batch(count, attitude, in, e);
+  earth_to_body_batch(count, attitude, in, b);
+  for (std::size_t i = 0; i < count; ++i) {
+    std::array<double, 3> v{in[0][i], in[1][i], in[2][i]};
+    std::array<double, 3> to_earth{body_to_earth(v, attitude)};
+    std::array<double, 3> to_body{earth_to_body(v, attitude)};
+    for (std::size_t c = 0; c < 3; ++c) {
+      e_ref[c][i] = to_earth[c];
+      b_ref[c][i] = to_body[c];
+    }
+  }
+  error = std::fmax(max_difference(earth, earth_ref),
+                    max_difference(body, body_ref));
+  std::cout << "Shared-attitude batch rotations, max error: " << error << "\n";
+  failures += error > 1e-12;
+
+  // TEST: batch body angular velocities
+  vector_buffer rates{count}, rates_ref{count};
+  vector_arrays w{rates.arrays()}, w_ref{rates_ref.arrays()};
+  body_angular_vel_batch(count, roll.data(), pitch.data(), in[0], in[1], in[2],
+                         w);
+  for (std::size_t i = 0; i < count; ++i) {
+    std::array<double, 3> reference{body_angular_vel(
+        roll[i], pitch[i], yaw[i], in[0][i], in[1][i], in[2][i])};
+    for (std::size_t c = 0; c < 3; ++c) {
+      w_ref[c][i] = reference[c];
+    }
+  }
+  error = max_difference(rates, rates_ref);
+  std::cout << "Batch body angular velocities, max error: " << error << "\n";
+  failures += error > 1e-12;
+
+  // TEST: chunks on a thread pool give the serial result
+  thread_pool pool{4};
+  vector_buffer parallel{count};
+  vector_arrays p{parallel.arrays()};
+  body_to_earth_batch(count, roll.data(), pitch.data(), yaw.data(), in, e);
+  pool.parallel_for(count, 4096, [&](std::size_t begin, std::size_t end) {
+    body_to_earth_batch(end - begin, roll.data() + begin, pitch.data() + begin,
+                        yaw.data() + begin, offset(in, begin),
+                        offset(p, begin));
+  });
+  bool identical{std::memcmp(parallel.data.data(), earth.data.data(),
+                             earth.data.size() * sizeof(double)) == 0};
+  std::cout << "Chunked on 4 threads equals serial: " << identical << "\n";
+  failures += !identical;
+
+  // vectors per second, scalar calls against the batch kernel
+  auto start{std::chrono::steady_clock::now()};
+  for (std::size_t i = 0; i < count; ++i) {
+    std::array<double, 3> v{body_to_earth({in[0][i], in[1][i], in[2][i]},
+                                          roll[i], pitch[i], yaw[i])};
+    e[0][i] = v[0];
+    e[1][i] = v[1];
+    e[2][i] = v[2];
+  }
+  std::chrono::duration<double> scalar{std::chrono::steady_clock::now() -
+                                       start};
+  start = std::chrono::steady_clock::now();
+  body_to_earth_batch(count, roll.data(), pitch.data(), yaw.data(), in, e);
+  std::chrono::duration<double> batch{std::chrono::steady_clock::now() -
+                                      start};
+  std::cout << "body_to_earth vectors per second, scalar: "
+            << count / scalar.count() << ", batch: " << count / batch.count()
+            << "\n";
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,234 @@
+#include "../include/aircraftmotion.hpp"
+#include "../include/airdata.hpp"
+#include "../include/integrators.hpp"
+#include "../include/trajectorylog.hpp"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// gravity, linear drag and a pitching moment
+struct glider {
+  double mass;
+  void operator()(double, const aircraft_state &state,
+                  const direction_cosine_matrix &attitude,
+                  std::array<double, 3> &force, std::array<double, 3> &moment) {
+    std::array<double, 3> gravity{
+        attitude.earth_to_body({0.0, 0.0, mass * GRAVITY_SEALEVEL_mps2})};
+    force = {gravity[0] - 2.0 * state[STATE_FORWARD_VEL],
+             gravity[1] - 2.0 * state[STATE_LATERAL_VEL],
+             gravity[2] - 20.0 * state[STATE_DOWNWARD_VEL]};
+    moment = {0.0, -50.0 * state[STATE_PITCH], 0.0};
+  }
+};
+
+int main(void) {
+  int failures{0};
+  const std::string path{"test_trajectorylog.traj"};
+
+  // a 20 s trajectory at 1 kHz
+  const std::size_t sample_count{20000};
+  const double step_s{0.001};
+  aircraft_dynamics<glider> dynamics{
+      500.0,
+      {{{800.0, 0.0, 0.0}, {0.0, 1000.0, 0.0}, {0.0, 0.0, 1500.0}}},
+      glider{500.0}};
+  RK4_integrator<AIRCRAFT_STATE_SIZE> rk4;
+  std::vector<aircraft_state> states(sample_count);
+  aircraft_state state{0.0, 0.0, -2000.0, 0.0, 0.1, 0.3,
+                       60.0, 0.5, 2.0, 0.0, 0.0, 0.0};
+  double time_s{0.0};
+  for (std::size_t i = 0; i < sample_count; ++i) {
+    states[i] = state;
+    rk4.step(dynamics, time_s, step_s, state);
+    time_s += step_s;
+  }
+
+  // TEST: every sample, across many blocks, reads back exactly
+  {
+    trajectory_recorder recorder{path, {"elevator_rad"}, 1, 1000};
+    for (std::size_t i = 0; i < sample_count; ++i) {
+      double elevator_rad{0.01 * static_cast<double>(i % 7)};
+      recorder.sample(step_s * i, states[i], &elevator_rad);
+    }
+    recorder.close();
+  }
+  trajectory_reader reader{path};
+  bool identical{reader.row_count() == sample_count &&
+                 reader.block_count() == 20 &&
+                 reader.channel_count() == TRAJECTORY_USER + 1 &&
+                 reader.channel_index("Mach_number") == TRAJECTORY_MACH &&
+                 reader.channel_name(TRAJECTORY_USER) == "elevator_rad"};
+  std::vector<double> pitch{reader.column(TRAJECTORY_STATE + STATE_PITCH)};
+  std::vector<double> CAS{reader.column(TRAJECTORY_CALIBRATED_AIRSPEED)};
+  for (std::size_t i = 0; i < sample_count && identical; ++i) {
+    const aircraft_state &x{states[i]};
+    double airspeed_mps{std::sqrt(
+        x[STATE_FORWARD_VEL] * x[STATE_FORWARD_VEL] +
+        x[STATE_LATERAL_VEL] * x[STATE_LATERAL_VEL] +
+        x[STATE_DOWNWARD_VEL] * x[STATE_DOWNWARD_VEL])};
+    air_data data{compute_air_data(-x[STATE_EARTH_POS_Z], airspeed_mps)};
+    identical = pitch[i] == x[STATE_PITCH] &&
+                CAS[i] == data.calibrated_airspeed_mps &&
+                reader.value(i, TRAJECTORY_TIME) == step_s * i &&
+                reader.value(i, TRAJECTORY_USER) ==
+                    0.01 * static_cast<double>(i % 7);
+  }
+  std::cout << "Trajectory of " << reader.row_count() << " rows in "
+            << reader.block_count() << " blocks read back: " << identical
+            << "\n";
+  failures += !identical;
+
+  // TEST: a file cut inside its last block keeps the complete blocks
+  {
+    long size_bytes{0};
+    std::FILE *file{std::fopen(path.c_str(), "rb")};
+    std::fseek(file, 0, SEEK_END);
+    size_bytes = std::ftell(file);
+    std::fclose(file);
+    failures += truncate(path.c_str(), size_bytes - 100) != 0;
+    trajectory_reader cut{path};
+    std::cout << "Cut file rows: " << cut.row_count() << "\n";
+    failures += cut.row_count() != sample_count - 1000;
+  }
+
+  // TEST: counts in the file that do not fit its size are rejected or end
+  // the index, also when multiplying them would wrap
+  {
+    auto overwrite = [&path](long position, std::uint64_t value) {
+      std::FILE *file{std::fopen(path.c_str(), "r+b")};
+      std::fseek(file, position, SEEK_SET);
+      std::fwrite(&value, sizeof(value), 1, file);
+      std::fclose(file);
+    };
+    auto rejected = [&path] {
+      try {
+        trajectory_reader corrupt{path};
+      } catch (const std::runtime_error &) {
+        return true;
+      }
+      return false;
+    };
+    long channel_count_position{
+        static_cast<long>(offsetof(trajectory_file_header, channel_count))};
+    long block_rows_position{
+        static_cast<long>(offsetof(trajectory_file_header, block_rows))};
+    std::uint64_t channel_count{trajectory_reader{path}.channel_count()};
+    long first_block_position{static_cast<long>(
+        sizeof(trajectory_file_header) + channel_count * TRAJECTORY_NAME_SIZE)};
+    int corrupt_files{0};
+    overwrite(channel_count_position, std::uint64_t{1} << 60);
+    corrupt_files += rejected();
+    overwrite(channel_count_position, channel_count);
+    overwrite(block_rows_position, ~std::uint64_t{0});
+    overwrite(first_block_position, std::uint64_t{1} << 61);
+    // a block longer than the rest of the file ends the index
+    corrupt_files += trajectory_reader{path}.block_count() == 0;
+    overwrite(first_block_position, 0);
+    corrupt_files += rejected();
+    std::cout << "Corrupt files rejected: " << corrupt_files << " of 3\n";
+    failures += corrupt_files != 3;
+  }
+
+  // TEST: decimation, events and deadbands
+  {
+    trajectory_recorder decimated{path, {}, 10};
+    for (std::size_t i = 0; i < sample_count; ++i) {
+      decimated.sample(step_s * i, states[i], nullptr, i == 5);
+    }
+    decimated.close();
+    trajectory_reader decimated_reader{path};
+    failures += decimated_reader.row_count() != sample_count / 10 + 1;
+    failures += decimated_reader.value(1, TRAJECTORY_TIME) != step_s * 5;
+
+    // every 1000 samples, or whenever the height moved by 5 m
+    trajectory_recorder triggered{path, {}, 1000};
+    triggered.set_deadband(TRAJECTORY_HEIGHT, 5.0);
+    for (std::size_t i = 0; i < sample_count; ++i) {
+      triggered.sample(step_s * i, states[i]);
+    }
+    triggered.close();
+    trajectory_reader triggered_reader{path};
+    std::vector<double> height{triggered_reader.column(TRAJECTORY_HEIGHT)};
+    double largest_gap{0.0}, largest_sample_step{0.0};
+    for (std::size_t i = 1; i < height.size(); ++i) {
+      largest_gap =
+          std::fmax(largest_gap, std::fabs(height[i] - height[i - 1]));
+    }
+    for (std::size_t i = 1; i < sample_count; ++i) {
+      largest_sample_step = std::fmax(
+          largest_sample_step, std::fabs(states[i][STATE_EARTH_POS_Z] -
+                                         states[i - 1][STATE_EARTH_POS_Z]));
+    }
+    std::cout << "Decimated rows: " << decimated_reader.row_count()
+              << ", deadband rows: " << triggered_reader.row_count()
+              << ", largest height step " << largest_gap << " m\n";
+    failures += triggered_reader.row_count() <= sample_count / 1000;
+    // a row is written at the first sample past the deadband
+    failures += largest_gap > 5.0 + largest_sample_step;
+  }
+
+  // rows per second, binary recorder against text formatting
+  // TEST: write errors (full disk) are thrown by sample() or close(), and
+  // the recorder still shuts down cleanly
+  bool write_error{false};
+  try {
+    trajectory_recorder full_disk{"/dev/full"};
+    for (std::size_t i = 0; i < 100000; ++i) {
+      full_disk.sample(step_s * i, states[i % sample_count]);
+    }
+    full_disk.close();
+  } catch (const std::runtime_error &) {
+    write_error = true;
+  }
+  std::cout << "Write error on a full disk reported: " << write_error << "\n";
+  failures += !write_error;
+
+  auto start{std::chrono::steady_clock::now()};
+  std::size_t stalls{0};
+  {
+    trajectory_recorder recorder{path};
+    for (int repeat = 0; repeat < 10; ++repeat) {
+      for (std::size_t i = 0; i < sample_count; ++i) {
+        recorder.sample(step_s * i, states[i]);
+      }
+    }
+    recorder.close();
+    stalls = recorder.writer().stall_count();
+  }
+  std::chrono::duration<double> binary{std::chrono::steady_clock::now() -
+                                       start};
+  start = std::chrono::steady_clock::now();
+  std::ostringstream text;
+  for (std::size_t i = 0; i < sample_count; ++i) {
+    const aircraft_state &x{states[i]};
+    double airspeed_mps{std::sqrt(
+        x[STATE_FORWARD_VEL] * x[STATE_FORWARD_VEL] +
+        x[STATE_LATERAL_VEL] * x[STATE_LATERAL_VEL] +
+        x[STATE_DOWNWARD_VEL] * x[STATE_DOWNWARD_VEL])};
+    air_data data{compute_air_data(-x[STATE_EARTH_POS_Z], airspeed_mps)};
+    text << step_s * i;
+    for (double value : x) {
+      text << ' ' << value;
+    }
+    text << ' ' << -x[STATE_EARTH_POS_Z] << ' ' << airspeed_mps << ' '
+         << data.Mach_number << ' ' << data.calibrated_airspeed_mps << ' '
+         << data.dynamic_pressure_Pa << ' ' << data.density_kgpm3 << '\n';
+  }
+  std::chrono::duration<double> formatted{std::chrono::steady_clock::now() -
+                                          start};
+  std::cout << "Rows per second, binary: " << 10 * sample_count / binary.count()
+            << " (" << stalls << " stalls), text: "
+            << sample_count / formatted.count() << " (" << text.str().size()
+            << " bytes)\n";
+  std::remove(path.c_str());
+
+  return failures == 0 ? 0 : 1;
+}
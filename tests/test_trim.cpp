@@ -0,0 +1,307 @@
+#include "../include/aircraftmotion.hpp"
+#include "../include/atmosphere.hpp"
+#include "../include/autodiff.hpp"
+#include "../include/framesnrotations.hpp"
+#include "../include/massproperties.hpp"
+#include "../include/threadpool.hpp"
+#include "../include/trim.hpp"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+const double MASS_kg{1043.0};
+const std::array<std::array<double, 3>, 3> INERTIA_TENSOR_kgm2{
+    {{1285.0, 0.0, -50.0}, {0.0, 1825.0, 0.0}, {-50.0, 0.0, 2667.0}}};
+
+// light aircraft with linear aerodynamic derivatives, written once for
+// doubles and dual numbers
+struct light_aircraft {
+  double area_m2{16.2};
+  double span_m{10.9};
+  double chord_m{1.49};
+  double max_thrust_N{2000.0};
+
+  template <typename Scalar>
+  void operator()(const std::array<Scalar, 12> &state,
+                  const std::array<Scalar, 4> &controls,
+                  std::array<Scalar, 3> &force_vector,
+                  std::array<Scalar, 3> &moment_vector) const {
+    using std::asin;
+    using std::atan2;
+    using std::cos;
+    using std::sin;
+    using std::sqrt;
+
+    Scalar height_m{-state[STATE_EARTH_POS_Z]};
+    Scalar temperature_K{ISA_temperature(height_m)};
+    Scalar density_kgpm3{
+        ISA_density(temperature_K, ISA_airpressure(temperature_K, height_m))};
+    const Scalar &u{state[STATE_FORWARD_VEL]}, &v{state[STATE_LATERAL_VEL]},
+        &w{state[STATE_DOWNWARD_VEL]};
+    Scalar airspeed_mps{sqrt(u * u + v * v + w * w)};
+    Scalar alpha{atan2(w, u)}, beta{asin(v / airspeed_mps)};
+    Scalar qS{0.5 * density_kgpm3 * airspeed_mps * airspeed_mps * area_m2};
+    // nondimensional angular velocities
+    Scalar p_hat{state[STATE_FORWARD_ANG_VEL] * span_m / (2.0 * airspeed_mps)};
+    Scalar q_hat{state[STATE_LATERAL_ANG_VEL] * chord_m /
+                 (2.0 * airspeed_mps)};
+    Scalar r_hat{state[STATE_DOWNWARD_ANG_VEL] * span_m /
+                 (2.0 * airspeed_mps)};
+    const Scalar &throttle{controls[CONTROL_THROTTLE]};
+    const Scalar &elevator{controls[CONTROL_ELEVATOR]};
+    const Scalar &aileron{controls[CONTROL_AILERON]};
+    const Scalar &rudder{controls[CONTROL_RUDDER]};
+
+    Scalar CL{0.31 + 5.143 * alpha + 3.9 * q_hat + 0.43 * elevator};
+    Scalar CD{0.031 + 0.054 * CL * CL};
+    Scalar CY{-0.31 * beta + 0.187 * rudder};
+    Scalar Cl{-0.089 * beta - 0.47 * p_hat + 0.096 * r_hat - 0.178 * aileron +
+              0.0147 * rudder};
+    Scalar Cm{-0.015 - 0.89 * alpha - 12.4 * q_hat - 1.28 * elevator};
+    Scalar Cn{0.065 * beta - 0.03 * p_hat - 0.099 * r_hat - 0.053 * aileron -
+              0.0657 * rudder};
+
+    // wind axes to body axes, plus thrust and gravity
+    Scalar drag_N{qS * CD}, side_N{qS * CY}, lift_N{qS * CL};
+    Scalar c_alpha{cos(alpha)}, s_alpha{sin(alpha)};
+    Scalar c_beta{cos(beta)}, s_beta{sin(beta)};
+    std::array<Scalar, 3> gravity{earth_to_body(
+        std::array<Scalar, 3>{Scalar(0.0), Scalar(0.0),
+                              Scalar(MASS_kg * GRAVITY_SEALEVEL_mps2)},
+        state[STATE_ROLL], state[STATE_PITCH], state[STATE_YAW])};
+    force_vector = {-c_alpha * c_beta * drag_N - c_alpha * s_beta * side_N +
+                        s_alpha * lift_N +
+                        throttle * max_thrust_N * density_kgpm3 /
+                            DENSITY_SEALEVEL_kgpm3 +
+                        gravity[0],
+                    -s_beta * drag_N + c_beta * side_N + gravity[1],
+                    -s_alpha * c_beta * drag_N - s_alpha * s_beta * side_N -
+                        c_alpha * lift_N + gravity[2]};
+    moment_vector = {qS * span_m * Cl, qS * chord_m * Cm, qS * span_m * Cn};
+  }
+};
+
+// A and B by central differences of the double model
+linear_model finite_difference_linearize(
+    const light_aircraft &model, const mass_properties<double> &properties,
+    const aircraft_state &state, const aircraft_controls &controls) {
+  linear_model linear{};
+  for (std::size_t j = 0; j < AIRCRAFT_STATE_SIZE + AIRCRAFT_CONTROL_SIZE;
+       ++j) {
+    aircraft_state x_plus{state}, x_minus{state};
+    aircraft_controls u_plus{controls}, u_minus{controls};
+    double &plus{j < AIRCRAFT_STATE_SIZE ? x_plus[j]
+                                         : u_plus[j - AIRCRAFT_STATE_SIZE]};
+    double &minus{j < AIRCRAFT_STATE_SIZE ? x_minus[j]
+                                          : u_minus[j - AIRCRAFT_STATE_SIZE]};
+    double step{1e-6 * std::fmax(1.0, std::fabs(plus))};
+    plus += step;
+    minus -= step;
+    aircraft_state f_plus{
+        aircraft_model_derivative(model, properties, x_plus, u_plus)};
+    aircraft_state f_minus{
+        aircraft_model_derivative(model, properties, x_minus, u_minus)};
+    for (std::size_t i = 0; i < AIRCRAFT_STATE_SIZE; ++i) {
+      double slope{(f_plus[i] - f_minus[i]) / (2.0 * step)};
+      if (j < AIRCRAFT_STATE_SIZE) {
+        linear.A[i][j] = slope;
+      } else {
+        linear.B[i][j - AIRCRAFT_STATE_SIZE] = slope;
+      }
+    }
+  }
+  return linear;
+}
+
+// model without a trim point: the forward force is smallest at the edge of
+// the domain of its square root, where the Newton steps leave the domain
+struct untrimmable_aircraft {
+  template <typename Scalar>
+  void operator()(const std::array<Scalar, 12> &state,
+                  const std::array<Scalar, 4> &controls,
+                  std::array<Scalar, 3> &force_vector,
+                  std::array<Scalar, 3> &moment_vector) const {
+    using std::sqrt;
+    force_vector = {sqrt(controls[CONTROL_THROTTLE] - 0.2) + 1.0,
+                    state[STATE_LATERAL_VEL] + controls[CONTROL_RUDDER],
+                    state[STATE_DOWNWARD_VEL] + controls[CONTROL_ELEVATOR]};
+    moment_vector = {controls[CONTROL_AILERON], controls[CONTROL_ELEVATOR],
+                     controls[CONTROL_RUDDER]};
+  }
+};
+
+int main(void) {
+  int failures{0};
+
+  // TEST: dual numbers against the analytic derivatives of
+  // f = sin(x) exp(y) / x + x^2.5 - atan2(y, x) + sqrt(x y)
+  {
+    using std::atan2;
+    using std::exp;
+    using std::pow;
+    using std::sin;
+    using std::sqrt;
+    double x0{0.7}, y0{1.3};
+    dual<2> x{dual<2>::variable(x0, 0)}, y{dual<2>::variable(y0, 1)};
+    dual<2> f{sin(x) * exp(y) / x + pow(x, 2.5) - atan2(y, x) +
+              sqrt(x * y)};
+    double dfdx{(std::cos(x0) * x0 - std::sin(x0)) * std::exp(y0) /
+                    (x0 * x0) +
+                2.5 * std::pow(x0, 1.5) + y0 / (x0 * x0 + y0 * y0) +
+                0.5 * std::sqrt(y0 / x0)};
+    double dfdy{std::sin(x0) * std::exp(y0) / x0 -
+                x0 / (x0 * x0 + y0 * y0) + 0.5 * std::sqrt(x0 / y0)};
+    double error{std::fabs(f.gradient[0] - dfdx) +
+                 std::fabs(f.gradient[1] - dfdy)};
+    std::cout << "Dual number derivative error: " << error << "\n";
+    failures += error > 1e-14;
+  }
+
+  // TEST: the generic atmosphere gives the hydrostatic pressure gradient
+  {
+    double hydrostatic_error{0.0}, value_difference{0.0};
+    for (double height_m : {500.0, 15000.0, 25000.0, 50000.0, 80000.0}) {
+      dual<1> h{dual<1>::variable(height_m, 0)};
+      dual<1> temperature{ISA_temperature(h)};
+      dual<1> pressure{ISA_airpressure(temperature, h)};
+      dual<1> density{ISA_density(temperature, pressure)};
+      hydrostatic_error = std::fmax(
+          hydrostatic_error,
+          std::fabs(pressure.gradient[0] +
+                    density.value * GRAVITY_SEALEVEL_mps2) /
+              (density.value * GRAVITY_SEALEVEL_mps2));
+      double T{ISA_temperature(height_m)};
+      value_difference = std::fmax(
+          value_difference,
+          std::fabs(pressure.value - ISA_airpressure(T, height_m)) +
+              std::fabs(temperature.value - T));
+    }
+    std::cout << "Hydrostatic gradient error: " << hydrostatic_error
+              << ", values vs double: " << value_difference << "\n";
+    failures += hydrostatic_error > 1e-12;
+    failures += value_difference != 0.0;
+  }
+
+  light_aircraft model;
+  mass_properties<double> properties{MASS_kg, INERTIA_TENSOR_kgm2};
+
+  // TEST: level trim
+  trim_result level{trim(model, properties, {1000.0, 50.0})};
+  std::cout << "Level trim at 1000 m, 50 m/s: alpha "
+            << level.angle_of_attack_rad << " rad, throttle "
+            << level.controls[CONTROL_THROTTLE] << ", elevator "
+            << level.controls[CONTROL_ELEVATOR] << ", " << level.iterations
+            << " iterations, residual " << level.residual << "\n";
+  failures += level.status != TRIM_CONVERGED;
+  failures += std::fabs(level.sideslip_rad) > 1e-9;
+  failures += std::fabs(level.controls[CONTROL_AILERON]) > 1e-9;
+  failures += std::fabs(level.controls[CONTROL_RUDDER]) > 1e-9;
+  failures += level.iterations > 10;
+
+  // TEST: a trim that stops reducing the residual keeps its last point and
+  // says so
+  trim_result stalled{
+      trim(untrimmable_aircraft{}, properties, {1000.0, 50.0})};
+  std::cout << "Untrimmable model: status " << static_cast<int>(stalled.status)
+            << " after " << stalled.iterations << " iterations, throttle "
+            << stalled.controls[CONTROL_THROTTLE] << ", residual "
+            << stalled.residual << "\n";
+  failures += stalled.status != TRIM_NO_DESCENT;
+  failures += !(stalled.controls[CONTROL_THROTTLE] >= 0.2);
+  failures += !(stalled.residual >= 1.0 / MASS_kg);
+
+  // TEST: climbing trim keeps the flight path angle
+  trim_result climb{trim(model, properties, {1000.0, 50.0, 0.05})};
+  aircraft_state climb_derivative{aircraft_model_derivative(
+      model, properties, climb.state, climb.controls)};
+  double climb_error{
+      std::fabs(climb_derivative[STATE_EARTH_POS_Z] + 50.0 * std::sin(0.05))};
+  std::cout << "Climb trim throttle " << climb.controls[CONTROL_THROTTLE]
+            << ", climb rate error " << climb_error << "\n";
+  failures += climb.status != TRIM_CONVERGED;
+  failures += climb_error > 1e-9;
+  failures += climb.controls[CONTROL_THROTTLE] <=
+              level.controls[CONTROL_THROTTLE];
+
+  // TEST: the dual-number Jacobians match finite differences
+  linear_model linear{
+      linearize(model, properties, level.state, level.controls)};
+  linear_model reference{finite_difference_linearize(
+      model, properties, level.state, level.controls)};
+  double jacobian_error{0.0};
+  for (std::size_t i = 0; i < AIRCRAFT_STATE_SIZE; ++i) {
+    for (std::size_t j = 0; j < AIRCRAFT_STATE_SIZE; ++j) {
+      jacobian_error = std::fmax(
+          jacobian_error, std::fabs(linear.A[i][j] - reference.A[i][j]) /
+                              std::fmax(1.0, std::fabs(reference.A[i][j])));
+    }
+    for (std::size_t j = 0; j < AIRCRAFT_CONTROL_SIZE; ++j) {
+      jacobian_error = std::fmax(
+          jacobian_error, std::fabs(linear.B[i][j] - reference.B[i][j]) /
+                              std::fmax(1.0, std::fabs(reference.B[i][j])));
+    }
+  }
+  std::cout << "A/B vs finite differences: " << jacobian_error
+            << ", pitch damping Mq " << linear.A[10][10] << "\n";
+  failures += jacobian_error > 1e-6;
+  failures += !(linear.A[10][10] < 0.0);
+
+  // TEST: the envelope is the same on one and on four threads
+  std::vector<double> heights_m{0.0, 1000.0, 2000.0, 3000.0};
+  std::vector<double> airspeeds_mps{35.0, 40.0, 45.0, 50.0, 55.0, 60.0};
+  thread_pool serial{1}, parallel{4};
+  std::vector<trim_point> envelope{
+      trim_envelope(model, properties, heights_m, airspeeds_mps, parallel)};
+  std::vector<trim_point> envelope_serial{
+      trim_envelope(model, properties, heights_m, airspeeds_mps, serial)};
+  int converged{0};
+  for (const trim_point &point : envelope) {
+    converged += point.trim.status == TRIM_CONVERGED;
+  }
+  bool identical{true};
+  for (std::size_t i = 0; i < envelope.size(); ++i) {
+    const trim_point &a{envelope[i]}, &b{envelope_serial[i]};
+    identical = identical &&
+                std::memcmp(&a.trim.state, &b.trim.state,
+                            sizeof(a.trim.state)) == 0 &&
+                std::memcmp(&a.trim.controls, &b.trim.controls,
+                            sizeof(a.trim.controls)) == 0 &&
+                std::memcmp(&a.linear.A, &b.linear.A, sizeof(a.linear.A)) ==
+                    0 &&
+                std::memcmp(&a.linear.B, &b.linear.B, sizeof(a.linear.B)) == 0;
+  }
+  std::cout << "Envelope: " << converged << "/" << envelope.size()
+            << " points trimmed, identical on 1 and 4 threads: " << identical
+            << "\n";
+  failures += converged != static_cast<int>(envelope.size());
+  failures += !identical;
+
+  // Jacobians per second, dual numbers against finite differences
+  const int repeats{2000};
+  double checksum{0.0};
+  auto start{std::chrono::steady_clock::now()};
+  for (int i = 0; i < repeats; ++i) {
+    checksum +=
+        linearize(model, properties, level.state, level.controls).A[10][10];
+  }
+  std::chrono::duration<double> dual_time{std::chrono::steady_clock::now() -
+                                          start};
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeats; ++i) {
+    checksum -= finite_difference_linearize(model, properties, level.state,
+                                            level.controls)
+                    .A[10][10];
+  }
+  std::chrono::duration<double> difference_time{
+      std::chrono::steady_clock::now() - start};
+  std::cout << "Linearizations per second, dual numbers: "
+            << repeats / dual_time.count()
+            << ", central differences: " << repeats / difference_time.count()
+            << " (" << checksum << ")\n";
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+// Convert a trajectory file (trajectorylog.hpp) to CSV:
+//   traj2csv trajectory.bin [output.csv]
+// The CSV goes to standard output when no output file is given. Values are
+// written with the shortest representation that reads back to the same
+// double.
+
+#include "../include/trajectorylog.hpp"
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    std::cerr << "usage: traj2csv <trajectory file> [csv file]\n";
+    return 2;
+  }
+
+  try {
+    trajectory_reader reader{argv[1]};
+    std::FILE *output{argc == 3 ? std::fopen(argv[2], "wb") : stdout};
+    if (output == nullptr) {
+      std::cerr << "traj2csv: cannot create " << argv[2] << "\n";
+      return 1;
+    }
+
+    std::string text;
+    for (std::size_t c = 0; c < reader.channel_count(); ++c) {
+      text += reader.channel_name(c);
+      text += c + 1 < reader.channel_count() ? ',' : '\n';
+    }
+
+    // one block at a time, reading every column in place
+    std::vector<const double *> columns(reader.channel_count());
+    char number[32];
+    for (std::size_t b = 0; b < reader.block_count(); ++b) {
+      for (std::size_t c = 0; c < reader.channel_count(); ++c) {
+        columns[c] = reader.block_column(b, c);
+      }
+      for (std::size_t row = 0; row < reader.block_row_count(b); ++row) {
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+          std::to_chars_result result{
+              std::to_chars(number, number + sizeof(number), columns[c][row])};
+          text.append(number, result.ptr);
+          text += c + 1 < columns.size() ? ',' : '\n';
+        }
+      }
+      if (std::fwrite(text.data(), 1, text.size(), output) != text.size()) {
+        std::cerr << "traj2csv: write failed\n";
+        return 1;
+      }
+      text.clear();
+    }
+    if (std::fwrite(text.data(), 1, text.size(), output) != text.size() ||
+        (output != stdout ? std::fclose(output) : std::fflush(output)) != 0) {
+      std::cerr << "traj2csv: write failed\n";
+      return 1;
+    }
+  } catch (const std::exception &error) {
+    std::cerr << "traj2csv: " << error.what() << "\n";
+    return 1;
+  }
+  return 0;
+}